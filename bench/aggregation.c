@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCH_SIZE 1000
+#define SPANS_PER_THREAD 100000
+
+static const char* names[] = {"GET /", "GET /api/users", "POST /api/orders",
+                              "SELECT users", "INSERT orders"};
+
+static nrt_recorder_t* recorder;
+
+static void on_aggregates(const nrt_span_aggregate_t* aggregates,
+                          size_t len,
+                          void* user_data) {
+  (void)aggregates;
+  *(size_t*)user_data += len;
+}
+
+/*
+ * Record spans with a few distinct names via a span recorder.
+ */
+static void record_spans(void* arg) {
+  uint64_t high, low;
+  int i;
+
+  (void)arg;
+  for (i = 0; i < SPANS_PER_THREAD; i++) {
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, names[i % 5]);
+    nrt_span_set_duration_us(span, 100 + i % 1000);
+    nrt_recorder_record(recorder, &span);
+  }
+}
+
+static nrt_client_t* new_client(bool aggregate, size_t* harvested) {
+  nrt_client_config_t* cfg = bench_client_config_new();
+  nrt_client_config_set_sampling_ratio(cfg, 0.01);
+  if (aggregate) {
+    nrt_client_config_set_aggregation(cfg, 1000, on_aggregates, harvested);
+  }
+  return nrt_client_new(&cfg);
+}
+
+/*
+ * Compare recording spans from an increasing number of threads, sampling 1%
+ * of traces, with and without aggregating all spans into RED metrics.
+ */
+int main() {
+  void* args[BENCH_THREADS_MAX] = {0};
+  char name[64];
+  size_t harvested;
+  uint64_t start;
+  int threads, aggregate;
+
+  for (threads = 1; threads <= 16; threads *= 4) {
+    for (aggregate = 0; aggregate <= 1; aggregate++) {
+      nrt_client_t* client = new_client(aggregate, &harvested);
+      recorder = nrt_recorder_new(&client, BATCH_SIZE, 1000);
+      harvested = 0;
+
+      start = bench_now_ns();
+      bench_run_threads(threads, record_spans, args);
+      nrt_recorder_shutdown(&recorder);
+      snprintf(name, sizeof(name), "%s, %d threads",
+               aggregate ? "aggregated" : "sampled only", threads);
+      bench_report(name, (uint64_t)threads * SPANS_PER_THREAD,
+                   bench_now_ns() - start);
+      if (aggregate) {
+        printf("  aggregates harvested %zu\n", harvested);
+      }
+    }
+  }
+}
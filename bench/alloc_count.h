@@ -0,0 +1,127 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Allocation counting for benchmarks.
+ *
+ * Including this header interposes malloc() and friends for the whole
+ * executable, including the allocations of the Rust library, and counts
+ * every call. Include it in exactly one file of a benchmark.
+ *
+ * Counting is supported with glibc, where the interposed functions forward
+ * to the glibc allocator. Elsewhere, ALLOC_COUNT_ENABLED is 0 and the
+ * counters stay at zero.
+ */
+#ifndef NEWRELIC_TELEMETRY_SDK_ALLOC_COUNT
+#define NEWRELIC_TELEMETRY_SDK_ALLOC_COUNT
+
+#include "bench.h"
+#include <errno.h>
+#include <stddef.h>
+
+#if defined(__GLIBC__) && !defined(OS_WINDOWS)
+#define ALLOC_COUNT_ENABLED 1
+#else
+#define ALLOC_COUNT_ENABLED 0
+#endif
+
+typedef struct {
+  /* Calls allocating memory, including realloc(). */
+  uint64_t allocs;
+  /* Calls to free() with a non-NULL pointer. */
+  uint64_t frees;
+  /* Bytes requested by allocating calls. */
+  uint64_t bytes;
+} alloc_count_t;
+
+static alloc_count_t alloc_counters;
+
+#if ALLOC_COUNT_ENABLED
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void* ptr);
+
+static inline void alloc_count_record(size_t size) {
+  __atomic_fetch_add(&alloc_counters.allocs, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&alloc_counters.bytes, size, __ATOMIC_RELAXED);
+}
+
+void* malloc(size_t size) {
+  alloc_count_record(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  alloc_count_record(count * size);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  alloc_count_record(size);
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  alloc_count_record(size);
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  void* p = memalign(alignment, size);
+  if (!p) {
+    return ENOMEM;
+  }
+  *ptr = p;
+  return 0;
+}
+
+void free(void* ptr) {
+  if (ptr) {
+    __atomic_fetch_add(&alloc_counters.frees, 1, __ATOMIC_RELAXED);
+  }
+  __libc_free(ptr);
+}
+
+#endif
+
+/*
+ * Return a snapshot of the allocation counters.
+ */
+static inline alloc_count_t alloc_count_now(void) {
+  alloc_count_t now;
+#if ALLOC_COUNT_ENABLED
+  now.allocs = __atomic_load_n(&alloc_counters.allocs, __ATOMIC_RELAXED);
+  now.frees = __atomic_load_n(&alloc_counters.frees, __ATOMIC_RELAXED);
+  now.bytes = __atomic_load_n(&alloc_counters.bytes, __ATOMIC_RELAXED);
+#else
+  now = alloc_counters;
+#endif
+  return now;
+}
+
+/*
+ * Print the result of a benchmark run of `count` operations that took
+ * `elapsed_ns` nanoseconds, with the allocations made since `start`.
+ */
+static inline void bench_report_allocs(const char* name,
+                                       uint64_t count,
+                                       uint64_t elapsed_ns,
+                                       alloc_count_t start) {
+  alloc_count_t end = alloc_count_now();
+  printf("%-40s %10.1f ns/op %8.2f allocs/op %8.2f frees/op %10.1f B/op\n",
+         name, (double)elapsed_ns / count,
+         (double)(end.allocs - start.allocs) / count,
+         (double)(end.frees - start.frees) / count,
+         (double)(end.bytes - start.bytes) / count);
+}
+
+#endif /* NEWRELIC_TELEMETRY_SDK_ALLOC_COUNT */
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Helpers shared by the benchmarks.
+ */
+#ifndef NEWRELIC_TELEMETRY_SDK_BENCH
+#define NEWRELIC_TELEMETRY_SDK_BENCH
+
+#include "newrelic-telemetry-sdk.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef OS_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <pthread.h>
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#define BENCH_THREADS_MAX 64
+
+/*
+ * Return a monotonic timestamp in nanoseconds.
+ */
+static inline uint64_t bench_now_ns(void) {
+#ifdef OS_WINDOWS
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart * (1000000000.0 / frequency.QuadPart));
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/*
+ * Print the result of a benchmark run of `count` operations that took
+ * `elapsed_ns` nanoseconds.
+ */
+static inline void bench_report(const char* name,
+                                uint64_t count,
+                                uint64_t elapsed_ns) {
+  printf("%-40s %12llu ops %10.1f ns/op %12.0f ops/s\n", name,
+         (unsigned long long)count, (double)elapsed_ns / count,
+         count * 1e9 / elapsed_ns);
+}
+
+/*
+ * Sleep for `ms` milliseconds.
+ */
+static inline void bench_sleep_ms(unsigned ms) {
+#ifdef OS_WINDOWS
+  Sleep(ms);
+#else
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+#endif
+}
+
+/*
+ * Return the CPU time used by all threads of the process in nanoseconds,
+ * user and system time combined.
+ */
+static inline uint64_t bench_cpu_ns(void) {
+#ifdef OS_WINDOWS
+  FILETIME creation, exit, kernel, user;
+  GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+  return ((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+          (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) *
+         100;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return ((uint64_t)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+             1000000000 +
+         ((uint64_t)usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+#endif
+}
+
+/*
+ * Return the peak resident set size of the process in kilobytes.
+ */
+static inline uint64_t bench_peak_rss_kb(void) {
+#ifdef OS_WINDOWS
+  PROCESS_MEMORY_COUNTERS counters;
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return counters.PeakWorkingSetSize / 1024;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  /* macOS reports bytes. */
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+/*
+ * Return a client configuration for benchmarks that send batches without
+ * measuring their delivery. Nothing listens on the endpoint, so payloads are
+ * dropped after one try.
+ */
+static inline nrt_client_config_t* bench_client_config_new(void) {
+  nrt_client_config_t* cfg = nrt_client_config_new("bench");
+  nrt_client_config_set_endpoint_traces(cfg, "localhost", 1);
+  nrt_client_config_set_retries_max(cfg, 0);
+  return cfg;
+}
+
+/*
+ * Create a client with the configuration of bench_client_config_new().
+ */
+static inline nrt_client_t* bench_client_new(void) {
+  nrt_client_config_t* cfg = bench_client_config_new();
+  return nrt_client_new(&cfg);
+}
+
+static int bench_compare_u64(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
+}
+
+/*
+ * Print the distribution of `count` latencies in nanoseconds. The samples are
+ * sorted in place.
+ */
+static inline void bench_report_latencies(const char* name,
+                                          uint64_t* samples,
+                                          size_t count) {
+  if (count == 0) {
+    return;
+  }
+  qsort(samples, count, sizeof(uint64_t), bench_compare_u64);
+  printf("%-40s p50 %8llu ns  p99 %8llu ns  p99.9 %8llu ns  max %8llu ns\n",
+         name, (unsigned long long)samples[count / 2],
+         (unsigned long long)samples[count * 99 / 100],
+         (unsigned long long)samples[count * 999 / 1000],
+         (unsigned long long)samples[count - 1]);
+}
+
+#ifdef OS_WINDOWS
+typedef CRITICAL_SECTION bench_mutex_t;
+#define bench_mutex_init(m) InitializeCriticalSection(m)
+#define bench_mutex_lock(m) EnterCriticalSection(m)
+#define bench_mutex_unlock(m) LeaveCriticalSection(m)
+#define bench_mutex_destroy(m) DeleteCriticalSection(m)
+#else
+typedef pthread_mutex_t bench_mutex_t;
+#define bench_mutex_init(m) pthread_mutex_init(m, NULL)
+#define bench_mutex_lock(m) pthread_mutex_lock(m)
+#define bench_mutex_unlock(m) pthread_mutex_unlock(m)
+#define bench_mutex_destroy(m) pthread_mutex_destroy(m)
+#endif
+
+typedef struct {
+  void (*fn)(void*);
+  void* arg;
+} bench_thread_t;
+
+#ifdef OS_WINDOWS
+static DWORD WINAPI bench_thread_main(LPVOID arg) {
+  bench_thread_t* thread = (bench_thread_t*)arg;
+  thread->fn(thread->arg);
+  return 0;
+}
+#else
+static void* bench_thread_main(void* arg) {
+  bench_thread_t* thread = (bench_thread_t*)arg;
+  thread->fn(thread->arg);
+  return NULL;
+}
+#endif
+
+/*
+ * Run `fn` on `count` threads and wait for all of them to finish. Thread `i`
+ * is passed `args[i]`.
+ */
+static inline void bench_run_threads(int count,
+                                     void (*fn)(void*),
+                                     void** args) {
+  bench_thread_t threads[BENCH_THREADS_MAX];
+#ifdef OS_WINDOWS
+  HANDLE handles[BENCH_THREADS_MAX];
+#else
+  pthread_t handles[BENCH_THREADS_MAX];
+#endif
+  int i;
+
+  for (i = 0; i < count && i < BENCH_THREADS_MAX; i++) {
+    threads[i].fn = fn;
+    threads[i].arg = args[i];
+#ifdef OS_WINDOWS
+    handles[i] = CreateThread(NULL, 0, bench_thread_main, &threads[i], 0, NULL);
+#else
+    pthread_create(&handles[i], NULL, bench_thread_main, &threads[i]);
+#endif
+  }
+
+  for (i = 0; i < count && i < BENCH_THREADS_MAX; i++) {
+#ifdef OS_WINDOWS
+    WaitForSingleObject(handles[i], INFINITE);
+    CloseHandle(handles[i]);
+#else
+    pthread_join(handles[i], NULL);
+#endif
+  }
+}
+
+#endif /* NEWRELIC_TELEMETRY_SDK_BENCH */
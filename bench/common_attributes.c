@@ -0,0 +1,121 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCHES 100
+#define SPANS_PER_BATCH 1000
+
+typedef enum {
+  /* Every span carries its own, distinct resource attributes. */
+  DISTINCT,
+  /* Every span carries a copy of the same resource attributes. */
+  REPEATED,
+  /* The resource attributes are set once per batch. */
+  COMMON,
+} resource_mode_t;
+
+static const char* mode_names[] = {"distinct per span", "repeated per span",
+                                   "common per batch"};
+
+/*
+ * Set the attributes describing the process, as every span of a service
+ * carries them. Each value is tagged with `tag`, so with DISTINCT no value is
+ * shared and the payload is as large as if copies weren't deduplicated.
+ */
+static void set_resource(nrt_attributes_t* attrs, int tag) {
+  static const char* keys[] = {"service.name", "host", "cloud.region",
+                               "service.version", "deployment.environment",
+                               "telemetry.sdk.language"};
+  static const char* values[] = {"checkout-service",
+                                 "ip-10-0-3-117.ec2.internal", "us-east-1",
+                                 "2020.06.1-a1b2c3d", "production", "c"};
+  char value[64];
+  int i;
+
+  for (i = 0; i < 6; i++) {
+    snprintf(value, sizeof(value), "%s-%03d", values[i], tag % 1000);
+    nrt_attributes_set_string(attrs, keys[i], value);
+  }
+}
+
+static nrt_span_batch_t* new_batch(resource_mode_t mode) {
+  static const char* routes[] = {"GET /api/cart", "POST /api/cart/items",
+                                 "GET /api/products/{id}",
+                                 "POST /api/checkout"};
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  uint64_t high, low;
+  int i;
+
+  if (mode == COMMON) {
+    nrt_attributes_t* common = nrt_attributes_new();
+    set_resource(common, 0);
+    nrt_span_batch_set_common_attributes(batch, &common);
+  }
+  for (i = 0; i < SPANS_PER_BATCH; i++) {
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, routes[i % 4]);
+    nrt_span_set_duration_us(span, 200 + i % 5000);
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    if (mode != COMMON) {
+      set_resource(attrs, mode == DISTINCT ? i : 0);
+    }
+    nrt_attributes_set_string(attrs, "http.method", i % 2 ? "POST" : "GET");
+    nrt_attributes_set_int(attrs, "http.status_code", i % 50 ? 200 : 500);
+    nrt_attributes_set_uint(attrs, "http.response_content_length", i * 7);
+    nrt_span_set_attributes(span, &attrs);
+    nrt_span_batch_record(batch, &span);
+  }
+  return batch;
+}
+
+/*
+ * Build and send batches of spans with resource attributes and compare the
+ * estimated payload size and the CPU time to build and convert them.
+ */
+static void run(resource_mode_t mode) {
+  nrt_span_batch_t* batches[BATCHES];
+  nrt_client_stats_t stats;
+  uint64_t start, build_ns;
+  char name[64];
+  int i;
+
+  nrt_client_config_t* cfg = bench_client_config_new();
+  nrt_client_config_set_queue_max(cfg, BATCHES);
+  nrt_client_t* client = nrt_client_new(&cfg);
+
+  start = bench_now_ns();
+  for (i = 0; i < BATCHES; i++) {
+    batches[i] = new_batch(mode);
+  }
+  build_ns = bench_now_ns() - start;
+
+  for (i = 0; i < BATCHES; i++) {
+    nrt_client_enqueue(client, &batches[i]);
+  }
+  do {
+    bench_sleep_ms(1);
+    nrt_client_get_stats(client, &stats);
+  } while (stats.batches_sent < BATCHES);
+
+  snprintf(name, sizeof(name), "build, %s", mode_names[mode]);
+  bench_report(name, BATCHES * SPANS_PER_BATCH, build_ns);
+  snprintf(name, sizeof(name), "convert, %s", mode_names[mode]);
+  bench_report(name, stats.spans_sent, stats.send_latency.sum_ns);
+  printf("%-40s %10.1f B/span %8llu payloads\n", "",
+         (double)stats.payload_bytes_sent / stats.spans_sent,
+         (unsigned long long)stats.payloads_sent);
+  nrt_client_shutdown(&client);
+}
+
+int main() {
+  run(DISTINCT);
+  run(REPEATED);
+  run(COMMON);
+}
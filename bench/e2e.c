@@ -0,0 +1,203 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "mock_ingest.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * The shape of the workload, see usage() for the command line.
+ */
+typedef struct {
+  int threads;
+  int batches_per_thread;
+  int spans_per_batch;
+  int attributes_per_span;
+} workload_t;
+
+typedef struct {
+  const workload_t* workload;
+  nrt_client_t* client;
+  uint64_t* latencies;
+  uint64_t accepted;
+} worker_t;
+
+static const char* attribute_keys[] = {
+    "http.method",  "http.url",      "http.status_code", "db.system",
+    "db.statement", "peer.hostname", "peer.port",        "error",
+    "thread.id",    "component",     "span.kind",        "user.id",
+    "region",       "host",          "version",          "retries"};
+
+#define ATTRIBUTE_KEYS (sizeof(attribute_keys) / sizeof(attribute_keys[0]))
+
+/*
+ * Build a span with the given number of attributes, cycling through string,
+ * integer and boolean values.
+ */
+static nrt_span_t* build_span(int attributes) {
+  uint64_t high, low;
+  int i;
+
+  nrt_generate_trace_id(&high, &low);
+  nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+  nrt_span_set_name(span, "GET /api/users/{id}");
+  nrt_span_set_service_name(span, "bench-e2e");
+  nrt_span_set_parent_id_u64(span, nrt_generate_span_id());
+  nrt_span_set_duration_us(span, 1200);
+
+  nrt_attributes_t* attrs = nrt_attributes_new();
+  for (i = 0; i < attributes; i++) {
+    const char* key = attribute_keys[i % ATTRIBUTE_KEYS];
+    switch (i % 3) {
+      case 0:
+        nrt_attributes_set_string(attrs, key, "/api/users/12345?page=2");
+        break;
+      case 1:
+        nrt_attributes_set_int(attrs, key, 200 + i);
+        break;
+      default:
+        nrt_attributes_set_bool(attrs, key, i % 2);
+        break;
+    }
+  }
+  nrt_span_set_attributes(span, &attrs);
+  return span;
+}
+
+/*
+ * Build batches through the C API and time each call to nrt_client_enqueue().
+ */
+static void run_worker(void* arg) {
+  worker_t* worker = (worker_t*)arg;
+  const workload_t* workload = worker->workload;
+  int b, i;
+
+  for (b = 0; b < workload->batches_per_thread; b++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+    for (i = 0; i < workload->spans_per_batch; i++) {
+      nrt_span_t* span = build_span(workload->attributes_per_span);
+      nrt_span_batch_record(batch, &span);
+    }
+
+    uint64_t start = bench_now_ns();
+    nrt_send_result_t result = nrt_client_enqueue(worker->client, &batch);
+    worker->latencies[b] = bench_now_ns() - start;
+    if (result <= NRT_SEND_SPOOLED) {
+      worker->accepted++;
+    }
+  }
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [threads] [batches per thread] [spans per batch] "
+          "[attributes per span] [latency ms] [429 every] [503 every]\n",
+          name);
+  exit(1);
+}
+
+static int arg(int argc, char** argv, int i, int fallback) {
+  return argc > i ? atoi(argv[i]) : fallback;
+}
+
+/*
+ * Drive the full C API against a local mock of the trace endpoint: build
+ * spans with attributes, batch them, send them from several threads and shut
+ * down the client. Report throughput, the latency of sending, CPU time per
+ * span and peak memory, and what the mock received.
+ */
+int main(int argc, char** argv) {
+  workload_t workload;
+  worker_t workers[BENCH_THREADS_MAX];
+  void* args[BENCH_THREADS_MAX];
+  static mock_ingest_t mock;
+  uint64_t start_ns, start_cpu, elapsed_ns, cpu_ns, spans;
+  uint64_t accepted = 0;
+  uint64_t* latencies;
+  int i;
+
+  if (argc > 1 && argv[1][0] == '-') {
+    usage(argv[0]);
+  }
+  workload.threads = arg(argc, argv, 1, 4);
+  workload.batches_per_thread = arg(argc, argv, 2, 200);
+  workload.spans_per_batch = arg(argc, argv, 3, 100);
+  workload.attributes_per_span = arg(argc, argv, 4, 8);
+  mock.latency_ms = arg(argc, argv, 5, 0);
+  mock.status_429_every = arg(argc, argv, 6, 0);
+  mock.status_503_every = arg(argc, argv, 7, 0);
+  if (workload.threads < 1 || workload.threads > BENCH_THREADS_MAX ||
+      workload.batches_per_thread < 1) {
+    usage(argv[0]);
+  }
+
+  if (!mock_ingest_start(&mock)) {
+    fprintf(stderr, "unable to start the mock ingest endpoint\n");
+    return 1;
+  }
+
+  nrt_client_config_t* cfg = nrt_client_config_new("bench");
+  nrt_client_config_set_endpoint_traces(cfg, "127.0.0.1", mock.port);
+  nrt_client_config_set_backoff_factor(cfg, 10);
+  nrt_client_config_set_retries_max(cfg, 3);
+  nrt_client_config_set_backpressure(cfg, NRT_BACKPRESSURE_BLOCK, 60000);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  if (!client) {
+    fprintf(stderr, "unable to create a client\n");
+    return 1;
+  }
+
+  latencies = (uint64_t*)malloc(sizeof(uint64_t) * workload.threads *
+                                workload.batches_per_thread);
+  for (i = 0; i < workload.threads; i++) {
+    workers[i].workload = &workload;
+    workers[i].client = client;
+    workers[i].latencies = latencies + i * workload.batches_per_thread;
+    workers[i].accepted = 0;
+    args[i] = &workers[i];
+  }
+
+  start_ns = bench_now_ns();
+  start_cpu = bench_cpu_ns();
+  bench_run_threads(workload.threads, run_worker, args);
+  nrt_client_shutdown(&client);
+  elapsed_ns = bench_now_ns() - start_ns;
+  cpu_ns = bench_cpu_ns() - start_cpu;
+
+  for (i = 0; i < workload.threads; i++) {
+    accepted += workers[i].accepted;
+  }
+  spans = (uint64_t)workload.threads * workload.batches_per_thread *
+          workload.spans_per_batch;
+
+  printf("%d threads, %d spans per batch, %d attributes per span\n",
+         workload.threads, workload.spans_per_batch,
+         workload.attributes_per_span);
+  bench_report("spans, build to shutdown", spans, elapsed_ns);
+  bench_report_latencies("nrt_client_enqueue", latencies,
+                         (size_t)workload.threads *
+                             workload.batches_per_thread);
+  printf("%-40s %10.1f ns/span %12llu KB peak RSS\n", "cpu",
+         (double)cpu_ns / spans, (unsigned long long)bench_peak_rss_kb());
+  printf("%-40s %12llu of %llu batches\n", "accepted",
+         (unsigned long long)accepted,
+         (unsigned long long)workload.threads * workload.batches_per_thread);
+
+  bench_mutex_lock(&mock.mutex);
+  printf("%-40s %12llu spans %8llu payloads %10llu bytes\n", "mock received",
+         (unsigned long long)mock.spans_received,
+         (unsigned long long)mock.payloads_accepted,
+         (unsigned long long)mock.bytes_received);
+  printf("%-40s %12llu requests %6llu 429 %6llu 503 %6llu TLS\n", "",
+         (unsigned long long)mock.requests,
+         (unsigned long long)mock.responses_429,
+         (unsigned long long)mock.responses_503,
+         (unsigned long long)mock.tls_connections);
+  bench_mutex_unlock(&mock.mutex);
+
+  mock_ingest_stop(&mock);
+  free(latencies);
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "alloc_count.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ROUNDS 100000
+
+static nrt_span_t* spans[ROUNDS];
+static nrt_attributes_t* attributes[ROUNDS];
+
+/*
+ * Measure the loop body on every index, with the time and the allocations of
+ * all rounds attributed to `name`.
+ */
+#define MEASURE(name, body)                                    \
+  do {                                                         \
+    alloc_count_t allocs = alloc_count_now();                  \
+    uint64_t start = bench_now_ns();                           \
+    for (i = 0; i < ROUNDS; i++) {                             \
+      body;                                                    \
+    }                                                          \
+    bench_report_allocs(name, ROUNDS, bench_now_ns() - start,  \
+                        allocs);                               \
+  } while (0)
+
+static void new_spans(void) {
+  int i;
+  for (i = 0; i < ROUNDS; i++) {
+    spans[i] = nrt_span_new_u64(i + 1, 1, 2, 0);
+  }
+}
+
+static void destroy_spans(void) {
+  int i;
+  for (i = 0; i < ROUNDS; i++) {
+    nrt_span_destroy(&spans[i]);
+  }
+}
+
+static void new_attributes(void) {
+  int i;
+  for (i = 0; i < ROUNDS; i++) {
+    attributes[i] = nrt_attributes_new();
+  }
+}
+
+static void destroy_attributes(void) {
+  int i;
+  for (i = 0; i < ROUNDS; i++) {
+    nrt_attributes_destroy(&attributes[i]);
+  }
+}
+
+/*
+ * Span construction and destruction.
+ */
+static void bench_span_lifecycle(void) {
+  int i;
+
+  MEASURE("nrt_span_new",
+          spans[i] = nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0));
+  MEASURE("nrt_span_destroy", nrt_span_destroy(&spans[i]));
+  MEASURE("nrt_span_new_u64", spans[i] = nrt_span_new_u64(i + 1, 1, 2, 0));
+  destroy_spans();
+}
+
+/*
+ * Each span setter, called once on a fresh span.
+ */
+static void bench_span_setters(void) {
+  nrt_time_t now = 1590000000000;
+  int i;
+
+#define MEASURE_SETTER(name, call) \
+  new_spans();                     \
+  MEASURE(name, call);             \
+  destroy_spans()
+
+  MEASURE_SETTER("nrt_span_set_id",
+                 nrt_span_set_id(spans[i], "e9f54a2c322d7578"));
+  MEASURE_SETTER("nrt_span_set_id_u64", nrt_span_set_id_u64(spans[i], i + 1));
+  MEASURE_SETTER("nrt_span_set_trace_id",
+                 nrt_span_set_trace_id(spans[i], "1b1bf29379951c1d"));
+  MEASURE_SETTER("nrt_span_set_trace_id_u128",
+                 nrt_span_set_trace_id_u128(spans[i], 1, 2));
+  MEASURE_SETTER("nrt_span_set_timestamp",
+                 nrt_span_set_timestamp(spans[i], now));
+  MEASURE_SETTER("nrt_span_set_name",
+                 nrt_span_set_name(spans[i], "GET /api/users/{id}"));
+  MEASURE_SETTER("nrt_span_set_service_name",
+                 nrt_span_set_service_name(spans[i], "checkout-service"));
+  MEASURE_SETTER("nrt_span_set_parent_id",
+                 nrt_span_set_parent_id(spans[i], "a7d2b3e1c9f04d68"));
+  MEASURE_SETTER("nrt_span_set_parent_id_u64",
+                 nrt_span_set_parent_id_u64(spans[i], i + 1));
+  MEASURE_SETTER("nrt_span_set_duration",
+                 nrt_span_set_duration(spans[i], 12));
+  MEASURE_SETTER("nrt_span_set_duration_us",
+                 nrt_span_set_duration_us(spans[i], 1200));
+  MEASURE_SETTER("nrt_span_start", nrt_span_start(spans[i]));
+  new_spans();
+  for (i = 0; i < ROUNDS; i++) {
+    nrt_span_start(spans[i]);
+  }
+  MEASURE("nrt_span_end", nrt_span_end(spans[i]));
+  destroy_spans();
+
+#undef MEASURE_SETTER
+}
+
+/*
+ * Each attribute setter, called once on a fresh collection, and moving a
+ * collection of attributes into a span.
+ */
+static void bench_attributes(void) {
+  int i;
+
+  MEASURE("nrt_attributes_new", attributes[i] = nrt_attributes_new());
+  MEASURE("nrt_attributes_destroy", nrt_attributes_destroy(&attributes[i]));
+
+#define MEASURE_SETTER(name, call) \
+  new_attributes();                \
+  MEASURE(name, call);             \
+  destroy_attributes()
+
+  MEASURE_SETTER("nrt_attributes_set_int",
+                 nrt_attributes_set_int(attributes[i], "http.status", 200));
+  MEASURE_SETTER("nrt_attributes_set_uint",
+                 nrt_attributes_set_uint(attributes[i], "db.rows", 42));
+  MEASURE_SETTER("nrt_attributes_set_double",
+                 nrt_attributes_set_double(attributes[i], "load", 0.75));
+  MEASURE_SETTER("nrt_attributes_set_string",
+                 nrt_attributes_set_string(attributes[i], "http.method",
+                                           "GET"));
+  MEASURE_SETTER("nrt_attributes_set_bool",
+                 nrt_attributes_set_bool(attributes[i], "error", false));
+
+#undef MEASURE_SETTER
+
+  new_spans();
+  new_attributes();
+  for (i = 0; i < ROUNDS; i++) {
+    nrt_attributes_set_string(attributes[i], "http.method", "GET");
+    nrt_attributes_set_int(attributes[i], "http.status", 200);
+  }
+  MEASURE("nrt_span_set_attributes (2)",
+          nrt_span_set_attributes(spans[i], &attributes[i]));
+  destroy_spans();
+}
+
+/*
+ * Creating a span with a name, service name and three attributes, once from
+ * scratch and once from a template holding them.
+ */
+static void bench_template(void) {
+  nrt_attributes_t* attrs = nrt_attributes_new();
+  nrt_span_template_t* tmpl;
+  int i;
+
+  nrt_attributes_set_string(attrs, "http.method", "GET");
+  nrt_attributes_set_string(attrs, "http.route", "/api/users/{id}");
+  nrt_attributes_set_int(attrs, "http.status_code", 200);
+  tmpl = nrt_span_template_new("GET /api/users/{id}", "checkout-service",
+                               &attrs);
+
+  MEASURE("span with name and 3 attributes", {
+    nrt_attributes_t* span_attrs = nrt_attributes_new();
+    spans[i] = nrt_span_new_u64(i + 1, 1, 2, 0);
+    nrt_span_set_name(spans[i], "GET /api/users/{id}");
+    nrt_span_set_service_name(spans[i], "checkout-service");
+    nrt_attributes_set_string(span_attrs, "http.method", "GET");
+    nrt_attributes_set_string(span_attrs, "http.route", "/api/users/{id}");
+    nrt_attributes_set_int(span_attrs, "http.status_code", 200);
+    nrt_span_set_attributes(spans[i], &span_attrs);
+  });
+  destroy_spans();
+  MEASURE("nrt_span_from_template_u64",
+          spans[i] = nrt_span_from_template_u64(tmpl, i + 1, 1, 2, 0));
+  destroy_spans();
+  nrt_span_template_destroy(&tmpl);
+}
+
+/*
+ * Recording spans into a batch and destroying the batch with its spans.
+ */
+static void bench_batch(void) {
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  alloc_count_t allocs;
+  uint64_t start;
+  int i;
+
+  new_spans();
+  MEASURE("nrt_span_batch_record", nrt_span_batch_record(batch, &spans[i]));
+
+  allocs = alloc_count_now();
+  start = bench_now_ns();
+  nrt_span_batch_destroy(&batch);
+  bench_report_allocs("nrt_span_batch_destroy (per span)", ROUNDS,
+                      bench_now_ns() - start, allocs);
+}
+
+/*
+ * Measure the cost of each C entry point on the span hot path, with the
+ * number of allocations and bytes allocated per call.
+ */
+int main() {
+  if (!ALLOC_COUNT_ENABLED) {
+    printf("allocation counting isn't supported on this platform\n");
+  }
+  bench_span_lifecycle();
+  bench_span_setters();
+  bench_attributes();
+  bench_template();
+  bench_batch();
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define UPDATES_PER_THREAD 1000000
+
+static nrt_counter_t* counter;
+static nrt_gauge_t* gauge;
+static nrt_summary_t* summary;
+
+static void on_metrics(const nrt_metric_t* metrics,
+                       size_t len,
+                       void* user_data) {
+  (void)metrics;
+  *(size_t*)user_data += len;
+}
+
+static void add_to_counter(void* arg) {
+  int i;
+
+  (void)arg;
+  for (i = 0; i < UPDATES_PER_THREAD; i++) {
+    nrt_counter_add(counter, 1);
+  }
+}
+
+static void set_gauge(void* arg) {
+  int i;
+
+  (void)arg;
+  for (i = 0; i < UPDATES_PER_THREAD; i++) {
+    nrt_gauge_set(gauge, i);
+  }
+}
+
+static void record_to_summary(void* arg) {
+  int i;
+
+  (void)arg;
+  for (i = 0; i < UPDATES_PER_THREAD; i++) {
+    nrt_summary_record(summary, i % 1000);
+  }
+}
+
+static void run(const char* kind, void (*fn)(void*), int threads) {
+  void* args[BENCH_THREADS_MAX] = {0};
+  char name[64];
+  uint64_t start;
+
+  start = bench_now_ns();
+  bench_run_threads(threads, fn, args);
+  snprintf(name, sizeof(name), "%s, %d threads", kind, threads);
+  bench_report(name, (uint64_t)threads * UPDATES_PER_THREAD,
+               bench_now_ns() - start);
+}
+
+/*
+ * Update one counter, gauge and summary from an increasing number of threads
+ * at once, harvesting every 100 milliseconds.
+ */
+int main() {
+  size_t harvested = 0;
+  int threads;
+
+  nrt_client_config_t* cfg = nrt_client_config_new("bench");
+  nrt_client_config_set_metrics(cfg, 100, on_metrics, &harvested);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  counter = nrt_counter_new(client, "requests");
+  gauge = nrt_gauge_new(client, "queue.length");
+  summary = nrt_summary_new(client, "response.size");
+
+  for (threads = 1; threads <= BENCH_THREADS_MAX; threads *= 4) {
+    run("nrt_counter_add", add_to_counter, threads);
+    run("nrt_gauge_set", set_gauge, threads);
+    run("nrt_summary_record", record_to_summary, threads);
+  }
+
+  nrt_counter_destroy(&counter);
+  nrt_gauge_destroy(&gauge);
+  nrt_summary_destroy(&summary);
+  nrt_client_shutdown(&client);
+  printf("metrics harvested %zu\n", harvested);
+}
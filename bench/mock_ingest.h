@@ -0,0 +1,391 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * A local mock of the trace ingest endpoint for end-to-end benchmarks.
+ *
+ * The mock speaks plain HTTP/1.1 with keep-alive. It accepts POST requests,
+ * decompresses gzip payloads, counts payloads, bytes and spans, and answers
+ * with 202. Latency, 429 and 503 responses can be injected. Each connection
+ * is served by a thread of its own.
+ *
+ * Clients connecting with TLS are counted and disconnected, since the mock
+ * has no certificate to offer.
+ */
+#ifndef NEWRELIC_TELEMETRY_SDK_MOCK_INGEST
+#define NEWRELIC_TELEMETRY_SDK_MOCK_INGEST
+
+#ifdef OS_WINDOWS
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+#endif
+
+#include "bench.h"
+#include <string.h>
+
+#ifdef OS_WINDOWS
+typedef SOCKET mock_socket_t;
+#define mock_close closesocket
+#else
+typedef int mock_socket_t;
+#define mock_close close
+#endif
+
+/* Requests with larger payloads are answered with 413. */
+#define MOCK_INGEST_PAYLOAD_MAX (10 * 1024 * 1024)
+
+typedef struct {
+  /* Configuration, set before mock_ingest_start(). */
+
+  /* Delay before each response, in milliseconds. */
+  unsigned latency_ms;
+  /* Answer every n-th request with 429 Too Many Requests. Never if zero. */
+  unsigned status_429_every;
+  /* Answer every n-th request with 503 Service Unavailable. Never if zero. */
+  unsigned status_503_every;
+
+  /* Counters, read them with the mutex held. */
+
+  uint64_t connections;
+  uint64_t tls_connections;
+  uint64_t requests;
+  uint64_t payloads_accepted;
+  uint64_t bytes_received;
+  uint64_t bytes_decompressed;
+  uint64_t spans_received;
+  uint64_t responses_429;
+  uint64_t responses_503;
+  bench_mutex_t mutex;
+
+  uint16_t port;
+  mock_socket_t listener;
+} mock_ingest_t;
+
+typedef struct {
+  mock_ingest_t* mock;
+  mock_socket_t socket;
+} mock_connection_t;
+
+/*
+ * Read until `len` bytes are buffered. Returns 0 if the connection was
+ * closed first.
+ */
+static int mock_fill(mock_socket_t s,
+                     char** buf,
+                     size_t* cap,
+                     size_t* have,
+                     size_t len) {
+  while (*have < len) {
+    if (len > *cap) {
+      *cap = len * 2;
+      *buf = (char*)realloc(*buf, *cap);
+    }
+    int n = recv(s, *buf + *have, (int)(*cap - *have), 0);
+    if (n <= 0) {
+      return 0;
+    }
+    *have += n;
+  }
+  return 1;
+}
+
+/*
+ * Return the value of a header, or NULL. Header names are compared
+ * case-insensitively.
+ */
+static const char* mock_header(const char* headers, const char* name) {
+  size_t len = strlen(name);
+  const char* line = strstr(headers, "\r\n");
+
+  while (line && line[2] != '\r') {
+    const char* p = line + 2;
+    size_t i;
+    for (i = 0; i < len; i++) {
+      char c = p[i];
+      if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+      }
+      if (c != name[i]) {
+        break;
+      }
+    }
+    if (i == len && p[len] == ':') {
+      p += len + 1;
+      while (*p == ' ') {
+        p++;
+      }
+      return p;
+    }
+    line = strstr(p, "\r\n");
+  }
+  return NULL;
+}
+
+/*
+ * Count the spans in a JSON payload by their required trace.id field.
+ */
+static uint64_t mock_count_spans(const char* json, size_t len) {
+  static const char key[] = "\"trace.id\"";
+  uint64_t count = 0;
+  size_t i;
+
+  for (i = 0; i + sizeof(key) - 1 <= len; i++) {
+    if (json[i] == '"' && memcmp(json + i, key, sizeof(key) - 1) == 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/*
+ * Decompress a gzip payload and count its spans. Returns the number of
+ * decompressed bytes, or zero if the payload isn't valid.
+ */
+static uint64_t mock_inflate(const char* body, size_t len, uint64_t* spans) {
+#ifdef OS_WINDOWS
+  /* Without zlib, spans can't be counted. */
+  (void)body;
+  (void)spans;
+  return len;
+#else
+  size_t cap = len * 8 + 1024;
+  char* out = (char*)malloc(cap);
+  z_stream stream;
+  int status;
+
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+    free(out);
+    return 0;
+  }
+  stream.next_in = (Bytef*)body;
+  stream.avail_in = (uInt)len;
+  do {
+    if (stream.total_out == cap) {
+      cap *= 2;
+      out = (char*)realloc(out, cap);
+    }
+    stream.next_out = (Bytef*)out + stream.total_out;
+    stream.avail_out = (uInt)(cap - stream.total_out);
+    status = inflate(&stream, Z_NO_FLUSH);
+  } while (status == Z_OK);
+
+  uint64_t total = status == Z_STREAM_END ? stream.total_out : 0;
+  *spans = mock_count_spans(out, total);
+  inflateEnd(&stream);
+  free(out);
+  return total;
+#endif
+}
+
+static void mock_respond(mock_socket_t s, const char* status) {
+  char response[256];
+  int len = snprintf(response, sizeof(response),
+                     "HTTP/1.1 %s\r\nContent-Length: 0\r\nRetry-After: 0\r\n"
+                     "Connection: keep-alive\r\n\r\n",
+                     status);
+  send(s, response, len, 0);
+}
+
+/*
+ * Serve requests on a connection until the client closes it.
+ */
+static void mock_serve(void* arg) {
+  mock_connection_t* conn = (mock_connection_t*)arg;
+  mock_ingest_t* mock = conn->mock;
+  size_t cap = 64 * 1024;
+  size_t have = 0;
+  char* buf = (char*)malloc(cap);
+
+  for (;;) {
+    char* end = NULL;
+    size_t header_len, body_len;
+    const char* value;
+    int gzip;
+    uint64_t request, spans = 0, decompressed = 0;
+    const char* status = "202 Accepted";
+
+    /* Read the request head. */
+    while (!end) {
+      if (have > 0 && (unsigned char)buf[0] == 0x16) {
+        bench_mutex_lock(&mock->mutex);
+        mock->tls_connections++;
+        bench_mutex_unlock(&mock->mutex);
+        goto done;
+      }
+      if (have == cap) {
+        goto done;
+      }
+      buf[have] = '\0';
+      end = have > 0 ? strstr(buf, "\r\n\r\n") : NULL;
+      if (!end && !mock_fill(conn->socket, &buf, &cap, &have, have + 1)) {
+        goto done;
+      }
+    }
+    header_len = end + 4 - buf;
+    end[2] = '\0';
+    value = mock_header(buf, "content-length");
+    body_len = value ? strtoul(value, NULL, 10) : 0;
+    value = mock_header(buf, "content-encoding");
+    gzip = value && strncmp(value, "gzip", 4) == 0;
+
+    if (body_len > MOCK_INGEST_PAYLOAD_MAX) {
+      mock_respond(conn->socket, "413 Payload Too Large");
+      goto done;
+    }
+    if (!mock_fill(conn->socket, &buf, &cap, &have, header_len + body_len)) {
+      goto done;
+    }
+    if (gzip) {
+      decompressed = mock_inflate(buf + header_len, body_len, &spans);
+    } else {
+      decompressed = body_len;
+      spans = mock_count_spans(buf + header_len, body_len);
+    }
+
+    bench_mutex_lock(&mock->mutex);
+    request = ++mock->requests;
+    mock->bytes_received += body_len;
+    if (mock->status_429_every && request % mock->status_429_every == 0) {
+      status = "429 Too Many Requests";
+      mock->responses_429++;
+    } else if (mock->status_503_every &&
+               request % mock->status_503_every == 0) {
+      status = "503 Service Unavailable";
+      mock->responses_503++;
+    } else {
+      mock->payloads_accepted++;
+      mock->bytes_decompressed += decompressed;
+      mock->spans_received += spans;
+    }
+    bench_mutex_unlock(&mock->mutex);
+
+    if (mock->latency_ms) {
+      bench_sleep_ms(mock->latency_ms);
+    }
+    mock_respond(conn->socket, status);
+
+    /* Keep what was read of the next request. */
+    memmove(buf, buf + header_len + body_len, have - header_len - body_len);
+    have -= header_len + body_len;
+  }
+
+done:
+  mock_close(conn->socket);
+  free(buf);
+  free(conn);
+}
+
+#ifdef OS_WINDOWS
+static DWORD WINAPI mock_serve_main(LPVOID arg) {
+  mock_serve(arg);
+  return 0;
+}
+#else
+static void* mock_serve_main(void* arg) {
+  mock_serve(arg);
+  return NULL;
+}
+#endif
+
+/*
+ * Accept connections until the listening socket is closed.
+ */
+static void mock_accept(void* arg) {
+  mock_ingest_t* mock = (mock_ingest_t*)arg;
+
+  for (;;) {
+    mock_socket_t s = accept(mock->listener, NULL, NULL);
+#ifdef OS_WINDOWS
+    if (s == INVALID_SOCKET) {
+      return;
+    }
+#else
+    if (s < 0) {
+      return;
+    }
+#endif
+    mock_connection_t* conn =
+        (mock_connection_t*)malloc(sizeof(mock_connection_t));
+    conn->mock = mock;
+    conn->socket = s;
+    bench_mutex_lock(&mock->mutex);
+    mock->connections++;
+    bench_mutex_unlock(&mock->mutex);
+
+#ifdef OS_WINDOWS
+    CloseHandle(CreateThread(NULL, 0, mock_serve_main, conn, 0, NULL));
+#else
+    pthread_t thread;
+    pthread_create(&thread, NULL, mock_serve_main, conn);
+    pthread_detach(thread);
+#endif
+  }
+}
+
+#ifdef OS_WINDOWS
+static DWORD WINAPI mock_accept_main(LPVOID arg) {
+  mock_accept(arg);
+  return 0;
+}
+#else
+static void* mock_accept_main(void* arg) {
+  mock_accept(arg);
+  return NULL;
+}
+#endif
+
+/*
+ * Start listening on an unused port on the loopback interface. The port is
+ * stored in `mock->port`. Returns 0 on failure.
+ */
+static inline int mock_ingest_start(mock_ingest_t* mock) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+
+#ifdef OS_WINDOWS
+  WSADATA wsa;
+  WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+  bench_mutex_init(&mock->mutex);
+  mock->listener = socket(AF_INET, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(mock->listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(mock->listener, 64) != 0) {
+    return 0;
+  }
+  getsockname(mock->listener, (struct sockaddr*)&addr, &len);
+  mock->port = ntohs(addr.sin_port);
+
+#ifdef OS_WINDOWS
+  CloseHandle(CreateThread(NULL, 0, mock_accept_main, mock, 0, NULL));
+#else
+  pthread_t thread;
+  pthread_create(&thread, NULL, mock_accept_main, mock);
+  pthread_detach(thread);
+#endif
+  return 1;
+}
+
+/*
+ * Stop accepting connections. Open connections are served until the client
+ * closes them.
+ */
+static inline void mock_ingest_stop(mock_ingest_t* mock) {
+#ifndef OS_WINDOWS
+  shutdown(mock->listener, SHUT_RDWR);
+#endif
+  mock_close(mock->listener);
+}
+
+#endif /* NEWRELIC_TELEMETRY_SDK_MOCK_INGEST */
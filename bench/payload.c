@@ -0,0 +1,68 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static nrt_span_batch_t* new_batch(int spans) {
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  uint64_t high, low;
+  int i;
+
+  for (i = 0; i < spans; i++) {
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, "GET /api/users");
+    nrt_span_set_service_name(span, "bench");
+    nrt_span_set_duration_us(span, 1200);
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_string(attrs, "http.method", "GET");
+    nrt_attributes_set_int(attrs, "http.status_code", 200);
+    nrt_span_set_attributes(span, &attrs);
+    nrt_span_batch_record(batch, &span);
+  }
+  return batch;
+}
+
+/*
+ * Send one batch of the given size and time it from nrt_client_enqueue()
+ * until the sender thread handed all of its payloads to the SDK.
+ */
+static void run(int spans) {
+  nrt_client_stats_t stats;
+  uint64_t start, elapsed;
+  char name[64];
+
+  nrt_client_t* client = bench_client_new();
+  nrt_span_batch_t* batch = new_batch(spans);
+
+  start = bench_now_ns();
+  nrt_client_enqueue(client, &batch);
+  do {
+    bench_sleep_ms(1);
+    nrt_client_get_stats(client, &stats);
+  } while (stats.batches_sent == 0);
+  elapsed = bench_now_ns() - start;
+
+  snprintf(name, sizeof(name), "send %d spans", spans);
+  bench_report(name, spans, elapsed);
+  printf("%-40s %12llu payloads %8llu KB peak RSS\n", "",
+         (unsigned long long)stats.payloads_sent,
+         (unsigned long long)bench_peak_rss_kb());
+  nrt_client_shutdown(&client);
+}
+
+/*
+ * Measure throughput and peak memory of sending batches of increasing size.
+ * Peak RSS only grows over the lifetime of the process, so batches are sent
+ * from smallest to largest and each figure includes the earlier runs.
+ */
+int main() {
+  run(1000);
+  run(100000);
+  run(1000000);
+}
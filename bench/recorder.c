@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCH_SIZE 1000
+#define SPANS_PER_THREAD 100000
+
+static nrt_recorder_t* recorder;
+static nrt_client_t* client;
+static nrt_span_batch_t* batch;
+static int batch_len;
+static bench_mutex_t batch_mutex;
+
+static nrt_span_t* new_span() {
+  nrt_span_t* span = nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+  nrt_span_set_name(span, "/index.html");
+  nrt_span_set_duration(span, 12);
+  return span;
+}
+
+/*
+ * Record spans via a span recorder.
+ */
+static void record_spans(void* arg) {
+  uint64_t* dropped = (uint64_t*)arg;
+  int i;
+
+  for (i = 0; i < SPANS_PER_THREAD; i++) {
+    nrt_span_t* span = new_span();
+    if (!nrt_recorder_record(recorder, &span)) {
+      (*dropped)++;
+    }
+  }
+}
+
+/*
+ * Record spans into one shared batch protected by a mutex, sending the batch
+ * when it is full.
+ */
+static void record_spans_locked(void* arg) {
+  int i;
+
+  (void)arg;
+  for (i = 0; i < SPANS_PER_THREAD; i++) {
+    nrt_span_t* span = new_span();
+    bench_mutex_lock(&batch_mutex);
+    nrt_span_batch_record(batch, &span);
+    if (++batch_len == BATCH_SIZE) {
+      nrt_client_send(client, &batch);
+      batch = nrt_span_batch_new();
+      batch_len = 0;
+    }
+    bench_mutex_unlock(&batch_mutex);
+  }
+}
+
+/*
+ * Compare recording spans from an increasing number of threads via a span
+ * recorder with recording them into one batch protected by a mutex.
+ */
+int main() {
+  uint64_t dropped[BENCH_THREADS_MAX];
+  void* args[BENCH_THREADS_MAX];
+  char name[64];
+  uint64_t start, total;
+  int threads, i;
+
+  for (threads = 1; threads <= BENCH_THREADS_MAX; threads *= 2) {
+    nrt_client_t* recorder_client = bench_client_new();
+    recorder = nrt_recorder_new(&recorder_client, BATCH_SIZE, 1000);
+
+    for (i = 0; i < threads; i++) {
+      dropped[i] = 0;
+      args[i] = &dropped[i];
+    }
+
+    start = bench_now_ns();
+    bench_run_threads(threads, record_spans, args);
+    nrt_recorder_shutdown(&recorder);
+    snprintf(name, sizeof(name), "recorder, %d threads", threads);
+    bench_report(name, (uint64_t)threads * SPANS_PER_THREAD,
+                 bench_now_ns() - start);
+
+    total = 0;
+    for (i = 0; i < threads; i++) {
+      total += dropped[i];
+    }
+    printf("  dropped %llu\n", (unsigned long long)total);
+
+    client = bench_client_new();
+    batch = nrt_span_batch_new();
+    batch_len = 0;
+    bench_mutex_init(&batch_mutex);
+
+    start = bench_now_ns();
+    bench_run_threads(threads, record_spans_locked, args);
+    nrt_client_send(client, &batch);
+    nrt_client_shutdown(&client);
+    snprintf(name, sizeof(name), "mutex, %d threads", threads);
+    bench_report(name, (uint64_t)threads * SPANS_PER_THREAD,
+                 bench_now_ns() - start);
+
+    bench_mutex_destroy(&batch_mutex);
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCH_SIZE 1000
+#define ROUNDS 200
+
+static nrt_client_t* new_client(double ratio) {
+  nrt_client_config_t* cfg = bench_client_config_new();
+  if (ratio < 1.0) {
+    nrt_client_config_set_sampling_ratio(cfg, ratio);
+  }
+  return nrt_client_new(&cfg);
+}
+
+/*
+ * Build spans with attributes and send them. If `check_first` is set, ask the
+ * client for the sampling decision before building a span.
+ */
+static void run(const char* name, double ratio, bool check_first) {
+  nrt_client_t* client = new_client(ratio);
+  uint64_t start = bench_now_ns();
+  uint64_t high, low;
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+    for (i = 0; i < BATCH_SIZE; i++) {
+      nrt_generate_trace_id(&high, &low);
+      if (check_first && !nrt_client_sample_trace_u128(client, high, low)) {
+        continue;
+      }
+
+      nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+      nrt_span_set_name(span, "SELECT users");
+      nrt_attributes_t* attrs = nrt_attributes_new();
+      nrt_attributes_set_string(attrs, "db.system", "postgresql");
+      nrt_attributes_set_string(attrs, "db.statement",
+                                "SELECT * FROM users WHERE id = ?");
+      nrt_attributes_set_int(attrs, "db.rows", 1);
+      nrt_span_set_attributes(span, &attrs);
+      nrt_span_batch_record(batch, &span);
+    }
+    nrt_client_send(client, &batch);
+  }
+
+  bench_report(name, ROUNDS * BATCH_SIZE, bench_now_ns() - start);
+  nrt_client_shutdown(&client);
+}
+
+/*
+ * Compare sending all spans with sampling 10% of traces, when spans are
+ * dropped by the client and when they are never built.
+ */
+int main() {
+  run("no sampling", 1.0, false);
+  run("10% sampled in client", 0.1, false);
+  run("10% sampled before building", 0.1, true);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CALLS_PER_THREAD 2000
+#define SPANS_PER_BATCH 50
+#define QUEUE_MAX 16
+
+typedef struct {
+  uint64_t* latencies;
+  uint64_t results[NRT_SEND_INVALID + 1];
+} worker_t;
+
+static nrt_client_t* client;
+
+/*
+ * Build batches and time each call to nrt_client_enqueue().
+ */
+static void send_batches(void* arg) {
+  worker_t* worker = (worker_t*)arg;
+  uint64_t high, low, start;
+  int call, i;
+
+  for (call = 0; call < CALLS_PER_THREAD; call++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+    for (i = 0; i < SPANS_PER_BATCH; i++) {
+      nrt_generate_trace_id(&high, &low);
+      nrt_span_t* span =
+          nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+      nrt_span_set_name(span, "GET /api/users");
+      nrt_span_set_duration_us(span, 1200);
+      nrt_attributes_t* attrs = nrt_attributes_new();
+      nrt_attributes_set_string(attrs, "http.method", "GET");
+      nrt_attributes_set_int(attrs, "http.status_code", 200);
+      nrt_span_set_attributes(span, &attrs);
+      nrt_span_batch_record(batch, &span);
+    }
+
+    start = bench_now_ns();
+    nrt_send_result_t result = nrt_client_enqueue(client, &batch);
+    worker->latencies[call] = bench_now_ns() - start;
+    worker->results[result]++;
+  }
+}
+
+static nrt_client_t* new_client(nrt_backpressure_t policy) {
+  nrt_client_config_t* cfg = bench_client_config_new();
+  nrt_client_config_set_queue_max(cfg, QUEUE_MAX);
+  nrt_client_config_set_backpressure(cfg, policy, 10);
+  return nrt_client_new(&cfg);
+}
+
+/*
+ * Hammer nrt_client_enqueue() from an increasing number of threads with a
+ * small queue, so the sender thread converting batches can't keep up, and
+ * report the latency of the call for each backpressure policy.
+ */
+int main() {
+  static const struct {
+    nrt_backpressure_t policy;
+    const char* name;
+  } policies[] = {
+      {NRT_BACKPRESSURE_DROP_NEWEST, "drop newest"},
+      {NRT_BACKPRESSURE_DROP_OLDEST, "drop oldest"},
+      {NRT_BACKPRESSURE_BLOCK, "block 10 ms"},
+      {NRT_BACKPRESSURE_SAMPLE, "sample"},
+  };
+  static worker_t workers[BENCH_THREADS_MAX];
+  void* args[BENCH_THREADS_MAX];
+  uint64_t* latencies;
+  char name[64];
+  size_t p;
+  int threads, i, r;
+
+  latencies = malloc(sizeof(uint64_t) * BENCH_THREADS_MAX * CALLS_PER_THREAD);
+  for (p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+    for (threads = 1; threads <= BENCH_THREADS_MAX; threads *= 4) {
+      uint64_t results[NRT_SEND_INVALID + 1] = {0};
+
+      client = new_client(policies[p].policy);
+      for (i = 0; i < threads; i++) {
+        memset(&workers[i], 0, sizeof(worker_t));
+        workers[i].latencies = &latencies[i * CALLS_PER_THREAD];
+        args[i] = &workers[i];
+      }
+      bench_run_threads(threads, send_batches, args);
+      nrt_client_shutdown(&client);
+
+      for (i = 0; i < threads; i++) {
+        for (r = 0; r <= NRT_SEND_INVALID; r++) {
+          results[r] += workers[i].results[r];
+        }
+      }
+      snprintf(name, sizeof(name), "%s, %d threads", policies[p].name,
+               threads);
+      bench_report_latencies(name, latencies,
+                             (size_t)threads * CALLS_PER_THREAD);
+      printf("  queued %llu, dropped oldest %llu, sampled %llu, dropped %llu, "
+             "timeout %llu\n",
+             (unsigned long long)results[NRT_SEND_QUEUED],
+             (unsigned long long)results[NRT_SEND_QUEUED_DROPPED_OLDEST],
+             (unsigned long long)results[NRT_SEND_QUEUED_SAMPLED],
+             (unsigned long long)results[NRT_SEND_DROPPED],
+             (unsigned long long)results[NRT_SEND_TIMEOUT]);
+    }
+  }
+  free(latencies);
+}
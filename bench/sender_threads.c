@@ -0,0 +1,74 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCHES 2000
+#define SPANS_PER_BATCH 100
+
+static nrt_span_batch_t* new_batch(void) {
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  uint64_t high, low;
+  int i;
+
+  for (i = 0; i < SPANS_PER_BATCH; i++) {
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, "GET /api/users");
+    nrt_span_set_duration_us(span, 1200);
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_string(attrs, "http.method", "GET");
+    nrt_attributes_set_int(attrs, "http.status_code", 200);
+    nrt_span_set_attributes(span, &attrs);
+    nrt_span_batch_record(batch, &span);
+  }
+  return batch;
+}
+
+/*
+ * Queue batches as fast as the sender threads take them, and time how long it
+ * takes until all of them were handed to the SDK.
+ */
+static void run(size_t threads) {
+  nrt_client_stats_t stats;
+  uint64_t start;
+  char name[64];
+  int i;
+
+  nrt_client_config_t* cfg = bench_client_config_new();
+  nrt_client_config_set_queue_max(cfg, 64);
+  nrt_client_config_set_backpressure(cfg, NRT_BACKPRESSURE_BLOCK, 10000);
+  nrt_client_config_set_sender_threads(cfg, threads);
+  nrt_client_t* client = nrt_client_new(&cfg);
+
+  start = bench_now_ns();
+  for (i = 0; i < BATCHES; i++) {
+    nrt_span_batch_t* batch = new_batch();
+    nrt_client_enqueue(client, &batch);
+  }
+  do {
+    nrt_client_get_stats(client, &stats);
+  } while (stats.batches_sent < BATCHES);
+
+  snprintf(name, sizeof(name), "send spans, %d sender threads", (int)threads);
+  bench_report(name, (uint64_t)BATCHES * SPANS_PER_BATCH,
+               bench_now_ns() - start);
+  nrt_client_shutdown(&client);
+}
+
+/*
+ * Measure the span throughput of a client with an increasing number of
+ * sender threads. Spans are built on the calling thread, so the throughput
+ * levels off once the senders keep up with it.
+ */
+int main() {
+  run(1);
+  run(2);
+  run(4);
+  run(8);
+}
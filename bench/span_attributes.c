@@ -0,0 +1,58 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ATTRIBUTES 100
+#define ROUNDS 20000
+
+/*
+ * Build an attribute collection with the given number of string and int
+ * attributes and move it into a span.
+ */
+static void bench_attributes(int count) {
+  static char keys[MAX_ATTRIBUTES][32];
+  static char values[MAX_ATTRIBUTES][64];
+  char name[64];
+  uint64_t start;
+  int round, i;
+
+  for (i = 0; i < count; i++) {
+    snprintf(keys[i], sizeof(keys[i]), "custom.attribute.%d", i);
+    snprintf(values[i], sizeof(values[i]), "attribute value number %d", i);
+  }
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_t* span = nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+    nrt_attributes_t* attrs = nrt_attributes_new();
+
+    for (i = 0; i < count; i++) {
+      if (i % 2) {
+        nrt_attributes_set_int(attrs, keys[i], i);
+      } else {
+        nrt_attributes_set_string(attrs, keys[i], values[i]);
+      }
+    }
+    nrt_span_set_attributes(span, &attrs);
+
+    nrt_span_destroy(&span);
+  }
+  snprintf(name, sizeof(name), "%d attributes per span", count);
+  bench_report(name, ROUNDS, bench_now_ns() - start);
+}
+
+/*
+ * Measure collecting attributes and moving them into a span.
+ */
+int main() {
+  bench_attributes(5);
+  bench_attributes(20);
+  bench_attributes(100);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCH_SIZE 1000
+#define ROUNDS 200
+
+static uint64_t xorshift_state = 88172645463325252ULL;
+
+static uint64_t xorshift() {
+  xorshift_state ^= xorshift_state << 13;
+  xorshift_state ^= xorshift_state >> 7;
+  xorshift_state ^= xorshift_state << 17;
+  return xorshift_state;
+}
+
+/*
+ * Compare hex-formatting random ids in C and passing them as strings with
+ * passing binary ids from the built-in generator. Batches are sent, so the
+ * cost of encoding binary ids is included.
+ */
+int main() {
+  char id[17], trace_id[33];
+  uint64_t start, high, low;
+  int round, i;
+
+  nrt_client_t* client = bench_client_new();
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+    for (i = 0; i < BATCH_SIZE; i++) {
+      snprintf(id, sizeof(id), "%016" PRIx64, xorshift());
+      snprintf(trace_id, sizeof(trace_id), "%016" PRIx64 "%016" PRIx64,
+               xorshift(), xorshift());
+      nrt_span_t* span = nrt_span_new(id, trace_id, 0);
+      nrt_span_batch_record(batch, &span);
+    }
+    nrt_client_send(client, &batch);
+  }
+  bench_report("string ids", ROUNDS * BATCH_SIZE, bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+    for (i = 0; i < BATCH_SIZE; i++) {
+      nrt_generate_trace_id(&high, &low);
+      nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+      nrt_span_batch_record(batch, &span);
+    }
+    nrt_client_send(client, &batch);
+  }
+  bench_report("binary ids", ROUNDS * BATCH_SIZE, bench_now_ns() - start);
+
+  nrt_client_shutdown(&client);
+}
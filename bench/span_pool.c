@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCH_SIZE 100
+#define ROUNDS 500
+
+/*
+ * Build and destroy batches of spans with attributes, taking all objects from
+ * the given pool, or allocating them if the pool is NULL.
+ */
+static void build_batches(void* arg) {
+  nrt_span_pool_t* pool = (nrt_span_pool_t*)arg;
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_batch_t* batch
+        = pool ? nrt_span_pool_batch_new(pool) : nrt_span_batch_new();
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+      nrt_span_t* span
+          = pool ? nrt_span_pool_span_new(pool, "e9f54a2c322d7578",
+                                          "1b1bf29379951c1d", 0)
+                 : nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+      nrt_span_set_name(span, "/index.html");
+      nrt_span_set_service_name(span, "Telemetry Application");
+
+      nrt_attributes_t* attrs
+          = pool ? nrt_span_pool_attributes_new(pool) : nrt_attributes_new();
+      nrt_attributes_set_string(attrs, "http.method", "GET");
+      nrt_attributes_set_int(attrs, "http.status_code", 200);
+      nrt_attributes_set_string(attrs, "http.url", "/index.html?page=2");
+      nrt_span_set_attributes(span, &attrs);
+
+      nrt_span_batch_record(batch, &span);
+    }
+
+    nrt_span_batch_destroy(&batch);
+  }
+}
+
+static void bench_threads(int threads, nrt_span_pool_t* pool) {
+  void* args[BENCH_THREADS_MAX];
+  char name[64];
+  uint64_t start;
+  int i;
+
+  for (i = 0; i < threads; i++) {
+    args[i] = pool;
+  }
+
+  start = bench_now_ns();
+  bench_run_threads(threads, build_batches, args);
+  snprintf(name, sizeof(name), "%s, %d threads", pool ? "pooled" : "allocated",
+           threads);
+  bench_report(name, (uint64_t)threads * ROUNDS * BATCH_SIZE,
+               bench_now_ns() - start);
+}
+
+/*
+ * Compare building spans from a pool with allocating them, with an increasing
+ * number of threads.
+ */
+int main() {
+  int threads;
+
+  for (threads = 1; threads <= 16; threads *= 4) {
+    nrt_span_pool_t* pool
+        = nrt_span_pool_new(threads * BATCH_SIZE, threads, threads);
+
+    bench_threads(threads, NULL);
+    bench_threads(threads, pool);
+
+    nrt_span_pool_stats_t stats;
+    nrt_span_pool_get_stats(pool, &stats);
+    printf("  spans allocated %llu, reused %llu, discarded %llu\n",
+           (unsigned long long)stats.spans.allocated,
+           (unsigned long long)stats.spans.reused,
+           (unsigned long long)stats.spans.discarded);
+
+    nrt_span_pool_destroy(&pool);
+  }
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BATCH_SIZE 1000
+#define ROUNDS 200
+
+/*
+ * Compare recording spans one by one via nrt_span_new and the span setters
+ * with recording them in bulk via nrt_span_batch_record_many.
+ */
+int main() {
+  static nrt_span_desc_t descs[BATCH_SIZE];
+  static char ids[BATCH_SIZE][17];
+  nrt_attribute_desc_t attrs[3];
+  uint64_t start;
+  int round, i;
+
+  memset(attrs, 0, sizeof(attrs));
+  attrs[0].key = "http.method";
+  attrs[0].key_len = strlen(attrs[0].key);
+  attrs[0].type = NRT_ATTRIBUTE_STRING;
+  attrs[0].value.string_value.ptr = "GET";
+  attrs[0].value.string_value.len = 3;
+  attrs[1].key = "http.status_code";
+  attrs[1].key_len = strlen(attrs[1].key);
+  attrs[1].type = NRT_ATTRIBUTE_INT;
+  attrs[1].value.int_value = 200;
+  attrs[2].key = "cache.hit";
+  attrs[2].key_len = strlen(attrs[2].key);
+  attrs[2].type = NRT_ATTRIBUTE_BOOL;
+  attrs[2].value.bool_value = true;
+
+  memset(descs, 0, sizeof(descs));
+  for (i = 0; i < BATCH_SIZE; i++) {
+    snprintf(ids[i], sizeof(ids[i]), "%016x", i);
+    descs[i].id = ids[i];
+    descs[i].id_len = 16;
+    descs[i].trace_id = "1b1bf29379951c1d";
+    descs[i].trace_id_len = 16;
+    descs[i].parent_id = "e9f54a2c322d7578";
+    descs[i].parent_id_len = 16;
+    descs[i].name = "/index.html";
+    descs[i].name_len = strlen(descs[i].name);
+    descs[i].service_name = "Telemetry Application";
+    descs[i].service_name_len = strlen(descs[i].service_name);
+    descs[i].timestamp = 1600000000000;
+    descs[i].duration = 12;
+    descs[i].attributes = attrs;
+    descs[i].attributes_len = 3;
+  }
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+      nrt_span_t* span = nrt_span_new(ids[i], descs[i].trace_id,
+                                      descs[i].timestamp);
+      nrt_span_set_parent_id(span, descs[i].parent_id);
+      nrt_span_set_name(span, descs[i].name);
+      nrt_span_set_service_name(span, descs[i].service_name);
+      nrt_span_set_duration(span, descs[i].duration);
+
+      nrt_attributes_t* span_attrs = nrt_attributes_new();
+      nrt_attributes_set_string(span_attrs, "http.method", "GET");
+      nrt_attributes_set_int(span_attrs, "http.status_code", 200);
+      nrt_attributes_set_bool(span_attrs, "cache.hit", true);
+      nrt_span_set_attributes(span, &span_attrs);
+
+      nrt_span_batch_record(batch, &span);
+    }
+
+    nrt_span_batch_destroy(&batch);
+  }
+  bench_report("per-span record", (uint64_t)ROUNDS * BATCH_SIZE,
+               bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+
+    nrt_span_batch_record_many(batch, descs, BATCH_SIZE);
+
+    nrt_span_batch_destroy(&batch);
+  }
+  bench_report("nrt_span_batch_record_many", (uint64_t)ROUNDS * BATCH_SIZE,
+               bench_now_ns() - start);
+}
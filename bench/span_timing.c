@@ -0,0 +1,58 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef OS_WINDOWS
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define SPANS 1000000
+
+static nrt_time_t now_ms() {
+#ifdef OS_WINDOWS
+  FILETIME time;
+  ULARGE_INTEGER ticks;
+  GetSystemTimeAsFileTime(&time);
+  ticks.LowPart = time.dwLowDateTime;
+  ticks.HighPart = time.dwHighDateTime;
+  return ticks.QuadPart / 10000 - 11644473600000ULL;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (nrt_time_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+/*
+ * Compare timing spans with wall clock readings in C with nrt_span_start and
+ * nrt_span_end.
+ */
+int main() {
+  nrt_span_t* span = nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+  uint64_t start;
+  int i;
+
+  start = bench_now_ns();
+  for (i = 0; i < SPANS; i++) {
+    nrt_time_t span_start = now_ms();
+    nrt_span_set_timestamp(span, span_start);
+    nrt_span_set_duration(span, now_ms() - span_start);
+  }
+  bench_report("wall clock in C", SPANS, bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (i = 0; i < SPANS; i++) {
+    nrt_span_start(span);
+    nrt_span_end(span);
+  }
+  bench_report("nrt_span_start/end", SPANS, bench_now_ns() - start);
+
+  nrt_span_destroy(&span);
+}
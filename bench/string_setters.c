@@ -0,0 +1,121 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS 200000
+
+/*
+ * Add one attribute per round, via the NUL-terminated, the length-delimited,
+ * the interned and the static setter. Keys and values must be static.
+ */
+static void bench_attribute(const char* label,
+                            const char* key,
+                            const char* value) {
+  char name[64];
+  size_t key_len = strlen(key);
+  size_t value_len = strlen(value);
+  uint64_t start;
+  int round;
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_string(attrs, key, value);
+    nrt_attributes_destroy(&attrs);
+  }
+  snprintf(name, sizeof(name), "nrt_attributes_set_string (%s)", label);
+  bench_report(name, ROUNDS, bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_string_n(attrs, key, key_len, value, value_len);
+    nrt_attributes_destroy(&attrs);
+  }
+  snprintf(name, sizeof(name), "nrt_attributes_set_string_n (%s)", label);
+  bench_report(name, ROUNDS, bench_now_ns() - start);
+
+  const nrt_interned_t* interned_key = nrt_intern(key);
+  const nrt_interned_t* interned_value = nrt_intern(value);
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_string_i(attrs, interned_key, interned_value);
+    nrt_attributes_destroy(&attrs);
+  }
+  snprintf(name, sizeof(name), "nrt_attributes_set_string_i (%s)", label);
+  bench_report(name, ROUNDS, bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_string_s(attrs, key, value);
+    nrt_attributes_destroy(&attrs);
+  }
+  snprintf(name, sizeof(name), "nrt_attributes_set_string_s (%s)", label);
+  bench_report(name, ROUNDS, bench_now_ns() - start);
+}
+
+/*
+ * Compare NUL-terminated and length-delimited string setters for short
+ * values and for long values such as SQL statements and URLs. Build with
+ * ENABLE_TRUSTED_UTF8 to measure the setters without UTF-8 validation.
+ */
+int main() {
+  static char sql[4096];
+  static char url[2048];
+  uint64_t start;
+  size_t len;
+  int round;
+
+  len = 0;
+  len += snprintf(sql + len, sizeof(sql) - len,
+                  "SELECT id, name, email FROM users WHERE id IN (");
+  while (len < sizeof(sql) - 32) {
+    len += snprintf(sql + len, sizeof(sql) - len, "%zu, ", len);
+  }
+  snprintf(sql + len, sizeof(sql) - len, "0) ORDER BY created_at");
+
+  len = 0;
+  len += snprintf(url + len, sizeof(url) - len,
+                  "https://example.com/api/v1/search?");
+  while (len < sizeof(url) - 32) {
+    len += snprintf(url + len, sizeof(url) - len, "q%zu=value&", len);
+  }
+
+  bench_attribute("short", "http.method", "GET");
+  bench_attribute("url", "http.url", url);
+  bench_attribute("sql", "db.statement", sql);
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_t* span = nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+    nrt_span_set_name(span, url);
+    nrt_span_destroy(&span);
+  }
+  bench_report("nrt_span_set_name (url)", ROUNDS, bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_t* span
+        = nrt_span_new_n("e9f54a2c322d7578", 16, "1b1bf29379951c1d", 16, 0);
+    nrt_span_set_name_n(span, url, strlen(url));
+    nrt_span_destroy(&span);
+  }
+  bench_report("nrt_span_set_name_n (url)", ROUNDS, bench_now_ns() - start);
+
+  start = bench_now_ns();
+  for (round = 0; round < ROUNDS; round++) {
+    nrt_span_t* span = nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+    nrt_span_set_name_s(span, url);
+    nrt_span_destroy(&span);
+  }
+  bench_report("nrt_span_set_name_s (url)", ROUNDS, bench_now_ns() - start);
+}
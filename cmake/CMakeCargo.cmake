@@ -1,5 +1,5 @@
 function(cargo_build)
-    cmake_parse_arguments(CARGO "" "NAME" "" ${ARGN})
+    cmake_parse_arguments(CARGO "" "NAME" "FEATURES" ${ARGN})
     string(REPLACE "-" "_" LIB_NAME ${CARGO_NAME})
 
     set(CARGO_TARGET_DIR ${CMAKE_CURRENT_BINARY_DIR})
@@ -53,6 +53,11 @@ function(cargo_build)
         list(APPEND CARGO_ARGS "--release")
     endif()
 
+    if(CARGO_FEATURES)
+        string(REPLACE ";" "," CARGO_FEATURES_LIST "${CARGO_FEATURES}")
+        list(APPEND CARGO_ARGS "--features" ${CARGO_FEATURES_LIST})
+    endif()
+
     file(GLOB_RECURSE LIB_SOURCES "*.rs")
 
     set(CARGO_ENV_COMMAND ${CMAKE_COMMAND} -E env "CARGO_TARGET_DIR=${CARGO_TARGET_DIR}")
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  int calls;
+  uint64_t count;
+  uint64_t errors;
+  double p50;
+  double p99;
+} totals_t;
+
+/* Called with the aggregates of each interval. */
+static void on_aggregates(const nrt_span_aggregate_t* aggregates,
+                          size_t len,
+                          void* user_data) {
+  totals_t* totals = (totals_t*)user_data;
+  size_t i;
+
+  totals->calls++;
+  for (i = 0; i < len; i++) {
+    const nrt_span_aggregate_t* a = &aggregates[i];
+
+    printf("%.*s (%.*s): %llu spans, %llu errors, p50 %.3f ms, p99 %.3f ms\n",
+           (int)a->name_len, a->name, (int)a->service_name_len,
+           a->service_name, (unsigned long long)a->count,
+           (unsigned long long)a->errors, nrt_span_aggregate_quantile(a, 0.5),
+           nrt_span_aggregate_quantile(a, 0.99));
+
+    if (a->name_len == 8 && 0 == strncmp(a->name, "GET /api", 8)) {
+      assert(NRT_SPAN_AGGREGATE_BUCKETS == a->buckets_len);
+      totals->count += a->count;
+      totals->errors += a->errors;
+      totals->p50 = nrt_span_aggregate_quantile(a, 0.5);
+      totals->p99 = nrt_span_aggregate_quantile(a, 0.99);
+    }
+  }
+}
+
+/*
+ * Aggregate spans into rate, errors and latency per name, while sending only
+ * one in a hundred traces.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  totals_t totals;
+  int i;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  memset(&totals, 0, sizeof(totals));
+
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_aggregation(cfg, 60000, on_aggregates, &totals);
+  nrt_client_config_set_sampling_ratio(cfg, 0.01);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  for (i = 0; i < 1000; i++) {
+    uint64_t high, low;
+    nrt_generate_trace_id(&high, &low);
+
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, "GET /api");
+    nrt_span_set_service_name(span, "Telemetry Application");
+    /* 2% of requests take 50 ms, the rest between 0.1 and 1 ms. */
+    nrt_span_set_duration_us(span, i % 50 == 49 ? 50000 : 100 + i % 10 * 100);
+    if (i % 50 == 0) {
+      nrt_attributes_t* attrs = nrt_attributes_new();
+      nrt_attributes_set_bool(attrs, "error", true);
+      nrt_span_set_attributes(span, &attrs);
+    }
+    nrt_span_batch_record(batch, &span);
+  }
+  nrt_client_send(client, &batch);
+
+  /* Harvest right away instead of waiting for the interval. */
+  bool harvested = nrt_client_harvest_aggregates(client);
+  assert(harvested);
+  assert(1 == totals.calls);
+  assert(1000 == totals.count);
+  assert(20 == totals.errors);
+  assert(totals.p50 > 0.4 && totals.p50 < 0.6);
+  assert(totals.p99 > 48.0 && totals.p99 < 52.0);
+
+  /* Nothing was aggregated since, so the callback isn't called. */
+  harvested = nrt_client_harvest_aggregates(client);
+  assert(harvested);
+  assert(1 == totals.calls);
+
+  nrt_client_shutdown(&client);
+
+  /* Call with NULL parameters. */
+  nrt_client_config_set_aggregation(NULL, 60000, on_aggregates, NULL);
+  nrt_client_harvest_aggregates(NULL);
+  nrt_span_aggregate_quantile(NULL, 0.5);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef OS_WINDOWS
+#include <windows.h>
+#else
+#include <poll.h>
+#endif
+
+#define BATCHES 50
+
+/* How often the callback was called for each batch, and with what. */
+static int completed[BATCHES];
+static int handed_off;
+static int dropped;
+
+static void on_completion(nrt_delivery_t delivery,
+                          size_t spans,
+                          void* user_data) {
+  int* count = (int*)user_data;
+
+  (*count)++;
+  if (NRT_DELIVERY_HANDED_OFF == delivery) {
+    assert(10 == spans);
+    handed_off++;
+  } else {
+    dropped++;
+  }
+}
+
+static nrt_span_batch_t* new_batch() {
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  uint64_t high, low;
+  int i;
+
+  for (i = 0; i < 10; i++) {
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, "GET /api");
+    nrt_span_batch_record(batch, &span);
+  }
+  return batch;
+}
+
+/*
+ * Wait until completions are pending, the way an event loop would, and
+ * process them.
+ */
+static void wait_and_process(nrt_client_t* client) {
+#ifdef OS_WINDOWS
+  Sleep(10);
+#else
+  struct pollfd pfd;
+  pfd.fd = nrt_client_completion_fd(client);
+  pfd.events = POLLIN;
+  assert(pfd.fd >= 0);
+  poll(&pfd, 1, 100);
+#endif
+  nrt_client_process_completions(client);
+}
+
+/*
+ * Submit batches without ever blocking, and learn what became of each of
+ * them via callbacks run from an event loop.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  int accepted = 0;
+  int i;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  /* A small queue that drops the oldest batch, so some batches are dropped
+   * after they were queued. */
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_queue_max(cfg, 4);
+  nrt_client_config_set_backpressure(cfg, NRT_BACKPRESSURE_DROP_OLDEST, 0);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  for (i = 0; i < BATCHES; i++) {
+    nrt_span_batch_t* batch = new_batch();
+    nrt_send_result_t result =
+        nrt_client_submit(client, &batch, on_completion, &completed[i]);
+    assert(NULL == batch);
+    if (NRT_SEND_QUEUED == result ||
+        NRT_SEND_QUEUED_DROPPED_OLDEST == result) {
+      accepted++;
+    }
+  }
+  assert(BATCHES == accepted);
+
+  while (handed_off + dropped < accepted) {
+    wait_and_process(client);
+  }
+  printf("handed off %d, dropped %d\n", handed_off, dropped);
+
+  /* Every batch was completed exactly once. */
+  for (i = 0; i < BATCHES; i++) {
+    assert(1 == completed[i]);
+  }
+
+  /* Without a callback, nothing is reported. */
+  nrt_span_batch_t* batch = new_batch();
+  nrt_client_submit(client, &batch, NULL, NULL);
+  nrt_client_shutdown(&client);
+
+  /* Call with NULL parameters. */
+  assert(-1 == nrt_client_completion_fd(NULL));
+  assert(0 == nrt_client_process_completions(NULL));
+  assert(NRT_SEND_INVALID ==
+         nrt_client_submit(NULL, &batch, on_completion, NULL));
+}
@@ -27,11 +27,67 @@ int main() {
   nrt_attributes_destroy(&attrs);
   assert(NULL == attrs);
 
+  /* Initialize and destroy attributes with length-delimited strings. */
+  attrs = nrt_attributes_new();
+  assert(attrs);
+  nrt_attributes_set_int_n(attrs, "int_n", 3, -6);
+  nrt_attributes_set_uint_n(attrs, "uint_n", 4, 6);
+  nrt_attributes_set_double_n(attrs, "double_n", 6, 3.14159);
+  nrt_attributes_set_string_n(attrs, "string_n", 6, "value_n", 5);
+  nrt_attributes_set_bool_n(attrs, "bool_n", 4, true);
+  nrt_attributes_destroy(&attrs);
+  assert(NULL == attrs);
+
+  /* Initialize and destroy attributes with interned strings. */
+  const nrt_interned_t* key = nrt_intern("key");
+  const nrt_interned_t* value = nrt_intern_n("value_n", 5);
+  assert(key);
+  assert(value);
+  assert(key == nrt_intern("key"));
+  assert(value == nrt_intern("value"));
+  attrs = nrt_attributes_new();
+  assert(attrs);
+  nrt_attributes_set_int_i(attrs, key, -6);
+  nrt_attributes_set_uint_i(attrs, key, 6);
+  nrt_attributes_set_double_i(attrs, key, 3.14159);
+  nrt_attributes_set_string_i(attrs, key, value);
+  nrt_attributes_set_bool_i(attrs, key, true);
+  nrt_attributes_destroy(&attrs);
+  assert(NULL == attrs);
+
+  /* Initialize and destroy attributes with static strings. */
+  attrs = nrt_attributes_new();
+  assert(attrs);
+  nrt_attributes_set_int_s(attrs, "key", -6);
+  nrt_attributes_set_uint_s(attrs, "key", 6);
+  nrt_attributes_set_double_s(attrs, "key", 3.14159);
+  nrt_attributes_set_string_s(attrs, "key", "value");
+  nrt_attributes_set_bool_s(attrs, "key", true);
+  nrt_attributes_destroy(&attrs);
+  assert(NULL == attrs);
+
   /* Call with NULL values */
   nrt_attributes_set_int(NULL, NULL, -6);
   nrt_attributes_set_uint(NULL, NULL, 6);
   nrt_attributes_set_double(NULL, NULL, 3.14159);
   nrt_attributes_set_string(NULL, NULL, NULL);
   nrt_attributes_set_bool(NULL, NULL, true);
+  nrt_attributes_set_int_n(NULL, NULL, 0, -6);
+  nrt_attributes_set_uint_n(NULL, NULL, 0, 6);
+  nrt_attributes_set_double_n(NULL, NULL, 0, 3.14159);
+  nrt_attributes_set_string_n(NULL, NULL, 0, NULL, 0);
+  nrt_attributes_set_bool_n(NULL, NULL, 0, true);
+  nrt_attributes_set_int_i(NULL, NULL, -6);
+  nrt_attributes_set_uint_i(NULL, NULL, 6);
+  nrt_attributes_set_double_i(NULL, NULL, 3.14159);
+  nrt_attributes_set_string_i(NULL, NULL, NULL);
+  nrt_attributes_set_bool_i(NULL, NULL, true);
+  nrt_attributes_set_int_s(NULL, NULL, -6);
+  nrt_attributes_set_uint_s(NULL, NULL, 6);
+  nrt_attributes_set_double_s(NULL, NULL, 3.14159);
+  nrt_attributes_set_string_s(NULL, NULL, NULL);
+  nrt_attributes_set_bool_s(NULL, NULL, true);
+  assert(NULL == nrt_intern(NULL));
+  assert(NULL == nrt_intern_n(NULL, 0));
   nrt_attributes_destroy(NULL);
 }
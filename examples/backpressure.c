@@ -0,0 +1,104 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static nrt_span_batch_t* new_batch() {
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  uint64_t high, low;
+  int i;
+
+  for (i = 0; i < 20; i++) {
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, "GET /api");
+    nrt_span_batch_record(batch, &span);
+  }
+  return batch;
+}
+
+/*
+ * Send batches faster than they can be sent and count what happens to them.
+ * Which outcomes occur depends on the policy, how many of each depends on how
+ * fast the client drains its queue.
+ */
+static void run(const char* api_key,
+                nrt_backpressure_t policy,
+                const char* name) {
+  int counts[NRT_SEND_INVALID + 1] = {0};
+  int i;
+
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_queue_max(cfg, 4);
+  bool ok = nrt_client_config_set_backpressure(cfg, policy, 5);
+  assert(ok);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  for (i = 0; i < 200; i++) {
+    nrt_span_batch_t* batch = new_batch();
+    nrt_send_result_t result = nrt_client_enqueue(client, &batch);
+    assert(NULL == batch);
+    counts[result]++;
+
+    switch (policy) {
+      case NRT_BACKPRESSURE_DROP_NEWEST:
+        assert(NRT_SEND_QUEUED == result || NRT_SEND_DROPPED == result);
+        break;
+      case NRT_BACKPRESSURE_DROP_OLDEST:
+        assert(NRT_SEND_QUEUED == result ||
+               NRT_SEND_QUEUED_DROPPED_OLDEST == result);
+        break;
+      case NRT_BACKPRESSURE_BLOCK:
+        assert(NRT_SEND_QUEUED == result || NRT_SEND_TIMEOUT == result);
+        break;
+      case NRT_BACKPRESSURE_SAMPLE:
+        assert(NRT_SEND_QUEUED == result || NRT_SEND_QUEUED_SAMPLED == result ||
+               NRT_SEND_DROPPED == result);
+        break;
+    }
+  }
+
+  printf("%s: queued %d, dropped oldest %d, sampled %d, dropped %d, "
+         "timeout %d\n",
+         name, counts[NRT_SEND_QUEUED], counts[NRT_SEND_QUEUED_DROPPED_OLDEST],
+         counts[NRT_SEND_QUEUED_SAMPLED], counts[NRT_SEND_DROPPED],
+         counts[NRT_SEND_TIMEOUT]);
+  nrt_client_shutdown(&client);
+}
+
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  run(api_key, NRT_BACKPRESSURE_DROP_NEWEST, "drop newest");
+  run(api_key, NRT_BACKPRESSURE_DROP_OLDEST, "drop oldest");
+  run(api_key, NRT_BACKPRESSURE_BLOCK, "block");
+  run(api_key, NRT_BACKPRESSURE_SAMPLE, "sample");
+
+  /* Unknown policies are rejected. */
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  bool ok = nrt_client_config_set_backpressure(cfg, (nrt_backpressure_t)42, 0);
+  assert(!ok);
+  nrt_client_config_destroy(&cfg);
+
+  /* Call with NULL parameters. */
+  ok = nrt_client_config_set_backpressure(NULL, NRT_BACKPRESSURE_BLOCK, 0);
+  assert(!ok);
+  nrt_span_batch_t* batch = new_batch();
+  nrt_send_result_t result = nrt_client_enqueue(NULL, &batch);
+  assert(NRT_SEND_INVALID == result);
+  nrt_span_batch_destroy(&batch);
+  nrt_client_t* client = NULL;
+  result = nrt_client_enqueue(client, NULL);
+  assert(NRT_SEND_INVALID == result);
+}
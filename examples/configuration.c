@@ -31,6 +31,15 @@ int main() {
   nrt_client_config_set_endpoint_traces(cfg, "localhost", 31339);
   nrt_client_config_set_product_info(cfg, "Example", "1.0");
   nrt_client_config_set_queue_max(cfg, 200);
+  nrt_client_config_set_sender_threads(cfg, 4);
+  nrt_client_config_set_payload_max(cfg, 500000);
+  bool ok = nrt_client_config_set_compression_level(cfg, 6);
+  assert(ok);
+  ok = nrt_client_config_set_compression_level(cfg, 10);
+  assert(!ok);
+  nrt_client_config_set_sampling_ratio(cfg, 0.25);
+  nrt_client_config_set_sampling_rate_limit(cfg, 100);
+  nrt_client_config_set_tail_sampling(cfg, 500000, 5000);
   nrt_client_config_destroy(&cfg);
   assert(NULL == cfg);
 
@@ -41,5 +50,11 @@ int main() {
   nrt_client_config_set_endpoint_traces(NULL, NULL, 31339);
   nrt_client_config_set_product_info(NULL, NULL, NULL);
   nrt_client_config_set_queue_max(NULL, 200);
+  nrt_client_config_set_sender_threads(NULL, 4);
+  nrt_client_config_set_payload_max(NULL, 500000);
+  nrt_client_config_set_compression_level(NULL, 6);
+  nrt_client_config_set_sampling_ratio(NULL, 0.25);
+  nrt_client_config_set_sampling_rate_limit(NULL, 100);
+  nrt_client_config_set_tail_sampling(NULL, 500000, 5000);
   nrt_client_config_destroy(NULL);
 }
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define EXPORT_DIR "nrt-export-example"
+
+static nrt_client_t* new_client(bool compress) {
+  nrt_client_config_t* cfg = nrt_client_config_new("export-example");
+  nrt_client_config_set_export(cfg, EXPORT_DIR, 1024 * 1024, 10, compress);
+  return nrt_client_new(&cfg);
+}
+
+static void send_spans(nrt_client_t* client, int count) {
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  int i;
+
+  nrt_attributes_t* common = nrt_attributes_new();
+  nrt_attributes_set_string(common, "host", "example-host");
+  nrt_span_batch_set_common_attributes(batch, &common);
+  for (i = 0; i < count; i++) {
+    uint64_t high, low;
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, "GET /api");
+    nrt_span_set_service_name(span, "Telemetry Application");
+    nrt_span_set_duration_us(span, 1500);
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_int(attrs, "http.status_code", 200);
+    nrt_span_set_attributes(span, &attrs);
+    nrt_span_batch_record(batch, &span);
+  }
+  bool sent = nrt_client_send(client, &batch);
+  assert(sent);
+}
+
+/* Remove the files written by the exporter, and then the directory. */
+static void remove_files(void) {
+  char path[64];
+  unsigned long long seq;
+
+  for (seq = 0;; seq++) {
+    snprintf(path, sizeof(path), EXPORT_DIR "/%016llx.ndjson", seq);
+    if (remove(path) != 0) {
+      snprintf(path, sizeof(path), EXPORT_DIR "/%016llx.ndjson.gz", seq);
+      if (remove(path) != 0) {
+        break;
+      }
+    }
+  }
+  remove(EXPORT_DIR);
+}
+
+/*
+ * Write span batches to local files instead of sending them, and read them
+ * back as span batches.
+ */
+int main() {
+  nrt_replay_stats_t stats;
+  nrt_span_batch_t* batch;
+  int i;
+
+  remove_files();
+
+  /* Each batch is written as a line of JSON in the format of the trace API. */
+  nrt_client_t* client = new_client(false);
+  assert(client);
+  for (i = 0; i < 3; i++) {
+    send_spans(client, 100);
+  }
+
+  /* Clients that export can't be turned into recorders. */
+  nrt_recorder_t* recorder = nrt_recorder_new(&client, 100, 0);
+  assert(NULL == recorder);
+  assert(client);
+  nrt_client_shutdown(&client);
+
+  /* A later client continues with a new file, here a compressed one. */
+  client = new_client(true);
+  assert(client);
+  for (i = 0; i < 2; i++) {
+    send_spans(client, 50);
+  }
+  nrt_client_shutdown(&client);
+
+  /*
+   * Replay the directory. Batches could be sent with another client, which
+   * reproduces the exported traffic.
+   */
+  nrt_replay_t* replay = nrt_replay_open(EXPORT_DIR);
+  assert(replay);
+  while ((batch = nrt_replay_next(replay))) {
+    nrt_span_batch_destroy(&batch);
+  }
+  bool ok = nrt_replay_get_stats(replay, &stats);
+  assert(ok);
+  printf("replayed %llu spans in %llu batches from %llu files\n",
+         (unsigned long long)stats.spans, (unsigned long long)stats.batches,
+         (unsigned long long)stats.files);
+  assert(2 == stats.files);
+  assert(5 == stats.batches);
+  assert(400 == stats.spans);
+  assert(0 == stats.lines_skipped);
+  nrt_replay_destroy(&replay);
+  assert(NULL == replay);
+
+  /* A path that doesn't exist can't be replayed. */
+  replay = nrt_replay_open(EXPORT_DIR "/missing");
+  assert(NULL == replay);
+
+  /* Call with NULL parameters. */
+  nrt_client_config_set_export(NULL, EXPORT_DIR, 0, 0, false);
+  replay = nrt_replay_open(NULL);
+  assert(NULL == replay);
+  batch = nrt_replay_next(NULL);
+  assert(NULL == batch);
+  ok = nrt_replay_get_stats(NULL, &stats);
+  assert(!ok);
+  nrt_replay_destroy(NULL);
+  nrt_replay_destroy(&replay);
+
+  remove_files();
+}
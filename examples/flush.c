@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCHES 20
+#define SPANS_PER_BATCH 50
+
+static void on_delivery(nrt_delivery_t delivery,
+                        size_t spans,
+                        void* user_data) {
+  (void)delivery;
+  (void)spans;
+  (*(int*)user_data)++;
+}
+
+static void submit_batches(nrt_client_t* client, int* completed) {
+  int i, j;
+
+  for (i = 0; i < BATCHES; i++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+    for (j = 0; j < SPANS_PER_BATCH; j++) {
+      uint64_t high, low;
+      nrt_generate_trace_id(&high, &low);
+      nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+      nrt_span_set_name(span, "GET /api");
+      nrt_span_batch_record(batch, &span);
+    }
+    nrt_send_result_t result =
+        nrt_client_submit(client, &batch, on_delivery, completed);
+    assert(NRT_SEND_QUEUED == result);
+  }
+}
+
+/*
+ * Make sure queued batches are handed over before moving on, and shut down
+ * within a bounded time, as before a process exits during a deploy.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  nrt_flush_result_t result;
+  int completed = 0;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_queue_max(cfg, 2 * BATCHES);
+  nrt_client_config_set_sender_threads(cfg, 2);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  /* Wait up to ten seconds for queued batches to be handed to the SDK. */
+  submit_batches(client, &completed);
+  bool flushed = nrt_client_flush(client, 10000, &result);
+  printf("flushed: %d, pending %llu spans\n", flushed,
+         (unsigned long long)result.spans_pending);
+  if (flushed) {
+    assert(!result.timed_out);
+    assert(0 == result.spans_pending);
+    nrt_client_process_completions(client);
+    assert(BATCHES == completed);
+  }
+
+  /*
+   * Give up on whatever wasn't sent after one second. Without a spool, spans
+   * still queued then are dropped.
+   */
+  submit_batches(client, &completed);
+  bool finished = nrt_client_shutdown_timeout(&client, 1000, &result);
+  assert(!client);
+  printf("shut down in time: %d, dropped %llu spans, abandoned %llu\n",
+         finished, (unsigned long long)result.spans_dropped,
+         (unsigned long long)result.sdk_clients_abandoned);
+  assert(finished == !result.timed_out);
+  assert(0 == result.spans_spooled);
+  if (finished) {
+    assert(0 == result.spans_dropped);
+    assert(0 == result.sdk_clients_abandoned);
+  }
+
+  /* Every submitted batch completed exactly once. */
+  assert(2 * BATCHES == completed);
+
+  /* Call with NULL parameters. */
+  flushed = nrt_client_flush(NULL, 0, &result);
+  assert(!flushed);
+  finished = nrt_client_shutdown_timeout(NULL, 0, NULL);
+  assert(!finished);
+  finished = nrt_client_shutdown_timeout(&client, 0, NULL);
+  assert(!finished);
+}
@@ -8,11 +8,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#define LOG_FILE "./nrt-rotating.log"
+
 /*
  * An example that initializes a logger and triggers a log message.
  */
 int main() {
   const char* api_key = getenv("NEW_RELIC_API_KEY");
+  nrt_log_stats_t stats;
+  int i;
 
   if (!api_key) {
     fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
@@ -25,6 +29,36 @@ int main() {
   /* Initialize a logger. */
   nrt_log_init(NRT_LOG_DEBUG, "./nrt.log");
 
+  /*
+   * Switch to a log file that is rotated at 1 KB, keeping two rotated files.
+   * The log level can be changed any time later.
+   */
+  bool ok = nrt_log_init_rotating(NRT_LOG_DEBUG, LOG_FILE, 1024, 2);
+  assert(ok);
+  nrt_log_set_level(NRT_LOG_ERROR);
+
+  /*
+   * Fail to open a spool again and again, which logs an error each time. A
+   * single call site logs at most 20 messages per second.
+   */
+  for (i = 0; i < 100; i++) {
+    nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+    nrt_client_config_set_spool(cfg, LOG_FILE "/spool", 1024);
+    nrt_client_t* client = nrt_client_new(&cfg);
+    assert(NULL == client);
+  }
+  nrt_log_flush();
+  ok = nrt_log_get_stats(&stats);
+  assert(ok);
+  printf("written %llu, rate limited %llu, rotated %llu\n",
+         (unsigned long long)stats.messages_written,
+         (unsigned long long)stats.messages_rate_limited,
+         (unsigned long long)stats.files_rotated);
+  assert(stats.messages_written > 0);
+  assert(stats.messages_rate_limited > 0);
+  ok = nrt_log_get_stats(NULL);
+  assert(!ok);
+
   /* Initialize a configuration with an invalid host. */
   nrt_client_config_t* cfg = nrt_client_config_new(api_key);
   nrt_client_config_set_endpoint_traces(cfg, "host:80", 80);
@@ -32,4 +66,8 @@ int main() {
   /* Initialize a new client with the given API key. */
   nrt_client_t* client = nrt_client_new(&cfg);
   assert(NULL == client);
+
+  remove(LOG_FILE);
+  remove(LOG_FILE ".1");
+  remove(LOG_FILE ".2");
 }
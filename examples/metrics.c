@@ -0,0 +1,184 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  int calls;
+  double requests;
+  double queue_length;
+  uint64_t sizes;
+  double size_sum;
+  double size_min;
+  double size_max;
+} totals_t;
+
+static bool is(const nrt_metric_t* m, const char* name) {
+  return m->name_len == strlen(name) &&
+         0 == strncmp(m->name, name, m->name_len);
+}
+
+/* Called with the metrics of each interval. */
+static void on_metrics(const nrt_metric_t* metrics,
+                       size_t len,
+                       void* user_data) {
+  totals_t* totals = (totals_t*)user_data;
+  size_t i;
+
+  totals->calls++;
+  for (i = 0; i < len; i++) {
+    const nrt_metric_t* m = &metrics[i];
+
+    printf("%.*s: value %.1f, count %llu, sum %.1f, min %.1f, max %.1f\n",
+           (int)m->name_len, m->name, m->value, (unsigned long long)m->count,
+           m->sum, m->min, m->max);
+    assert(m->start <= m->end);
+
+    if (is(m, "http.requests")) {
+      assert(NRT_METRIC_COUNT == m->type);
+      totals->requests += m->value;
+    } else if (is(m, "queue.length")) {
+      assert(NRT_METRIC_GAUGE == m->type);
+      totals->queue_length = m->value;
+    } else if (is(m, "http.response.size")) {
+      assert(NRT_METRIC_SUMMARY == m->type);
+      totals->sizes += m->count;
+      totals->size_sum += m->sum;
+      totals->size_min = m->min;
+      totals->size_max = m->max;
+    }
+  }
+}
+
+typedef struct {
+  nrt_client_t* client;
+  int calls;
+} reentrant_t;
+
+/* Harvests again from within the callback, the first time it's called. */
+static void on_metrics_harvest(const nrt_metric_t* metrics,
+                               size_t len,
+                               void* user_data) {
+  reentrant_t* reentrant = (reentrant_t*)user_data;
+
+  (void)metrics;
+  (void)len;
+  if (1 == ++reentrant->calls) {
+    bool harvested = nrt_client_harvest_metrics(reentrant->client);
+    assert(harvested);
+  }
+}
+
+/*
+ * Count requests, track a queue length and summarize response sizes, and
+ * harvest the metrics on demand.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  totals_t totals;
+  int i;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  memset(&totals, 0, sizeof(totals));
+
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_metrics(cfg, 60000, on_metrics, &totals);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  nrt_counter_t* requests = nrt_counter_new(client, "http.requests");
+  nrt_gauge_t* queue_length = nrt_gauge_new(client, "queue.length");
+  nrt_summary_t* sizes = nrt_summary_new(client, "http.response.size");
+  assert(requests && queue_length && sizes);
+
+  /* A name can only be used by instruments of one type. */
+  nrt_gauge_t* conflicting = nrt_gauge_new(client, "http.requests");
+  assert(!conflicting);
+
+  /* Creating an instrument again returns another handle to it. */
+  nrt_counter_t* more_requests = nrt_counter_new(client, "http.requests");
+  assert(more_requests);
+
+  for (i = 0; i < 100; i++) {
+    nrt_counter_add(requests, 1);
+    nrt_gauge_set(queue_length, i);
+    nrt_summary_record(sizes, 100 + i);
+  }
+  nrt_counter_add(more_requests, 50);
+
+  /* The interval is a minute, so harvest right away. */
+  bool harvested = nrt_client_harvest_metrics(client);
+  assert(harvested);
+  assert(1 == totals.calls);
+  assert(150 == totals.requests);
+  assert(99 == totals.queue_length);
+  assert(100 == totals.sizes);
+  assert(14950 == totals.size_sum);
+  assert(100 == totals.size_min);
+  assert(199 == totals.size_max);
+
+  /* Counts and summaries start over, gauges keep their value. */
+  nrt_counter_add(requests, 1);
+  nrt_counter_destroy(&more_requests);
+  assert(!more_requests);
+  nrt_client_shutdown(&client);
+  assert(2 == totals.calls);
+  assert(151 == totals.requests);
+  assert(99 == totals.queue_length);
+  assert(100 == totals.sizes);
+
+  nrt_counter_destroy(&requests);
+  nrt_gauge_destroy(&queue_length);
+  nrt_summary_destroy(&sizes);
+
+  /* Call with NULL parameters. */
+  nrt_client_config_set_metrics(NULL, 1000, on_metrics, NULL);
+  harvested = nrt_client_harvest_metrics(NULL);
+  assert(!harvested);
+  requests = nrt_counter_new(NULL, "http.requests");
+  assert(!requests);
+  nrt_counter_add(NULL, 1);
+  nrt_gauge_set(NULL, 1);
+  nrt_summary_record(NULL, 1);
+  nrt_counter_destroy(NULL);
+  nrt_counter_destroy(&requests);
+  nrt_gauge_destroy(NULL);
+  nrt_summary_destroy(NULL);
+
+  /*
+   * Callbacks may call into the client. Gauges keep their value, so the
+   * nested harvest passes it on once more.
+   */
+  reentrant_t reentrant = {NULL, 0};
+  cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_metrics(cfg, 60000, on_metrics_harvest, &reentrant);
+  reentrant.client = nrt_client_new(&cfg);
+  assert(reentrant.client);
+  queue_length = nrt_gauge_new(reentrant.client, "queue.length");
+  nrt_gauge_set(queue_length, 1);
+  harvested = nrt_client_harvest_metrics(reentrant.client);
+  assert(harvested);
+  assert(2 == reentrant.calls);
+  nrt_gauge_destroy(&queue_length);
+  nrt_client_shutdown(&reentrant.client);
+
+  /* Without metrics configured, no instruments can be created. */
+  cfg = nrt_client_config_new(api_key);
+  client = nrt_client_new(&cfg);
+  assert(client);
+  requests = nrt_counter_new(client, "http.requests");
+  assert(!requests);
+  harvested = nrt_client_harvest_metrics(client);
+  assert(!harvested);
+  nrt_client_shutdown(&client);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Record spans via a span recorder, which batches and sends them in the
+ * background. Any number of threads can record to the same recorder.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  char id[17];
+  int i;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  /* Destroy a NULL recorder. */
+  nrt_recorder_t* recorder = NULL;
+  nrt_recorder_destroy(&recorder);
+
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_t* client = nrt_client_new(&cfg);
+
+  /* Batches must hold at least one span. */
+  recorder = nrt_recorder_new(&client, 0, 1000);
+  assert(NULL == recorder);
+  assert(client);
+
+  /*
+   * Send batches of up to 100 spans, and send partially filled batches after
+   * one second. The recorder takes ownership of the client.
+   */
+  recorder = nrt_recorder_new(&client, 100, 1000);
+  assert(recorder);
+  assert(NULL == client);
+
+  for (i = 0; i < 250; i++) {
+    snprintf(id, sizeof(id), "%016x", i + 1);
+
+    nrt_span_t* span = nrt_span_new(id, "1b1bf29379951c1d", 0);
+    nrt_span_set_name(span, "/index.html");
+    nrt_span_set_service_name(span, "Telemetry Application");
+
+    bool recorded = nrt_recorder_record(recorder, &span);
+    assert(recorded);
+    assert(NULL == span);
+  }
+
+  /* Recording to a NULL recorder destroys the span. */
+  nrt_span_t* span = nrt_span_new("e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+  bool recorded = nrt_recorder_record(NULL, &span);
+  assert(!recorded);
+  assert(NULL == span);
+
+  /* Send the remaining spans and shut down the recorder and the client. */
+  nrt_recorder_shutdown(&recorder);
+  assert(NULL == recorder);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void record_span(nrt_span_batch_t* batch,
+                        uint64_t trace_id,
+                        nrt_time_t duration,
+                        bool error) {
+  nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), 0, trace_id, 0);
+  nrt_span_set_duration(span, duration);
+  if (error) {
+    nrt_attributes_t* attrs = nrt_attributes_new();
+    nrt_attributes_set_bool(attrs, "error", true);
+    nrt_span_set_attributes(span, &attrs);
+  }
+  nrt_span_batch_record(batch, &span);
+}
+
+/*
+ * Configure head, rate-limited and tail sampling and check which spans are
+ * kept.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  nrt_sampling_stats_t stats;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  /*
+   * Keep half of all traces, and of those only traces with errors or spans
+   * lasting at least one millisecond. Decide traces right away.
+   */
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_sampling_ratio(cfg, 0.5);
+  nrt_client_config_set_tail_sampling(cfg, 1000, 0);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  /* Head sampling is based on the low 64 bits of the trace id. */
+  bool sampled = nrt_client_sample_trace(client, "0000000000000001");
+  assert(sampled);
+  sampled = nrt_client_sample_trace(client, "ffffffffffffffff");
+  assert(!sampled);
+  sampled = nrt_client_sample_trace_u128(client, 0, 1);
+  assert(sampled);
+
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  /* A slow trace, which is kept with all of its spans. */
+  record_span(batch, 1, 2, false);
+  record_span(batch, 1, 0, false);
+  /* A fast trace, which is dropped. */
+  record_span(batch, 2, 0, false);
+  /* A trace with an error, which is kept. */
+  record_span(batch, 3, 0, true);
+  /* A trace that isn't head sampled. */
+  record_span(batch, 0xffffffffffffffff, 5, true);
+  nrt_client_send(client, &batch);
+
+  bool ok = nrt_client_get_sampling_stats(client, &stats);
+  assert(ok);
+  assert(3 == stats.kept);
+  assert(1 == stats.dropped_ratio);
+  assert(0 == stats.dropped_rate_limit);
+  assert(1 == stats.dropped_tail);
+  assert(0 == stats.pending_tail);
+
+  nrt_client_shutdown(&client);
+
+  /* Allow one trace per second. */
+  cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_sampling_rate_limit(cfg, 1);
+  client = nrt_client_new(&cfg);
+
+  sampled = nrt_client_sample_trace(client, "0000000000000001");
+  assert(sampled);
+  /* Decisions are remembered, so all spans of a trace get the same one. */
+  sampled = nrt_client_sample_trace(client, "0000000000000001");
+  assert(sampled);
+  sampled = nrt_client_sample_trace(client, "0000000000000002");
+  assert(!sampled);
+
+  nrt_client_shutdown(&client);
+
+  /* A client without sampling keeps everything. */
+  cfg = nrt_client_config_new(api_key);
+  client = nrt_client_new(&cfg);
+  sampled = nrt_client_sample_trace(client, "ffffffffffffffff");
+  assert(sampled);
+  ok = nrt_client_get_sampling_stats(client, &stats);
+  assert(ok);
+  assert(0 == stats.kept);
+  nrt_client_shutdown(&client);
+
+  /* Call with NULL parameters. */
+  nrt_client_sample_trace(NULL, NULL);
+  nrt_client_sample_trace_u128(NULL, 0, 1);
+  nrt_client_get_sampling_stats(NULL, NULL);
+}
@@ -55,14 +55,81 @@ int main() {
   nrt_span_destroy(&span);
   assert(NULL == span);
 
+  /* Initialize a span with length-delimited strings */
+  span = nrt_span_new_n("span_id_n", 7, "trace_id_n", 8, time_ms);
+  assert(span);
+  nrt_span_set_id_n(span, "span_id2_n", 8);
+  nrt_span_set_trace_id_n(span, "trace_id2_n", 9);
+  nrt_span_set_name_n(span, "Root span_n", 9);
+  nrt_span_set_parent_id_n(span, "parent_id_n", 9);
+  nrt_span_set_service_name_n(span, "Telemetry Application_n", 21);
+  nrt_span_set_name_i(span, nrt_intern("Root span"));
+  nrt_span_set_service_name_i(span, nrt_intern("Telemetry Application"));
+  nrt_span_set_name_s(span, "Root span");
+  nrt_span_set_service_name_s(span, "Telemetry Application");
+  nrt_span_destroy(&span);
+  assert(NULL == span);
+
+  /* Initialize a span with binary ids */
+  uint64_t trace_id_high, trace_id_low;
+  bool generated = nrt_generate_trace_id(&trace_id_high, &trace_id_low);
+  assert(generated);
+  span = nrt_span_new_u64(nrt_generate_span_id(), trace_id_high, trace_id_low,
+                          time_ms);
+  assert(span);
+  bool set = nrt_span_set_id_u64(span, 0xe9f54a2c322d7578);
+  assert(set);
+  set = nrt_span_set_trace_id_u128(span, 0, 0x1b1bf29379951c1d);
+  assert(set);
+  set = nrt_span_set_parent_id_u64(span, nrt_generate_span_id());
+  assert(set);
+  nrt_span_destroy(&span);
+  assert(NULL == span);
+
+  /* Measure a span with the built-in monotonic clock */
+  span = nrt_span_new("span_id", "trace_id", 0);
+  bool ended = nrt_span_end(span);
+  assert(!ended);
+  bool started = nrt_span_start(span);
+  assert(started);
+  ended = nrt_span_end(span);
+  assert(ended);
+  nrt_span_set_duration_us(span, 250);
+  nrt_span_set_duration_ns(span, 1500);
+  nrt_span_destroy(&span);
+
+  /* Zero ids are rejected */
+  span = nrt_span_new_u64(0, 0, 1, time_ms);
+  assert(NULL == span);
+  span = nrt_span_new_u64(1, 0, 0, time_ms);
+  assert(NULL == span);
+
   /* Call with NULL parameters */
   nrt_span_set_id(NULL, NULL);
   nrt_span_set_trace_id(NULL, NULL);
   nrt_span_set_timestamp(NULL, time_ms);
   nrt_span_set_name(NULL, NULL);
   nrt_span_set_duration(NULL, 2000);
+  nrt_span_set_duration_us(NULL, 2000);
+  nrt_span_set_duration_ns(NULL, 2000);
+  nrt_span_start(NULL);
+  nrt_span_end(NULL);
   nrt_span_set_parent_id(NULL, NULL);
   nrt_span_set_service_name(NULL, NULL);
+  nrt_span_new_n(NULL, 0, NULL, 0, time_ms);
+  nrt_span_set_id_n(NULL, NULL, 0);
+  nrt_span_set_trace_id_n(NULL, NULL, 0);
+  nrt_span_set_name_n(NULL, NULL, 0);
+  nrt_span_set_parent_id_n(NULL, NULL, 0);
+  nrt_span_set_service_name_n(NULL, NULL, 0);
+  nrt_span_set_name_i(NULL, NULL);
+  nrt_span_set_service_name_i(NULL, NULL);
+  nrt_span_set_name_s(NULL, NULL);
+  nrt_span_set_service_name_s(NULL, NULL);
+  nrt_span_set_id_u64(NULL, 1);
+  nrt_span_set_trace_id_u128(NULL, 0, 1);
+  nrt_span_set_parent_id_u64(NULL, 1);
+  nrt_generate_trace_id(NULL, NULL);
 
   nrt_span_destroy(NULL);
 }
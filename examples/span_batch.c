@@ -0,0 +1,114 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Fill a span batch with single spans and with span descriptors.
+ */
+int main() {
+  /* Destroy a NULL span batch. */
+  nrt_span_batch_t* batch = NULL;
+  nrt_span_batch_destroy(&batch);
+
+  batch = nrt_span_batch_new();
+  assert(batch);
+
+  /* Record a single span. */
+  nrt_span_t* span = nrt_span_new("span_id", "trace_id", 1000);
+  bool recorded = nrt_span_batch_record(batch, &span);
+  assert(recorded);
+  assert(NULL == span);
+
+  /* Record spans from descriptors. */
+  nrt_attribute_desc_t attrs[5];
+  memset(attrs, 0, sizeof(attrs));
+  attrs[0].key = "int";
+  attrs[0].key_len = 3;
+  attrs[0].type = NRT_ATTRIBUTE_INT;
+  attrs[0].value.int_value = -6;
+  attrs[1].key = "uint";
+  attrs[1].key_len = 4;
+  attrs[1].type = NRT_ATTRIBUTE_UINT;
+  attrs[1].value.uint_value = 6;
+  attrs[2].key = "double";
+  attrs[2].key_len = 6;
+  attrs[2].type = NRT_ATTRIBUTE_DOUBLE;
+  attrs[2].value.double_value = 3.14159;
+  attrs[3].key = "string";
+  attrs[3].key_len = 6;
+  attrs[3].type = NRT_ATTRIBUTE_STRING;
+  attrs[3].value.string_value.ptr = "value";
+  attrs[3].value.string_value.len = 5;
+  attrs[4].key = "bool";
+  attrs[4].key_len = 4;
+  attrs[4].type = NRT_ATTRIBUTE_BOOL;
+  attrs[4].value.bool_value = true;
+
+  nrt_span_desc_t descs[3];
+  memset(descs, 0, sizeof(descs));
+  descs[0].id = "span_id1";
+  descs[0].id_len = 8;
+  descs[0].trace_id = "trace_id";
+  descs[0].trace_id_len = 8;
+  descs[0].name = "Root span";
+  descs[0].name_len = 9;
+  descs[0].service_name = "Telemetry Application";
+  descs[0].service_name_len = 21;
+  descs[0].timestamp = 1000;
+  descs[0].duration = 2000;
+  descs[0].attributes = attrs;
+  descs[0].attributes_len = 5;
+
+  /* Strings don't need to be NUL-terminated. */
+  descs[1].id = "span_id2 and more";
+  descs[1].id_len = 8;
+  descs[1].trace_id = "trace_id";
+  descs[1].trace_id_len = 8;
+  descs[1].parent_id = "span_id1";
+  descs[1].parent_id_len = 8;
+  descs[1].timestamp = 1500;
+  descs[1].duration = 500;
+
+  /* A descriptor without an id is skipped. */
+  descs[2].trace_id = "trace_id";
+  descs[2].trace_id_len = 8;
+
+  size_t count = nrt_span_batch_record_many(batch, descs, 3);
+  assert(2 == count);
+  count = nrt_span_batch_record_many(batch, descs, 0);
+  assert(0 == count);
+
+  /*
+   * Set attributes shared by all spans of the batch once, instead of on
+   * every span. Spans can still override them.
+   */
+  nrt_attributes_t* common = nrt_attributes_new();
+  nrt_attributes_set_string(common, "host", "ip-10-0-0-1.ec2.internal");
+  nrt_attributes_set_string(common, "deployment.environment", "production");
+  bool set = nrt_span_batch_set_common_attributes(batch, &common);
+  assert(set);
+  assert(NULL == common);
+
+  nrt_span_batch_destroy(&batch);
+  assert(NULL == batch);
+
+  /* Call with NULL values */
+  span = NULL;
+  nrt_span_batch_record(NULL, NULL);
+  nrt_span_batch_record(NULL, &span);
+  nrt_span_batch_record_many(NULL, descs, 3);
+  nrt_span_batch_record_many(batch, NULL, 3);
+  common = nrt_attributes_new();
+  set = nrt_span_batch_set_common_attributes(NULL, &common);
+  assert(!set);
+  assert(NULL == common);
+  nrt_span_batch_set_common_attributes(NULL, NULL);
+  nrt_span_batch_destroy(NULL);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Create spans, attributes and batches from a pool and recycle them.
+ */
+int main() {
+  /* Destroy a NULL pool. */
+  nrt_span_pool_t* pool = NULL;
+  nrt_span_pool_destroy(&pool);
+
+  pool = nrt_span_pool_new(10, 10, 1);
+  assert(pool);
+
+  for (int round = 0; round < 3; round++) {
+    nrt_span_batch_t* batch = nrt_span_pool_batch_new(pool);
+    assert(batch);
+
+    for (int i = 0; i < 5; i++) {
+      nrt_span_t* span
+          = nrt_span_pool_span_new(pool, "span_id", "trace_id", 1000);
+      assert(span);
+      nrt_span_set_name(span, "Pooled span");
+
+      nrt_attributes_t* attrs = nrt_span_pool_attributes_new(pool);
+      assert(attrs);
+      nrt_attributes_set_string(attrs, "string", "value");
+      nrt_span_set_attributes(span, &attrs);
+
+      nrt_span_batch_record(batch, &span);
+    }
+
+    /* Destroying the batch returns all its spans to the pool. */
+    nrt_span_batch_destroy(&batch);
+    assert(NULL == batch);
+  }
+
+  nrt_span_pool_stats_t stats;
+  bool written = nrt_span_pool_get_stats(pool, &stats);
+  assert(written);
+  assert(5 == stats.spans.allocated);
+  assert(10 == stats.spans.reused);
+  assert(5 == stats.spans.pooled);
+  assert(1 == stats.attributes.allocated);
+  assert(1 == stats.batches.allocated);
+  assert(2 == stats.batches.reused);
+
+  /* Spans outliving the pool handle stay valid. */
+  nrt_span_t* span
+      = nrt_span_pool_span_new_n(pool, "span_id", 7, "trace_id", 8, 0);
+  nrt_span_pool_destroy(&pool);
+  assert(NULL == pool);
+  nrt_span_set_name(span, "Orphaned span");
+  nrt_span_destroy(&span);
+
+  /* Call with NULL values */
+  nrt_span_pool_span_new(NULL, "span_id", "trace_id", 1000);
+  nrt_span_pool_span_new_n(NULL, "span_id", 7, "trace_id", 8, 1000);
+  nrt_span_pool_attributes_new(NULL);
+  nrt_span_pool_batch_new(NULL);
+  nrt_span_pool_get_stats(NULL, &stats);
+  nrt_span_pool_destroy(NULL);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Create spans at a hot call site from a template, which holds the name,
+ * service name and attributes they all share.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  uint64_t high, low;
+  int i;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  /* Create the template once, for example at startup. */
+  nrt_attributes_t* attrs = nrt_attributes_new();
+  nrt_attributes_set_string(attrs, "db.system", "postgresql");
+  nrt_attributes_set_string(attrs, "db.statement", "SELECT * FROM users");
+  nrt_attributes_set_int(attrs, "db.pool", 1);
+  nrt_span_template_t* tmpl =
+      nrt_span_template_new("SELECT users", "Telemetry Application", &attrs);
+  assert(tmpl);
+  assert(NULL == attrs);
+
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  /*
+   * Only the ids, timestamps and additional attributes of each span are
+   * stored per span.
+   */
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  for (i = 0; i < 100; i++) {
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span =
+        nrt_span_from_template_u64(tmpl, nrt_generate_span_id(), high, low, 0);
+    assert(span);
+    nrt_span_start(span);
+    nrt_span_end(span);
+    if (i % 10 == 0) {
+      /* Attributes set on the span replace those of the template. */
+      attrs = nrt_attributes_new();
+      nrt_attributes_set_int(attrs, "db.pool", 2);
+      nrt_attributes_set_bool(attrs, "error", true);
+      nrt_span_set_attributes(span, &attrs);
+    }
+    nrt_span_batch_record(batch, &span);
+  }
+
+  /* Spans can also be created with textual ids. */
+  nrt_span_t* span =
+      nrt_span_from_template(tmpl, "e9f54a2c322d7578", "1b1bf29379951c1d", 0);
+  assert(span);
+  nrt_span_set_name(span, "SELECT users by id");
+  nrt_span_batch_record(batch, &span);
+
+  /* Spans remain valid after their template was destroyed. */
+  nrt_span_template_destroy(&tmpl);
+  assert(NULL == tmpl);
+
+  nrt_send_result_t result = nrt_client_enqueue(client, &batch);
+  assert(NRT_SEND_QUEUED == result);
+  nrt_client_shutdown(&client);
+
+  /* A NULL name, service name or attribute collection is left unset. */
+  tmpl = nrt_span_template_new(NULL, NULL, NULL);
+  assert(tmpl);
+  span = nrt_span_from_template_u64(tmpl, 0, 1, 2, 0);
+  assert(NULL == span);
+  nrt_span_template_destroy(&tmpl);
+
+  /* Call with NULL parameters. */
+  span = nrt_span_from_template(NULL, "span_id", "trace_id", 0);
+  assert(NULL == span);
+  span = nrt_span_from_template_u64(NULL, 1, 1, 2, 0);
+  assert(NULL == span);
+  span = nrt_span_from_template(tmpl, "span_id", "trace_id", 0);
+  assert(NULL == span);
+  nrt_span_template_destroy(NULL);
+  nrt_span_template_destroy(&tmpl);
+}
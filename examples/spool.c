@@ -0,0 +1,205 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OS_WINDOWS
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#define sleep_ms Sleep
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+typedef int socket_t;
+#define close_socket close
+static void sleep_ms(unsigned ms) {
+  struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+  nanosleep(&ts, NULL);
+}
+#endif
+
+#define SPOOL_DIR "nrt-spool-example"
+#define BATCHES 50
+
+/*
+ * Listen on a local port, standing in for the trace endpoint. Connections are
+ * never accepted, they only have to be established for the endpoint to count
+ * as reachable. If `port` is zero, an unused port is picked.
+ */
+static socket_t listen_on(uint16_t* port) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int reuse = 1;
+
+  socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(*port);
+  if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(s, 16) != 0) {
+    fprintf(stderr, "unable to listen on port %u\n", *port);
+    exit(1);
+  }
+  getsockname(s, (struct sockaddr*)&addr, &len);
+  *port = ntohs(addr.sin_port);
+  return s;
+}
+
+static nrt_client_t* new_client(uint16_t port, size_t queue_max) {
+  nrt_client_config_t* cfg = nrt_client_config_new("spool-example");
+  nrt_client_config_set_endpoint_traces(cfg, "127.0.0.1", port);
+  nrt_client_config_set_retries_max(cfg, 0);
+  nrt_client_config_set_queue_max(cfg, queue_max);
+  nrt_client_config_set_spool(cfg, SPOOL_DIR, 1024 * 1024);
+  return nrt_client_new(&cfg);
+}
+
+static nrt_span_batch_t* new_batch(int count) {
+  nrt_span_batch_t* batch = nrt_span_batch_new();
+  int i;
+
+  for (i = 0; i < count; i++) {
+    uint64_t high, low;
+    nrt_generate_trace_id(&high, &low);
+    nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+    nrt_span_set_name(span, "GET /api");
+    nrt_span_set_duration_us(span, 1500);
+    nrt_span_batch_record(batch, &span);
+  }
+  return batch;
+}
+
+static void send_spans(nrt_client_t* client, int count) {
+  nrt_span_batch_t* batch = new_batch(count);
+  bool sent = nrt_client_send(client, &batch);
+  assert(sent);
+}
+
+/* Wait until all spooled batches were replayed. */
+static void wait_for_replay(nrt_client_t* client, nrt_spool_stats_t* stats) {
+  int i;
+
+  for (i = 0; i < 100; i++) {
+    send_spans(client, 0);
+    nrt_client_get_spool_stats(client, stats);
+    if (0 == stats->segments) {
+      break;
+    }
+    sleep_ms(100);
+  }
+}
+
+/*
+ * Spool batches to disk while the trace endpoint is down, and send them once
+ * it is back up, even from another client after a restart.
+ */
+int main() {
+  nrt_span_batch_t* batches[BATCHES];
+  nrt_spool_stats_t stats;
+  uint64_t spooled = 0;
+  uint16_t port = 0;
+  int i;
+
+#ifdef OS_WINDOWS
+  WSADATA wsa;
+  WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+  /* Find an unused port, then take the endpoint down. */
+  close_socket(listen_on(&port));
+
+  /* While the endpoint is down, batches go to the spool. */
+  nrt_client_t* client = new_client(port, 100);
+  assert(client);
+  for (i = 0; i < 3; i++) {
+    send_spans(client, 100);
+  }
+  bool ok = nrt_client_get_spool_stats(client, &stats);
+  assert(ok);
+  assert(3 == stats.batches_spooled);
+  assert(stats.segments >= 1);
+
+  /*
+   * Batches submitted without blocking are handed to a background thread for
+   * spooling, so an event loop never waits for the disk.
+   */
+  for (i = 0; i < 2; i++) {
+    nrt_span_batch_t* batch = new_batch(100);
+    nrt_send_result_t result = nrt_client_submit(client, &batch, NULL, NULL);
+    assert(NRT_SEND_SPOOLED == result);
+  }
+  nrt_client_shutdown(&client);
+
+  /* The spooled batches survive the client. */
+  client = new_client(port, 100);
+  assert(client);
+  ok = nrt_client_get_spool_stats(client, &stats);
+  assert(ok);
+  assert(0 == stats.batches_replayed);
+  assert(stats.bytes > 0);
+
+  /*
+   * Bring the endpoint back up. Once the client notices, spooled batches are
+   * sent along with new batches.
+   */
+  socket_t endpoint = listen_on(&port);
+  wait_for_replay(client, &stats);
+  printf("replayed %llu batches\n", (unsigned long long)stats.batches_replayed);
+  assert(stats.batches_replayed >= 5);
+  assert(0 == stats.segments);
+  assert(0 == stats.bytes);
+  nrt_client_shutdown(&client);
+
+  /*
+   * While the endpoint is up, batches the queue has no room for go to the
+   * spool instead of being dropped, and are sent once the queue drained.
+   * Batches are built up front and queued faster than they are sent.
+   */
+  client = new_client(port, 2);
+  assert(client);
+  for (i = 0; i < BATCHES; i++) {
+    batches[i] = new_batch(200);
+  }
+  for (i = 0; i < BATCHES; i++) {
+    nrt_send_result_t result = nrt_client_enqueue(client, &batches[i]);
+    assert(NRT_SEND_QUEUED == result || NRT_SEND_SPOOLED == result);
+    spooled += NRT_SEND_SPOOLED == result;
+  }
+  ok = nrt_client_get_spool_stats(client, &stats);
+  assert(ok);
+  printf("spooled %llu of %d batches\n", (unsigned long long)spooled,
+         BATCHES);
+  assert(spooled > 0);
+  assert(spooled == stats.batches_spooled);
+  wait_for_replay(client, &stats);
+  assert(stats.batches_replayed >= spooled);
+  assert(0 == stats.segments);
+
+  /* Take the endpoint down again, so pending requests fail right away. */
+  close_socket(endpoint);
+  nrt_client_shutdown(&client);
+
+  /* Call with NULL parameters. */
+  nrt_client_config_set_spool(NULL, SPOOL_DIR, 1024);
+  ok = nrt_client_get_spool_stats(NULL, &stats);
+  assert(!ok);
+
+  remove(SPOOL_DIR);
+#ifdef OS_WINDOWS
+  WSACleanup();
+#endif
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "newrelic-telemetry-sdk.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BATCHES 50
+#define SPANS_PER_BATCH 20
+
+static void print_latency(const char* name, const nrt_latency_stats_t* l) {
+  printf("%-8s count %llu, p50 %llu ns, p99 %llu ns, max %llu ns\n", name,
+         (unsigned long long)l->count, (unsigned long long)l->p50_ns,
+         (unsigned long long)l->p99_ns, (unsigned long long)l->max_ns);
+}
+
+/*
+ * Send a few batches through a client with a small queue, then look at what
+ * happened to them.
+ */
+int main() {
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  nrt_client_stats_t stats;
+  uint64_t outcomes;
+  int i, j;
+
+  if (!api_key) {
+    fprintf(stderr, "NEW_RELIC_API_KEY not set\n");
+    exit(1);
+  }
+
+  nrt_client_config_t* cfg = nrt_client_config_new(api_key);
+  nrt_client_config_set_queue_max(cfg, 8);
+  nrt_client_config_set_sender_threads(cfg, 2);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  assert(client);
+
+  for (i = 0; i < BATCHES; i++) {
+    nrt_span_batch_t* batch = nrt_span_batch_new();
+    for (j = 0; j < SPANS_PER_BATCH; j++) {
+      uint64_t high, low;
+      nrt_generate_trace_id(&high, &low);
+      nrt_span_t* span = nrt_span_new_u64(nrt_generate_span_id(), high, low, 0);
+      nrt_span_set_name(span, "GET /api");
+      nrt_span_batch_record(batch, &span);
+    }
+    nrt_client_enqueue(client, &batch);
+  }
+
+  bool ok = nrt_client_get_stats(client, &stats);
+  assert(ok);
+  printf("queue %llu/%llu, queued %llu, dropped %llu, sent %llu\n",
+         (unsigned long long)stats.queue_depth,
+         (unsigned long long)stats.queue_capacity,
+         (unsigned long long)stats.batches_queued,
+         (unsigned long long)stats.batches_dropped,
+         (unsigned long long)stats.batches_sent);
+  print_latency("enqueue", &stats.enqueue_latency);
+  print_latency("queue", &stats.queue_latency);
+  print_latency("send", &stats.send_latency);
+
+  /* Every batch has exactly one outcome. */
+  outcomes = stats.batches_queued + stats.batches_queued_dropped_oldest +
+             stats.batches_queued_sampled + stats.batches_spooled +
+             stats.batches_dropped + stats.batches_timed_out;
+  assert(BATCHES == outcomes);
+  assert(BATCHES == stats.enqueue_latency.count);
+  assert(BATCHES * SPANS_PER_BATCH == stats.spans_enqueued);
+  assert(stats.batches_dropped * SPANS_PER_BATCH == stats.spans_dropped);
+  assert(8 == stats.queue_capacity);
+  assert(stats.queue_depth <= stats.queue_capacity);
+  assert(stats.batches_sent <= stats.batches_queued);
+  assert(stats.enqueue_latency.p50_ns <= stats.enqueue_latency.p99_ns);
+  assert(stats.enqueue_latency.p99_ns <= stats.enqueue_latency.max_ns);
+
+  nrt_client_shutdown(&client);
+
+  /* Call with NULL parameters. */
+  ok = nrt_client_get_stats(NULL, &stats);
+  assert(!ok);
+}
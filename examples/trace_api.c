@@ -70,6 +70,20 @@ int main() {
     assert(NULL == span);
   }
 
+  /* Create a child span timed with the built-in clock */
+  {
+    nrt_span_t* span
+        = nrt_span_new("5ff1c2a7b1d7ae2c", "1b1bf29379951c1d", 0);
+    nrt_span_start(span);
+    nrt_span_set_name(span, "Child span");
+    nrt_span_set_parent_id(span, "e9f54a2c322d7578");
+    nrt_span_set_service_name(span, "Telemetry Application");
+    nrt_span_end(span);
+
+    nrt_span_batch_record(batch, &span);
+    assert(NULL == span);
+  }
+
   /* Queue the span batch */
   nrt_client_send(client, &batch);
   assert(NULL == batch);
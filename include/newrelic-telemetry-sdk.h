@@ -59,6 +59,338 @@ typedef struct _nrt_span_t nrt_span_t;
  */
 typedef struct _nrt_attributes_t nrt_attributes_t;
 
+/**
+ * @brief A span template.
+ *
+ * Holds the name, service name and attributes that all spans created at one
+ * call site share. Spans created from a template refer to these instead of
+ * copying them. See nrt_span_template_new().
+ */
+typedef struct _nrt_span_template_t nrt_span_template_t;
+
+/**
+ * @brief An interned string.
+ *
+ * Interned strings are meant for keys and values that are used over and over
+ * again, like attribute keys, span names or service names. They are created
+ * once, for example at startup, via nrt_intern() and can then be passed to
+ * functions with an `_i` suffix, which don't have to convert, validate or copy
+ * the string again.
+ *
+ * Interned strings are never freed and remain valid for the lifetime of the
+ * process, so only a bounded set of strings should be interned.
+ */
+typedef struct _nrt_interned_t nrt_interned_t;
+
+/**
+ * @brief A pool of spans, attribute collections and span batches.
+ *
+ * Spans, attribute collections and span batches created from a pool are
+ * returned to the pool instead of being freed when they are destroyed, added
+ * to a span or span batch, or sent. Their internal buffers stay allocated, so
+ * reusing them avoids most allocations on the hot path.
+ *
+ * Pools are thread-safe. Each thread returns objects to and takes objects
+ * from its own part of the pool, so threads don't contend on a single lock.
+ */
+typedef struct _nrt_span_pool_t nrt_span_pool_t;
+
+/**
+ * @brief A counter.
+ *
+ * Counts occurrences, such as requests or bytes sent, and reports the total
+ * of each interval. See nrt_counter_new().
+ */
+typedef struct _nrt_counter_t nrt_counter_t;
+
+/**
+ * @brief A gauge.
+ *
+ * Holds the last of a series of values, such as a queue length, and reports
+ * it every interval. See nrt_gauge_new().
+ */
+typedef struct _nrt_gauge_t nrt_gauge_t;
+
+/**
+ * @brief A summary.
+ *
+ * Reports count, sum, minimum and maximum of the values recorded in each
+ * interval, such as response sizes. See nrt_summary_new().
+ */
+typedef struct _nrt_summary_t nrt_summary_t;
+
+/**
+ * @brief A replay of exported span batches.
+ *
+ * Reads the files written by a client configured with
+ * nrt_client_config_set_export() back as span batches. See nrt_replay_open().
+ */
+typedef struct _nrt_replay_t nrt_replay_t;
+
+/**
+ * @brief Statistics about one kind of object in a pool.
+ */
+typedef struct {
+  /** Objects newly allocated because the pool was empty. */
+  uint64_t allocated;
+  /** Objects taken from the pool instead of being allocated. */
+  uint64_t reused;
+  /** Objects returned to the pool. */
+  uint64_t recycled;
+  /** Objects freed instead of returned because the pool was full. */
+  uint64_t discarded;
+  /** Objects currently held by the pool. */
+  uint64_t pooled;
+} nrt_span_pool_object_stats_t;
+
+/**
+ * @brief Statistics about a pool.
+ */
+typedef struct {
+  nrt_span_pool_object_stats_t spans;
+  nrt_span_pool_object_stats_t attributes;
+  nrt_span_pool_object_stats_t batches;
+} nrt_span_pool_stats_t;
+
+/**
+ * @brief Sampling statistics of a client.
+ *
+ * All counters are in spans.
+ */
+typedef struct {
+  /** Spans that passed the sampler and were queued for sending. */
+  uint64_t kept;
+  /** Spans dropped by probabilistic head sampling. */
+  uint64_t dropped_ratio;
+  /** Spans dropped because the trace rate limit was exceeded. */
+  uint64_t dropped_rate_limit;
+  /** Spans dropped by tail sampling. */
+  uint64_t dropped_tail;
+  /** Spans currently held back until their trace is decided. */
+  uint64_t pending_tail;
+} nrt_sampling_stats_t;
+
+/**
+ * @brief What a client does with a batch when its queue is full.
+ */
+typedef enum {
+  /** Drop the batch. This is the default. */
+  NRT_BACKPRESSURE_DROP_NEWEST = 0,
+  /** Drop the oldest queued batch to make room for the batch. */
+  NRT_BACKPRESSURE_DROP_OLDEST = 1,
+  /** Wait for room in the queue, up to a timeout. */
+  NRT_BACKPRESSURE_BLOCK = 2,
+  /**
+   * Once the queue is half full, keep only a share of the traces of each
+   * batch, from all traces at half full down to none when full. Spans of the
+   * same trace are kept or dropped together.
+   */
+  NRT_BACKPRESSURE_SAMPLE = 3,
+} nrt_backpressure_t;
+
+/**
+ * @brief The outcome of nrt_client_enqueue() and nrt_client_submit().
+ */
+typedef enum {
+  /** The batch was queued. */
+  NRT_SEND_QUEUED = 0,
+  /** The batch was queued after dropping the oldest queued batch. */
+  NRT_SEND_QUEUED_DROPPED_OLDEST = 1,
+  /** Some spans of the batch were sampled out, the rest was queued. */
+  NRT_SEND_QUEUED_SAMPLED = 2,
+  /**
+   * The endpoint is unreachable, or the queue was full, and the batch was
+   * written to the spool, or handed to a background thread for writing by
+   * nrt_client_submit().
+   */
+  NRT_SEND_SPOOLED = 3,
+  /** The queue was full and the batch was dropped. */
+  NRT_SEND_DROPPED = 4,
+  /** The queue stayed full until the timeout and the batch was dropped. */
+  NRT_SEND_TIMEOUT = 5,
+  /** The client or the batch was NULL. */
+  NRT_SEND_INVALID = 6,
+} nrt_send_result_t;
+
+/**
+ * @brief What became of a batch passed to nrt_client_submit().
+ */
+typedef enum {
+  /**
+   * The batch was taken from the queue and handed to the SDK, which sends it
+   * and retries on failure, but doesn't report whether it was accepted.
+   */
+  NRT_DELIVERY_HANDED_OFF = 0,
+  /**
+   * The batch was dropped from the queue to make room for a newer batch, or
+   * because the client was destroyed.
+   */
+  NRT_DELIVERY_DROPPED = 1,
+  /**
+   * The batch was written to the spool because a flush or shutdown ran out
+   * of time, and is replayed from the spool later.
+   */
+  NRT_DELIVERY_SPOOLED = 2,
+} nrt_delivery_t;
+
+/**
+ * @brief What a flush or shutdown with a timeout left undelivered.
+ *
+ * Spans already handed to the SDK are sent by it and aren't counted here.
+ */
+typedef struct {
+  /**
+   * Spans not handed to the SDK yet: still queued after nrt_client_flush(),
+   * or held by sender threads still running after
+   * nrt_client_shutdown_timeout().
+   */
+  uint64_t spans_pending;
+  /** Spans written to the spool instead of being sent. */
+  uint64_t spans_spooled;
+  /** Spans dropped because the timeout passed and there is no spool. */
+  uint64_t spans_dropped;
+  /**
+   * SDK clients still sending, retrying or backing off when the timeout
+   * passed. They are left to finish in the background, and the spans they
+   * hold are lost if the process exits.
+   */
+  uint64_t sdk_clients_abandoned;
+  /** Whether the timeout passed before everything was handed over. */
+  bool timed_out;
+} nrt_flush_result_t;
+
+/**
+ * @brief A callback receiving the delivery of a submitted batch.
+ *
+ * @param delivery What became of the batch.
+ * @param spans The number of spans in the batch after sampling.
+ * @param user_data The user data passed to nrt_client_submit().
+ */
+typedef void (*nrt_completion_fn)(nrt_delivery_t delivery,
+                                  size_t spans,
+                                  void* user_data);
+
+/**
+ * @brief Spool statistics of a client.
+ */
+typedef struct {
+  /** Segment files in the spool directory. */
+  uint64_t segments;
+  /** Bytes in the spool directory. */
+  uint64_t bytes;
+  /** Batches written to the spool. */
+  uint64_t batches_spooled;
+  /** Spooled batches handed back to the client for sending. */
+  uint64_t batches_replayed;
+  /** Spooled batches deleted to stay within the byte budget, or lost to
+   * errors. */
+  uint64_t batches_dropped;
+} nrt_spool_stats_t;
+
+/**
+ * @brief Statistics of a replay.
+ */
+typedef struct {
+  /** Files opened so far. */
+  uint64_t files;
+  /** Bytes of lines read, after decompression. */
+  uint64_t bytes;
+  /** Batches returned by nrt_replay_next(). */
+  uint64_t batches;
+  /** Spans in those batches. */
+  uint64_t spans;
+  /** Lines skipped because they aren't valid span batches. */
+  uint64_t lines_skipped;
+} nrt_replay_stats_t;
+
+/**
+ * @brief Summary of a latency histogram.
+ *
+ * Percentiles are estimated from log-linear buckets and are within about 3%
+ * of the exact value.
+ */
+typedef struct {
+  /** Recorded latencies. */
+  uint64_t count;
+  /** Sum of all latencies in nanoseconds. */
+  uint64_t sum_ns;
+  /** Maximum latency in nanoseconds. */
+  uint64_t max_ns;
+  /** Median latency in nanoseconds. */
+  uint64_t p50_ns;
+  /** 90th percentile in nanoseconds. */
+  uint64_t p90_ns;
+  /** 99th percentile in nanoseconds. */
+  uint64_t p99_ns;
+  /** 99.9th percentile in nanoseconds. */
+  uint64_t p999_ns;
+} nrt_latency_stats_t;
+
+/**
+ * @brief Statistics of a client.
+ *
+ * All counters are cumulative since the client was created. The outcome of
+ * every call to nrt_client_enqueue() or nrt_client_send() is counted in
+ * exactly one of the batch counters, from batches_queued to
+ * batches_timed_out.
+ *
+ * HTTP requests, retries, backoff and compression happen inside the SDK,
+ * which doesn't report on them. Spooled batches that are sent later are
+ * counted in nrt_spool_stats_t.
+ */
+typedef struct {
+  /** Batches in the send queue. */
+  uint64_t queue_depth;
+  /** Capacity of the send queue. */
+  uint64_t queue_capacity;
+  /** Batches queued, see NRT_SEND_QUEUED. */
+  uint64_t batches_queued;
+  /** Batches queued after dropping the oldest batch, see
+   * NRT_SEND_QUEUED_DROPPED_OLDEST. */
+  uint64_t batches_queued_dropped_oldest;
+  /** Batches queued after sampling, see NRT_SEND_QUEUED_SAMPLED. */
+  uint64_t batches_queued_sampled;
+  /** Batches written to the spool, see NRT_SEND_SPOOLED. */
+  uint64_t batches_spooled;
+  /** Batches dropped, see NRT_SEND_DROPPED. */
+  uint64_t batches_dropped;
+  /** Batches dropped after waiting for room, see NRT_SEND_TIMEOUT. */
+  uint64_t batches_timed_out;
+  /** Queued batches dropped to make room for newer ones. */
+  uint64_t batches_evicted;
+  /** Batches taken from the queue and handed to the SDK for sending. */
+  uint64_t batches_sent;
+  /** Payloads the sent batches were split into, one request each. See
+   * nrt_client_config_set_payload_max(). */
+  uint64_t payloads_sent;
+  /** Estimated size of the sent payloads in bytes, before compression. */
+  uint64_t payload_bytes_sent;
+  /** Spans passed on by the sampler and the aggregator. */
+  uint64_t spans_enqueued;
+  /** Spans dropped because the queue was full. */
+  uint64_t spans_dropped;
+  /** Spans handed to the SDK for sending. */
+  uint64_t spans_sent;
+  /** Time spent in nrt_client_enqueue() or nrt_client_send(), including
+   * sampling, aggregation and waiting for room in the queue. */
+  nrt_latency_stats_t enqueue_latency;
+  /** Time batches spent in the send queue. */
+  nrt_latency_stats_t queue_latency;
+  /** Time taken to convert a batch and hand it to the SDK. */
+  nrt_latency_stats_t send_latency;
+} nrt_client_stats_t;
+
+/**
+ * @brief A span recorder.
+ *
+ * A recorder sits on top of a client and takes care of batching. Any number
+ * of threads can record finished spans to a recorder. Each thread appends
+ * spans to its own buffer without taking locks, and a background thread
+ * collects the buffered spans into span batches and sends them via the
+ * client, either when a batch is full or when the flush interval elapsed.
+ */
+typedef struct _nrt_recorder_t nrt_recorder_t;
+
 /**
  * @brief Indicates a point in time or a duration.
  *
@@ -67,6 +399,212 @@ typedef struct _nrt_attributes_t nrt_attributes_t;
  */
 typedef uint64_t nrt_time_t;
 
+/**
+ * @brief The number of latency buckets of a span aggregate.
+ *
+ * Latencies are counted in log-linear buckets of nanoseconds. Buckets 0 to 15
+ * hold latencies of 0 to 15 ns. Above that, every power of two is split into
+ * 16 buckets of equal width, so bucket `i` starts at `(16 + i % 16) << (i /
+ * 16 - 1)` ns and is `1 << (i / 16 - 1)` ns wide. Latencies of 2^45 ns and
+ * more are counted in the last bucket.
+ */
+#define NRT_SPAN_AGGREGATE_BUCKETS 688
+
+/**
+ * @brief Rate, errors and latencies of spans over one interval.
+ *
+ * Spans are aggregated per name and service name. Strings are not
+ * null-terminated.
+ */
+typedef struct {
+  /** The span name. */
+  const char* name;
+  size_t name_len;
+  /** The service name. */
+  const char* service_name;
+  size_t service_name_len;
+  /** The start of the interval, in milliseconds since the Epoch. */
+  nrt_time_t start;
+  /** The end of the interval, in milliseconds since the Epoch. */
+  nrt_time_t end;
+  /** The number of spans. */
+  uint64_t count;
+  /** The number of spans with an `error` attribute that isn't false. */
+  uint64_t errors;
+  /** The sum of the durations of all spans in milliseconds. */
+  double duration_sum_ms;
+  /** The shortest duration in milliseconds. */
+  double duration_min_ms;
+  /** The longest duration in milliseconds. */
+  double duration_max_ms;
+  /** Span counts per latency bucket, see NRT_SPAN_AGGREGATE_BUCKETS. */
+  const uint64_t* buckets;
+  size_t buckets_len;
+} nrt_span_aggregate_t;
+
+/**
+ * @brief A callback receiving span aggregates.
+ *
+ * The aggregates are only valid during the call. Histograms of the same name
+ * and service name can be merged by adding up the bucket counts.
+ *
+ * The callback may call into the client, for example to harvest again or to
+ * shut it down. Calls for different intervals may overlap if aggregates are
+ * harvested on demand while the background thread passes on an interval.
+ *
+ * @param aggregates The aggregates of one interval.
+ * @param len The number of aggregates.
+ * @param user_data The user data passed to nrt_client_config_set_aggregation().
+ */
+typedef void (*nrt_span_aggregate_fn)(const nrt_span_aggregate_t* aggregates,
+                                      size_t len,
+                                      void* user_data);
+
+/**
+ * @brief The type of a metric.
+ */
+typedef enum {
+  /** The total of a counter over the interval, in `value`. */
+  NRT_METRIC_COUNT = 0,
+  /** The last value of a gauge, in `value`. */
+  NRT_METRIC_GAUGE = 1,
+  /** The values of a summary, in `count`, `sum`, `min` and `max`. */
+  NRT_METRIC_SUMMARY = 2,
+} nrt_metric_type_t;
+
+/**
+ * @brief The value of an instrument over one interval.
+ *
+ * Strings are not null-terminated. Fields not used by the type of the metric
+ * are zero.
+ */
+typedef struct {
+  /** The name of the instrument. */
+  const char* name;
+  size_t name_len;
+  nrt_metric_type_t type;
+  /** The start of the interval, in milliseconds since the Epoch. */
+  nrt_time_t start;
+  /** The end of the interval, in milliseconds since the Epoch. */
+  nrt_time_t end;
+  /** The value of a count or gauge. */
+  double value;
+  /** The number of values recorded to a summary. */
+  uint64_t count;
+  /** The sum of the values recorded to a summary. */
+  double sum;
+  /** The smallest value recorded to a summary. */
+  double min;
+  /** The largest value recorded to a summary. */
+  double max;
+} nrt_metric_t;
+
+/**
+ * @brief A callback receiving metrics.
+ *
+ * The metrics are only valid during the call.
+ *
+ * The callback may call into the client, for example to harvest again or to
+ * shut it down. Calls for different intervals may overlap if metrics are
+ * harvested on demand while the background thread passes on an interval.
+ *
+ * @param metrics The metrics of one interval.
+ * @param len The number of metrics.
+ * @param user_data The user data passed to nrt_client_config_set_metrics().
+ */
+typedef void (*nrt_metric_fn)(const nrt_metric_t* metrics,
+                              size_t len,
+                              void* user_data);
+
+/*
+ * Length-delimited strings
+ *
+ * Functions with an `_n` suffix take strings as a pointer and a length in
+ * bytes instead of a NUL-terminated string. The string doesn't have to be
+ * NUL-terminated, which saves a `strlen` for callers that already know the
+ * length of their strings.
+ *
+ * All strings must be valid UTF-8. Strings are validated unless the SDK is
+ * built with the `ENABLE_TRUSTED_UTF8` CMake option, in which case the
+ * validation is skipped in release builds and the caller is responsible for
+ * passing valid UTF-8.
+ */
+
+/*
+ * Static strings
+ *
+ * Functions with an `_s` suffix take NUL-terminated strings that remain valid
+ * and unchanged for the lifetime of the process, like string literals. The
+ * SDK keeps a pointer to the string instead of copying it. Unlike interned
+ * strings, static strings don't have to be created upfront, but they can't be
+ * built at runtime either: spans may be sent, sampled or spooled long after
+ * the setter returns, so a string that is only valid until then isn't enough.
+ *
+ * Passing a string that is freed or changed later is undefined behavior.
+ * Debug builds of the SDK catch the most common mistakes: they abort with a
+ * message if a static string is on the stack of the calling thread, or if its
+ * contents changed by the time the span is sent.
+ */
+
+/**
+ * @brief Represents the type of the value of an attribute descriptor.
+ */
+typedef enum {
+  NRT_ATTRIBUTE_INT = 0,
+  NRT_ATTRIBUTE_UINT = 1,
+  NRT_ATTRIBUTE_DOUBLE = 2,
+  NRT_ATTRIBUTE_STRING = 3,
+  NRT_ATTRIBUTE_BOOL = 4,
+} nrt_attribute_type_t;
+
+/**
+ * @brief A plain description of an attribute.
+ *
+ * Attribute descriptors are owned by the caller and are only read by
+ * nrt_span_batch_record_many(). Strings are given as a pointer and a length
+ * in bytes and don't have to be NUL-terminated.
+ */
+typedef struct {
+  const char* key;
+  size_t key_len;
+  nrt_attribute_type_t type;
+  union {
+    int64_t int_value;
+    uint64_t uint_value;
+    double double_value;
+    struct {
+      const char* ptr;
+      size_t len;
+    } string_value;
+    bool bool_value;
+  } value;
+} nrt_attribute_desc_t;
+
+/**
+ * @brief A plain description of a span.
+ *
+ * Span descriptors are owned by the caller and are only read by
+ * nrt_span_batch_record_many(). Strings are given as a pointer and a length
+ * in bytes and don't have to be NUL-terminated. The optional fields
+ * `parent_id`, `name` and `service_name` are ignored if NULL.
+ */
+typedef struct {
+  const char* id;
+  size_t id_len;
+  const char* trace_id;
+  size_t trace_id_len;
+  const char* parent_id;
+  size_t parent_id_len;
+  const char* name;
+  size_t name_len;
+  const char* service_name;
+  size_t service_name_len;
+  nrt_time_t timestamp;
+  nrt_time_t duration;
+  const nrt_attribute_desc_t* attributes;
+  size_t attributes_len;
+} nrt_span_desc_t;
+
 /**
  * @brief Create a new attribute collection.
  *
@@ -76,6 +614,26 @@ typedef uint64_t nrt_time_t;
  */
 nrt_attributes_t* nrt_attributes_new();
 
+/**
+ * @brief Intern a string.
+ *
+ * Interning the same string repeatedly returns the same handle. This function
+ * is thread-safe.
+ *
+ * @param s The string to intern.
+ * @return An interned string, or NULL if the string is NULL or invalid.
+ */
+const nrt_interned_t* nrt_intern(const char* s);
+
+/**
+ * @brief Intern a length-delimited string.
+ *
+ * @param s The string to intern.
+ * @param len The length of the string in bytes.
+ * @return An interned string, or NULL if the string is NULL or invalid.
+ */
+const nrt_interned_t* nrt_intern_n(const char* s, size_t len);
+
 /**
  * @brief Represents the available verbosity levels of the logger.
  */
@@ -87,12 +645,36 @@ typedef enum {
   NRT_LOG_TRACE = 4,
 } nrt_log_level_t;
 
+/**
+ * @brief Counters of the logger.
+ */
+typedef struct {
+  /** Messages written to the log. */
+  uint64_t messages_written;
+  /** Messages dropped because the queue was full or writing failed. */
+  uint64_t messages_dropped;
+  /** Messages dropped because their call site logged too often. */
+  uint64_t messages_rate_limited;
+  /** Times the log file was rotated. */
+  uint64_t files_rotated;
+} nrt_log_stats_t;
+
 /**
  * @brief Initialize logging.
  *
  * This will cause the Telemetry SDK to log messages of the given level to the
  * file of the given name.
  *
+ * Logging never blocks the logging thread on I/O: messages are put into a
+ * bounded queue and written by a background thread. Messages are dropped
+ * when the queue is full, and when a single call site logs more than 20
+ * messages per second. See nrt_log_get_stats(). Queued messages are written
+ * when a client is shut down, and are lost if the process exits before they
+ * were written, see nrt_log_flush().
+ *
+ * This can be called again to log to another file. Messages logged before
+ * are written to the previous file.
+ *
  * @param level The log level.
  * @param filename The name of the file to log messages to. For example: if you
  * want to log to stdout or stderr data streams, specify `stdout` or
@@ -102,6 +684,58 @@ typedef enum {
  */
 bool nrt_log_init(nrt_log_level_t level, const char* filename);
 
+/**
+ * @brief Initialize logging to a file that is rotated by size.
+ *
+ * This works like nrt_log_init(). Once the log file grows beyond `size_max`
+ * bytes, it is renamed to `filename.1`, an existing `filename.1` to
+ * `filename.2` and so on, and a new file is started. At most `files_max`
+ * rotated files are kept.
+ *
+ * @param level The log level.
+ * @param filename The name of the file to log messages to, or `stdout` or
+ * `stderr`, which are never rotated.
+ * @param size_max The size in bytes at which the file is rotated. Pass `0` to
+ * never rotate.
+ * @param files_max The number of rotated files to keep. Pass `0` to truncate
+ * the file instead of keeping rotated files.
+ *
+ * @return True if log was initialized.
+ */
+bool nrt_log_init_rotating(nrt_log_level_t level,
+                           const char* filename,
+                           uint64_t size_max,
+                           uint32_t files_max);
+
+/**
+ * @brief Change the log level.
+ *
+ * This takes effect right away on all threads, without initializing logging
+ * again.
+ *
+ * @param level The log level.
+ */
+void nrt_log_set_level(nrt_log_level_t level);
+
+/**
+ * @brief Write all queued log messages.
+ *
+ * Messages are written on the calling thread. Shutting down or destroying a
+ * client or recorder does this as well. Messages still queued when the
+ * process exits are lost, so call this before exiting if anything was logged
+ * since, for example by nrt_client_shutdown_timeout() leaving SDK clients to
+ * finish in the background.
+ */
+void nrt_log_flush(void);
+
+/**
+ * @brief Get the counters of the logger.
+ *
+ * @param stats Receives the counters.
+ * @return True if the counters could be retrieved.
+ */
+bool nrt_log_get_stats(nrt_log_stats_t* stats);
+
 /**
  * @brief Add an int attribute to an attribute collection.
  *
@@ -114,6 +748,47 @@ bool nrt_attributes_set_int(nrt_attributes_t* attributes,
                             const char* key,
                             int64_t value);
 
+/**
+ * @brief Add an int attribute to an attribute collection, with a
+ * length-delimited key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key.
+ * @param key_len The length of the attribute key in bytes.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_int_n(nrt_attributes_t* attributes,
+                              const char* key,
+                              size_t key_len,
+                              int64_t value);
+
+/**
+ * @brief Add an int attribute to an attribute collection, with an interned
+ * key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The interned attribute key.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_int_i(nrt_attributes_t* attributes,
+                              const nrt_interned_t* key,
+                              int64_t value);
+
+/**
+ * @brief Add an int attribute to an attribute collection, with a static key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key, which must remain valid and unchanged for the
+ * lifetime of the process.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_int_s(nrt_attributes_t* attributes,
+                              const char* key,
+                              int64_t value);
+
 /**
  * @brief Add an unsigned int attribute to an attribute collection.
  *
@@ -126,6 +801,48 @@ bool nrt_attributes_set_uint(nrt_attributes_t* attributes,
                              const char* key,
                              uint64_t value);
 
+/**
+ * @brief Add an unsigned int attribute to an attribute collection, with a
+ * length-delimited key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key.
+ * @param key_len The length of the attribute key in bytes.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_uint_n(nrt_attributes_t* attributes,
+                               const char* key,
+                               size_t key_len,
+                               uint64_t value);
+
+/**
+ * @brief Add an unsigned int attribute to an attribute collection, with an
+ * interned key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The interned attribute key.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_uint_i(nrt_attributes_t* attributes,
+                               const nrt_interned_t* key,
+                               uint64_t value);
+
+/**
+ * @brief Add an unsigned int attribute to an attribute collection, with a
+ * static key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key, which must remain valid and unchanged for the
+ * lifetime of the process.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_uint_s(nrt_attributes_t* attributes,
+                               const char* key,
+                               uint64_t value);
+
 /**
  * @brief Add a double attribute to an attribute collection.
  *
@@ -138,6 +855,47 @@ bool nrt_attributes_set_double(nrt_attributes_t* attributes,
                                const char* key,
                                double value);
 
+/**
+ * @brief Add a double attribute to an attribute collection, with a
+ * length-delimited key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key.
+ * @param key_len The length of the attribute key in bytes.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_double_n(nrt_attributes_t* attributes,
+                                 const char* key,
+                                 size_t key_len,
+                                 double value);
+
+/**
+ * @brief Add a double attribute to an attribute collection, with an interned
+ * key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The interned attribute key.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_double_i(nrt_attributes_t* attributes,
+                                 const nrt_interned_t* key,
+                                 double value);
+
+/**
+ * @brief Add a double attribute to an attribute collection, with a static key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key, which must remain valid and unchanged for the
+ * lifetime of the process.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_double_s(nrt_attributes_t* attributes,
+                                 const char* key,
+                                 double value);
+
 /**
  * @brief Add a string attribute to an attribute collection.
  *
@@ -150,6 +908,51 @@ bool nrt_attributes_set_string(nrt_attributes_t* attributes,
                                const char* key,
                                const char* value);
 
+/**
+ * @brief Add a string attribute to an attribute collection, with a
+ * length-delimited key and value.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key.
+ * @param key_len The length of the attribute key in bytes.
+ * @param value The attribute value.
+ * @param value_len The length of the attribute value in bytes.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_string_n(nrt_attributes_t* attributes,
+                                 const char* key,
+                                 size_t key_len,
+                                 const char* value,
+                                 size_t value_len);
+
+/**
+ * @brief Add a string attribute to an attribute collection, with an interned
+ * key and value.
+ *
+ * @param attributes An attribute collection.
+ * @param key The interned attribute key.
+ * @param value The interned attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_string_i(nrt_attributes_t* attributes,
+                                 const nrt_interned_t* key,
+                                 const nrt_interned_t* value);
+
+/**
+ * @brief Add a string attribute to an attribute collection, with a static key
+ * and value.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key, which must remain valid and unchanged for the
+ * lifetime of the process.
+ * @param value The attribute value, which must remain valid and unchanged for
+ * the lifetime of the process.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_string_s(nrt_attributes_t* attributes,
+                                 const char* key,
+                                 const char* value);
+
 /**
  * @brief Add a bool attribute to an attribute collection.
  *
@@ -162,6 +965,47 @@ bool nrt_attributes_set_bool(nrt_attributes_t* attributes,
                              const char* key,
                              bool value);
 
+/**
+ * @brief Add a bool attribute to an attribute collection, with a
+ * length-delimited key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key.
+ * @param key_len The length of the attribute key in bytes.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_bool_n(nrt_attributes_t* attributes,
+                               const char* key,
+                               size_t key_len,
+                               bool value);
+
+/**
+ * @brief Add a bool attribute to an attribute collection, with an interned
+ * key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The interned attribute key.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_bool_i(nrt_attributes_t* attributes,
+                               const nrt_interned_t* key,
+                               bool value);
+
+/**
+ * @brief Add a bool attribute to an attribute collection, with a static key.
+ *
+ * @param attributes An attribute collection.
+ * @param key The attribute key, which must remain valid and unchanged for the
+ * lifetime of the process.
+ * @param value The attribute value.
+ * @return True if the attribute was added.
+ */
+bool nrt_attributes_set_bool_s(nrt_attributes_t* attributes,
+                               const char* key,
+                               bool value);
+
 /**
  * @brief Destroy an attribute collection.
  *
@@ -172,6 +1016,28 @@ bool nrt_attributes_set_bool(nrt_attributes_t* attributes,
  */
 void nrt_attributes_destroy(nrt_attributes_t** attributes);
 
+/**
+ * @brief Generate a random span id.
+ *
+ * Ids are taken from a fast generator local to the calling thread, so this
+ * function is thread-safe and doesn't take locks. The generator is not
+ * cryptographically secure.
+ *
+ * @return A random, non-zero 64-bit span id.
+ */
+uint64_t nrt_generate_span_id(void);
+
+/**
+ * @brief Generate a random trace id.
+ *
+ * This uses the same generator as nrt_generate_span_id().
+ *
+ * @param high Receives the high 64 bits of the 128-bit trace id.
+ * @param low Receives the low 64 bits of the 128-bit trace id.
+ * @return True if the trace id could be generated.
+ */
+bool nrt_generate_trace_id(uint64_t* high, uint64_t* low);
+
 /**
  * @brief Create a new span.
  *
@@ -186,6 +1052,111 @@ nrt_span_t* nrt_span_new(const char* id,
                          const char* trace_id,
                          uint64_t timestamp);
 
+/**
+ * @brief Create a new span with length-delimited ids.
+ *
+ * @param id A span id.
+ * @param id_len The length of the span id in bytes.
+ * @param trace_id The trace id.
+ * @param trace_id_len The length of the trace id in bytes.
+ * @param timestamp The timestamp.
+ * @return A span.
+ */
+nrt_span_t* nrt_span_new_n(const char* id,
+                           size_t id_len,
+                           const char* trace_id,
+                           size_t trace_id_len,
+                           uint64_t timestamp);
+
+/**
+ * @brief Create a new span with binary ids.
+ *
+ * Binary ids are kept as integers and are only hex-encoded when the span is
+ * sent, as 16 and 32 lowercase hex digits.
+ *
+ * @param id A span id. Must not be zero.
+ * @param trace_id_high The high 64 bits of the 128-bit trace id.
+ * @param trace_id_low The low 64 bits of the 128-bit trace id.
+ * @param timestamp The timestamp.
+ * @return A span, or NULL if an id is zero.
+ */
+nrt_span_t* nrt_span_new_u64(uint64_t id,
+                             uint64_t trace_id_high,
+                             uint64_t trace_id_low,
+                             nrt_time_t timestamp);
+
+/**
+ * @brief Create a span template.
+ *
+ * Create a template once per call site, for example at startup, and create
+ * spans from it with nrt_span_from_template() or
+ * nrt_span_from_template_u64(). The template is immutable and can be used
+ * from any thread.
+ *
+ * The name and service name are interned, see nrt_interned_t. If the
+ * attributes are not NULL, the template takes ownership of the attribute
+ * collection, even if the template can't be created, and the passed pointer
+ * is set to NULL.
+ *
+ * When spans of the same template are sent together, the attributes of the
+ * template are sent once per payload, in its common block.
+ *
+ * @param name The name of the spans, or NULL.
+ * @param service_name The service name of the spans, or NULL.
+ * @param attributes An attribute collection, or NULL.
+ * @return A template, or NULL if a string is invalid.
+ */
+nrt_span_template_t* nrt_span_template_new(const char* name,
+                                           const char* service_name,
+                                           nrt_attributes_t** attributes);
+
+/**
+ * @brief Create a new span from a template.
+ *
+ * This works like nrt_span_new(), and sets the name and service name of the
+ * template. The span inherits the attributes of the template, which don't
+ * have to be copied. Attributes and names set on the span take precedence.
+ *
+ * @param tmpl A span template.
+ * @param id A span id.
+ * @param trace_id The trace id.
+ * @param timestamp The timestamp.
+ * @return A span, or NULL if the template is NULL.
+ */
+nrt_span_t* nrt_span_from_template(const nrt_span_template_t* tmpl,
+                                   const char* id,
+                                   const char* trace_id,
+                                   nrt_time_t timestamp);
+
+/**
+ * @brief Create a new span with binary ids from a template.
+ *
+ * This works like nrt_span_from_template(), with ids as in
+ * nrt_span_new_u64().
+ *
+ * @param tmpl A span template.
+ * @param id A span id. Must not be zero.
+ * @param trace_id_high The high 64 bits of the 128-bit trace id.
+ * @param trace_id_low The low 64 bits of the 128-bit trace id.
+ * @param timestamp The timestamp.
+ * @return A span, or NULL if the template is NULL or an id is zero.
+ */
+nrt_span_t* nrt_span_from_template_u64(const nrt_span_template_t* tmpl,
+                                       uint64_t id,
+                                       uint64_t trace_id_high,
+                                       uint64_t trace_id_low,
+                                       nrt_time_t timestamp);
+
+/**
+ * @brief Destroy a span template.
+ *
+ * Spans created from the template remain valid. The passed pointer will be
+ * set to NULL.
+ *
+ * @param tmpl A span template.
+ */
+void nrt_span_template_destroy(nrt_span_template_t** tmpl);
+
 /**
  * @brief Set the id of a span.
  *
@@ -195,6 +1166,25 @@ nrt_span_t* nrt_span_new(const char* id,
  */
 bool nrt_span_set_id(nrt_span_t* span, const char* id);
 
+/**
+ * @brief Set the id of a span from a length-delimited string.
+ *
+ * @param span A span.
+ * @param id The unique identifier for the span.
+ * @param len The length of the id in bytes.
+ * @return True if the id could be set.
+ */
+bool nrt_span_set_id_n(nrt_span_t* span, const char* id, size_t len);
+
+/**
+ * @brief Set a binary id for a span.
+ *
+ * @param span A span.
+ * @param id The unique identifier for the span. Must not be zero.
+ * @return True if the id could be set.
+ */
+bool nrt_span_set_id_u64(nrt_span_t* span, uint64_t id);
+
 /**
  * @brief Set the trace_id of a span.
  *
@@ -204,6 +1194,28 @@ bool nrt_span_set_id(nrt_span_t* span, const char* id);
  */
 bool nrt_span_set_trace_id(nrt_span_t* span, const char* trace_id);
 
+/**
+ * @brief Set the trace_id of a span from a length-delimited string.
+ *
+ * @param span A span.
+ * @param trace_id The trace_id for the span.
+ * @param len The length of the trace_id in bytes.
+ * @return True if the trace_id could be set.
+ */
+bool nrt_span_set_trace_id_n(nrt_span_t* span,
+                             const char* trace_id,
+                             size_t len);
+
+/**
+ * @brief Set a binary 128-bit trace_id for a span.
+ *
+ * @param span A span.
+ * @param high The high 64 bits of the trace_id.
+ * @param low The low 64 bits of the trace_id.
+ * @return True if the trace_id could be set. A trace_id of zero is rejected.
+ */
+bool nrt_span_set_trace_id_u128(nrt_span_t* span, uint64_t high, uint64_t low);
+
 /**
  * @brief Set the start timestamp for a span.
  *
@@ -222,6 +1234,35 @@ bool nrt_span_set_timestamp(nrt_span_t* span, nrt_time_t timestamp);
  */
 bool nrt_span_set_name(nrt_span_t* span, const char* name);
 
+/**
+ * @brief Set the name of a span from a length-delimited string.
+ *
+ * @param span A span.
+ * @param name The name for the span.
+ * @param len The length of the name in bytes.
+ * @return True if the name could be set.
+ */
+bool nrt_span_set_name_n(nrt_span_t* span, const char* name, size_t len);
+
+/**
+ * @brief Set the name of a span from an interned string.
+ *
+ * @param span A span.
+ * @param name The interned name for the span.
+ * @return True if the name could be set.
+ */
+bool nrt_span_set_name_i(nrt_span_t* span, const nrt_interned_t* name);
+
+/**
+ * @brief Set the name of a span from a static string.
+ *
+ * @param span A span.
+ * @param name The name for the span, which must remain valid and unchanged
+ * for the lifetime of the process.
+ * @return True if the name could be set.
+ */
+bool nrt_span_set_name_s(nrt_span_t* span, const char* name);
+
 /**
  * @brief Set the service name of a span.
  *
@@ -231,6 +1272,38 @@ bool nrt_span_set_name(nrt_span_t* span, const char* name);
  */
 bool nrt_span_set_service_name(nrt_span_t* span, const char* service_name);
 
+/**
+ * @brief Set the service name of a span from a length-delimited string.
+ *
+ * @param span A span.
+ * @param service_name The service name for the span.
+ * @param len The length of the service name in bytes.
+ * @return True if the service name could be set.
+ */
+bool nrt_span_set_service_name_n(nrt_span_t* span,
+                                 const char* service_name,
+                                 size_t len);
+
+/**
+ * @brief Set the service name of a span from an interned string.
+ *
+ * @param span A span.
+ * @param service_name The interned service name for the span.
+ * @return True if the service name could be set.
+ */
+bool nrt_span_set_service_name_i(nrt_span_t* span,
+                                 const nrt_interned_t* service_name);
+
+/**
+ * @brief Set the service name of a span from a static string.
+ *
+ * @param span A span.
+ * @param service_name The service name for the span, which must remain valid
+ * and unchanged for the lifetime of the process.
+ * @return True if the service name could be set.
+ */
+bool nrt_span_set_service_name_s(nrt_span_t* span, const char* service_name);
+
 /**
  * @brief Set the parent_id of a span.
  *
@@ -240,6 +1313,27 @@ bool nrt_span_set_service_name(nrt_span_t* span, const char* service_name);
  */
 bool nrt_span_set_parent_id(nrt_span_t* span, const char* parent_id);
 
+/**
+ * @brief Set the parent_id of a span from a length-delimited string.
+ *
+ * @param span A span.
+ * @param parent_id The parent_id for the span.
+ * @param len The length of the parent_id in bytes.
+ * @return True if the parent_id could be set.
+ */
+bool nrt_span_set_parent_id_n(nrt_span_t* span,
+                              const char* parent_id,
+                              size_t len);
+
+/**
+ * @brief Set a binary parent_id for a span.
+ *
+ * @param span A span.
+ * @param parent_id The parent_id for the span. Must not be zero.
+ * @return True if the parent_id could be set.
+ */
+bool nrt_span_set_parent_id_u64(nrt_span_t* span, uint64_t parent_id);
+
 /**
  * @brief Set the duration for a span.
  *
@@ -249,6 +1343,56 @@ bool nrt_span_set_parent_id(nrt_span_t* span, const char* parent_id);
  */
 bool nrt_span_set_duration(nrt_span_t* span, nrt_time_t duration);
 
+/**
+ * @brief Set the duration for a span in microseconds.
+ *
+ * Durations that aren't whole milliseconds are sent with their fractional
+ * part.
+ *
+ * @param span A span.
+ * @param duration The duration for the span in microseconds.
+ * @return True if the duration could be set.
+ */
+bool nrt_span_set_duration_us(nrt_span_t* span, uint64_t duration);
+
+/**
+ * @brief Set the duration for a span in nanoseconds.
+ *
+ * Durations that aren't whole milliseconds are sent with their fractional
+ * part.
+ *
+ * @param span A span.
+ * @param duration The duration for the span in nanoseconds.
+ * @return True if the duration could be set.
+ */
+bool nrt_span_set_duration_ns(nrt_span_t* span, uint64_t duration);
+
+/**
+ * @brief Start a span.
+ *
+ * Set the timestamp of the span to the current time and remember the start
+ * of the span on a monotonic clock, which is anchored to wall time once per
+ * process. Reading the clock doesn't require a system call on common
+ * platforms.
+ *
+ * @param span A span.
+ * @return True if the span could be started.
+ */
+bool nrt_span_start(nrt_span_t* span);
+
+/**
+ * @brief End a span.
+ *
+ * Set the duration of the span to the time elapsed since nrt_span_start()
+ * was called, with nanosecond precision. Durations shorter than a
+ * millisecond are sent with their fractional part.
+ *
+ * @param span A span.
+ * @return True if the duration could be set, false if the span wasn't
+ * started.
+ */
+bool nrt_span_end(nrt_span_t* span);
+
 /**
  * @brief Set attributes on a span.
  *
@@ -257,6 +1401,10 @@ bool nrt_span_set_duration(nrt_span_t* span, nrt_time_t duration);
  * will be destroyed. The passed pointer to the attribute collection will
  * always be set to NULL.
  *
+ * Attribute values are moved into the span without being copied. Attributes
+ * of the collection replace attributes with the same key already set on the
+ * span.
+ *
  * @param span A span.
  * @param attributes An attribute collection.
  * @return true if the attributes were added.
@@ -290,21 +1438,174 @@ nrt_span_batch_t* nrt_span_batch_new();
  * of the span. Otherwise the span will be destroyed. The passed pointer will
  * always be set to NULL.
  *
- * @param batch A span batch.
- * @param span A span.
- * @return True if the span was successfully added to the batch.
+ * @param batch A span batch.
+ * @param span A span.
+ * @return True if the span was successfully added to the batch.
+ */
+bool nrt_span_batch_record(nrt_span_batch_t* batch, nrt_span_t** span);
+
+/**
+ * @brief Set attributes shared by all spans of a span batch.
+ *
+ * Common attributes apply to the spans recorded into the batch before and
+ * after, and replace common attributes set earlier. They are stored once per
+ * batch and sent once per payload, in its common block, instead of with
+ * every span. Use them for values like the service name, host or deployment.
+ * Attributes set on a span take precedence.
+ *
+ * Independently of common attributes, string values that all spans of a
+ * payload send with the same key are sent once in the common block as well.
+ *
+ * If the attributes were successfully set, the batch takes ownership of the
+ * attribute collection. Otherwise the attribute collection will be
+ * destroyed. The passed pointer to the attribute collection will always be
+ * set to NULL.
+ *
+ * @param batch A span batch.
+ * @param attributes An attribute collection.
+ * @return True if the attributes were set.
+ */
+bool nrt_span_batch_set_common_attributes(nrt_span_batch_t* batch,
+                                          nrt_attributes_t** attributes);
+
+/**
+ * @brief Add many spans to a span batch in one call.
+ *
+ * Spans are built directly from the given descriptors and added to the batch,
+ * without creating intermediate nrt_span_t objects. The descriptors are copied
+ * and remain owned by the caller.
+ *
+ * Descriptors without a valid id or trace_id are skipped. Attributes with a
+ * missing key, an unknown type or an invalid string are skipped, but the span
+ * is still added.
+ *
+ * @param batch A span batch.
+ * @param spans An array of span descriptors.
+ * @param count The number of span descriptors in the array.
+ * @return The number of spans added to the batch.
+ */
+size_t nrt_span_batch_record_many(nrt_span_batch_t* batch,
+                                  const nrt_span_desc_t* spans,
+                                  size_t count);
+
+/**
+ * @brief Destroy a span batch.
+ *
+ * This destroys a span batch. Any spans previously added to the span batch will
+ * be lost. The passed pointer will be set to NULL.
+ *
+ * @param batch A span batch.
+ */
+void nrt_span_batch_destroy(nrt_span_batch_t** batch);
+
+/**
+ * @brief Create a new pool.
+ *
+ * The maximum values limit how many idle objects of each kind the pool
+ * holds. Objects returned to a full pool are freed.
+ *
+ * @param spans_max The maximum number of idle spans.
+ * @param attributes_max The maximum number of idle attribute collections.
+ * @param batches_max The maximum number of idle span batches.
+ * @return A pool.
+ */
+nrt_span_pool_t* nrt_span_pool_new(size_t spans_max,
+                                   size_t attributes_max,
+                                   size_t batches_max);
+
+/**
+ * @brief Create a new span from a pool.
+ *
+ * This works like nrt_span_new(), but takes the span from the pool.
+ *
+ * @param pool A pool.
+ * @param id A span id.
+ * @param trace_id The trace id.
+ * @param timestamp The timestamp.
+ * @return A span.
+ */
+nrt_span_t* nrt_span_pool_span_new(nrt_span_pool_t* pool,
+                                   const char* id,
+                                   const char* trace_id,
+                                   nrt_time_t timestamp);
+
+/**
+ * @brief Create a new span with length-delimited ids from a pool.
+ *
+ * This works like nrt_span_new_n(), but takes the span from the pool.
+ *
+ * @param pool A pool.
+ * @param id A span id.
+ * @param id_len The length of the span id in bytes.
+ * @param trace_id The trace id.
+ * @param trace_id_len The length of the trace id in bytes.
+ * @param timestamp The timestamp.
+ * @return A span.
+ */
+nrt_span_t* nrt_span_pool_span_new_n(nrt_span_pool_t* pool,
+                                     const char* id,
+                                     size_t id_len,
+                                     const char* trace_id,
+                                     size_t trace_id_len,
+                                     nrt_time_t timestamp);
+
+/**
+ * @brief Create a new span with binary ids from a pool.
+ *
+ * This works like nrt_span_new_u64(), but takes the span from the pool.
+ *
+ * @param pool A pool.
+ * @param id A span id. Must not be zero.
+ * @param trace_id_high The high 64 bits of the 128-bit trace id.
+ * @param trace_id_low The low 64 bits of the 128-bit trace id.
+ * @param timestamp The timestamp.
+ * @return A span, or NULL if an id is zero.
+ */
+nrt_span_t* nrt_span_pool_span_new_u64(nrt_span_pool_t* pool,
+                                       uint64_t id,
+                                       uint64_t trace_id_high,
+                                       uint64_t trace_id_low,
+                                       nrt_time_t timestamp);
+
+/**
+ * @brief Create a new attribute collection from a pool.
+ *
+ * @param pool A pool.
+ * @return An empty attribute collection.
+ */
+nrt_attributes_t* nrt_span_pool_attributes_new(nrt_span_pool_t* pool);
+
+/**
+ * @brief Create a new span batch from a pool.
+ *
+ * Spans recorded via nrt_span_batch_record_many() are taken from the same
+ * pool.
+ *
+ * @param pool A pool.
+ * @return An empty span batch.
+ */
+nrt_span_batch_t* nrt_span_pool_batch_new(nrt_span_pool_t* pool);
+
+/**
+ * @brief Get statistics about a pool.
+ *
+ * @param pool A pool.
+ * @param stats The statistics are written here.
+ * @return True if the statistics were written.
  */
-bool nrt_span_batch_record(nrt_span_batch_t* batch, nrt_span_t** span);
+bool nrt_span_pool_get_stats(nrt_span_pool_t* pool,
+                             nrt_span_pool_stats_t* stats);
 
 /**
- * @brief Destroy a span batch.
+ * @brief Destroy a pool.
  *
- * This destroys a span batch. Any spans previously added to the span batch will
- * be lost. The passed pointer will be set to NULL.
+ * Objects taken from the pool remain valid. The memory of the pool is freed
+ * once all of them have been destroyed or sent. The passed pointer will be
+ * set to NULL.
  *
- * @param batch A span batch.
+ * @param pool A pool.
  */
-void nrt_span_batch_destroy(nrt_span_batch_t** batch);
+void nrt_span_pool_destroy(nrt_span_pool_t** pool);
 
 /**
  * @brief Create a new client configuration with an Insights API key.
@@ -405,8 +1706,10 @@ void nrt_client_config_set_product_info(nrt_client_config_t* config,
  * @brief Configure the maximum of batches sent in one go.
  *
  * If the number of batches queued exceeds the maximum given here, the
- * additional batches will be dropped. This mechanism avoids accumulating
- * back pressure.
+ * additional batches will be dropped, or handled as configured with
+ * nrt_client_config_set_backpressure(). This mechanism avoids accumulating
+ * back pressure. The maximum is rounded up to a power of two and defaults to
+ * 100.
  *
  * @param config A client configuration.
  * @param queue_max The maximum queue size.
@@ -414,6 +1717,249 @@ void nrt_client_config_set_product_info(nrt_client_config_t* config,
 void nrt_client_config_set_queue_max(nrt_client_config_t* config,
                                      size_t queue_max);
 
+/**
+ * @brief Configure the number of sender threads.
+ *
+ * Sender threads take batches from the queue, convert them and pass them on
+ * for sending. Each sender thread has a client of the Rust SDK of its own,
+ * with its own HTTP worker, keep-alive connections, and retry and backoff
+ * state, so payloads of different senders are compressed and sent in
+ * parallel. Use more than one sender when a single connection can't keep up
+ * with the spans produced, for example because of high round-trip latency.
+ * Batches may be sent in a different order than they were queued.
+ *
+ * A recorder created from the client uses a single sender.
+ *
+ * @param config A client configuration.
+ * @param threads The number of sender threads, at most 64. If zero, the
+ * default of one thread is used.
+ */
+void nrt_client_config_set_sender_threads(nrt_client_config_t* config,
+                                          size_t threads);
+
+/**
+ * @brief Configure the maximum payload of a request.
+ *
+ * The trace API rejects payloads that exceed its size limit as a whole. To
+ * stay within it, the client estimates the size of each span as JSON and
+ * splits larger batches into several requests, which also bounds the memory
+ * needed to serialize a request. The estimate is taken before compression,
+ * so with the default of 1,000,000 bytes, the limit of the trace API for
+ * compressed payloads, requests are accepted however well they compress.
+ * Since span payloads typically compress several times over, larger values
+ * mean fewer requests at the risk of rejected payloads.
+ *
+ * This also applies to batches sent by a recorder.
+ *
+ * @param config A client configuration.
+ * @param payload_max The maximum estimated payload in bytes. If zero, the
+ * default is used.
+ */
+void nrt_client_config_set_payload_max(nrt_client_config_t* config,
+                                       size_t payload_max);
+
+/**
+ * @brief Configure the compression level of spooled and exported batches.
+ *
+ * Batches written to the spool configured with nrt_client_config_set_spool(),
+ * and to compressed export files configured with
+ * nrt_client_config_set_export(), are compressed with deflate at this level,
+ * from 0 for no compression to 9 for the best compression. The default is 1,
+ * which is fastest. Payloads sent to the trace API are compressed by the Rust
+ * SDK, which doesn't offer a choice of level.
+ *
+ * @param config A client configuration.
+ * @param level The compression level.
+ * @return True if the level is valid.
+ */
+bool nrt_client_config_set_compression_level(nrt_client_config_t* config,
+                                             uint32_t level);
+
+/**
+ * @brief Configure probabilistic head sampling.
+ *
+ * Only the given ratio of traces is sent. The decision is deterministic and
+ * based on the low 64 bits of the trace id, so all spans of a trace get the
+ * same decision, in any process using the same ratio. For string trace ids,
+ * the last 16 hex digits are used.
+ *
+ * @param config A client configuration.
+ * @param ratio The ratio of traces to keep, between 0.0 and 1.0.
+ */
+void nrt_client_config_set_sampling_ratio(nrt_client_config_t* config,
+                                          double ratio);
+
+/**
+ * @brief Configure a limit on the number of traces sent per second.
+ *
+ * Traces beyond the limit are dropped. Decisions are remembered for at least
+ * a second, so spans of the same trace arriving within that time get the same
+ * decision. This is applied after probabilistic head sampling.
+ *
+ * @param config A client configuration.
+ * @param traces_per_second The maximum number of traces per second.
+ */
+void nrt_client_config_set_sampling_rate_limit(nrt_client_config_t* config,
+                                               uint32_t traces_per_second);
+
+/**
+ * @brief Configure tail sampling.
+ *
+ * Spans that pass head sampling are held back for the given time after the
+ * first span of their trace arrives. Then the trace is kept only if one of
+ * its spans has an `error` attribute that isn't false, or lasted at least the
+ * given duration. Spans of a trace arriving after it was decided are kept or
+ * dropped right away.
+ *
+ * Decided traces are queued with the next call to nrt_client_send(), by the
+ * background thread of a recorder, or when the client is shut down. If more
+ * than 100000 spans are held back, further spans are kept without waiting.
+ *
+ * @param config A client configuration.
+ * @param duration_threshold_us Traces with a span lasting at least this many
+ * microseconds are kept. If zero, only traces with errors are kept.
+ * @param decision_wait_ms The time in milliseconds spans are held back.
+ */
+void nrt_client_config_set_tail_sampling(nrt_client_config_t* config,
+                                         uint64_t duration_threshold_us,
+                                         nrt_time_t decision_wait_ms);
+
+/**
+ * @brief Configure aggregation of spans.
+ *
+ * Count spans, errors and latencies per span name and service name, and pass
+ * the aggregates to the given callback once per interval. The callback is
+ * called from a background thread, and one last time when the client is shut
+ * down.
+ *
+ * All spans passed to the client are aggregated before they are sampled, so
+ * in combination with sampling only a subset of spans is sent while the
+ * aggregates cover all spans. At most 10000 distinct pairs of names are
+ * aggregated, further spans are aggregated under the name "other".
+ *
+ * @param config A client configuration.
+ * @param interval_ms The aggregation interval in milliseconds. If zero,
+ * aggregation is disabled.
+ * @param callback The callback receiving the aggregates. If NULL, aggregation
+ * is disabled.
+ * @param user_data Passed to the callback.
+ */
+void nrt_client_config_set_aggregation(nrt_client_config_t* config,
+                                       nrt_time_t interval_ms,
+                                       nrt_span_aggregate_fn callback,
+                                       void* user_data);
+
+/**
+ * @brief Configure metrics.
+ *
+ * Enable counters, gauges and summaries created via nrt_counter_new(),
+ * nrt_gauge_new() and nrt_summary_new(), and pass their values to the given
+ * callback once per interval. The callback is called from a background
+ * thread, and one last time when the client is shut down.
+ *
+ * The SDK only sends spans, so metrics are handed to the callback instead of
+ * being sent.
+ *
+ * @param config A client configuration.
+ * @param interval_ms The harvest interval in milliseconds. If zero, metrics
+ * are disabled.
+ * @param callback The callback receiving the metrics. If NULL, metrics are
+ * disabled.
+ * @param user_data Passed to the callback.
+ */
+void nrt_client_config_set_metrics(nrt_client_config_t* config,
+                                   nrt_time_t interval_ms,
+                                   nrt_metric_fn callback,
+                                   void* user_data);
+
+/**
+ * @brief Configure what happens to batches when the queue is full.
+ *
+ * nrt_client_enqueue() reports what happened to each batch.
+ *
+ * @param config A client configuration.
+ * @param policy The backpressure policy.
+ * @param timeout_ms How long nrt_client_enqueue() waits for room in the queue
+ * with NRT_BACKPRESSURE_BLOCK. Ignored by other policies.
+ * @return False if the configuration is NULL or the policy is unknown.
+ */
+bool nrt_client_config_set_backpressure(nrt_client_config_t* config,
+                                        nrt_backpressure_t policy,
+                                        nrt_time_t timeout_ms);
+
+/**
+ * @brief Configure a disk spool for batches that can't be sent.
+ *
+ * The client probes the trace endpoint once when it is created and then once
+ * per second. While the endpoint doesn't accept connections, span batches are
+ * compressed and appended to segment files in the given directory instead of
+ * being queued, where they would be dropped once the queue is full. When the
+ * endpoint is reachable again, spooled batches are sent along with new
+ * batches, a few at a time.
+ *
+ * Batches that the queue has no room for are written to the spool as well,
+ * whatever the endpoint's state: instead of being dropped with
+ * NRT_BACKPRESSURE_DROP_NEWEST or NRT_BACKPRESSURE_SAMPLE, or after the
+ * timeout with NRT_BACKPRESSURE_BLOCK. They are sent once the queue has room
+ * again.
+ *
+ * The spool is bounded by a byte budget. When it is exhausted, the oldest
+ * segment file is deleted. Spooled batches survive a crash or restart of the
+ * process and are replayed by the next client using the same directory. Since
+ * segment files are only deleted once all their batches were handed to the
+ * SDK, a batch may be sent twice after a crash. A directory must not be used by more
+ * than one client at a time.
+ *
+ * @param config A client configuration.
+ * @param dir The spool directory. It is created if it doesn't exist. If NULL,
+ * spooling is disabled.
+ * @param bytes_max The byte budget of the spool. If zero, spooling is
+ * disabled.
+ */
+void nrt_client_config_set_spool(nrt_client_config_t* config,
+                                 const char* dir,
+                                 uint64_t bytes_max);
+
+/**
+ * @brief Configure the client to write span batches to local files.
+ *
+ * Instead of sending span batches to the trace API, the sender threads write
+ * them to files in the given directory, without setting up HTTP clients. This
+ * suits hosts that forward telemetry through a sidecar, and capturing traffic
+ * to replay it later with nrt_replay_open().
+ *
+ * Each payload the client would send is written as one line of JSON in the
+ * format of the trace API, so the files are newline-delimited JSON. With
+ * compression, the lines of each batch are written as a gzip member of their
+ * own and a file decompresses to the same lines with any gzip reader.
+ *
+ * Batches are encoded and compressed by the sender threads in parallel, and
+ * collected in memory until there are 256 kB of them or no batches are left
+ * to send. They are then appended to the current file with a single writev().
+ * Files are named after a hexadecimal sequence number and rotated when the
+ * next write would make them larger than `file_bytes_max`. New files are
+ * numbered after those left in the directory by a previous client, and the
+ * oldest files are deleted when there are more than `files_max`.
+ *
+ * A spool configured with nrt_client_config_set_spool() is ignored, and the
+ * client can't be passed to nrt_recorder_new(). A directory must not be used
+ * by more than one client at a time.
+ *
+ * @param config A client configuration.
+ * @param dir The export directory. It is created if it doesn't exist. If
+ * NULL, batches are sent to the trace API.
+ * @param file_bytes_max The size at which files are rotated. If zero, files
+ * are rotated at 16 MB.
+ * @param files_max The maximum number of files in the directory. If zero,
+ * files are never deleted.
+ * @param compress Whether to compress files with gzip.
+ */
+void nrt_client_config_set_export(nrt_client_config_t* config,
+                                  const char* dir,
+                                  uint64_t file_bytes_max,
+                                  uint32_t files_max,
+                                  bool compress);
+
 /**
  * @brief Destroy a client configuration.
  *
@@ -430,8 +1976,14 @@ void nrt_client_config_destroy(nrt_client_config_t** config);
  * The passed configuration will be destroyed and the passed pointer will
  * always be set to NULL.
  *
+ * If a spool is configured, this opens the spool directory, probes the trace
+ * endpoint, and sends the first batches spooled by a previous client if the
+ * endpoint is reachable. Probing takes up to half a second if the endpoint
+ * doesn't respond.
+ *
  * @param config A client configuration.
- * @return A client.
+ * @return A client, or NULL if the client, its spool or its export directory
+ * couldn't be created.
  */
 nrt_client_t* nrt_client_new(nrt_client_config_t** config);
 
@@ -452,6 +2004,272 @@ nrt_client_t* nrt_client_new(nrt_client_config_t** config);
  */
 bool nrt_client_send(nrt_client_t* client, nrt_span_batch_t** batch);
 
+/**
+ * @brief Send a span batch and report what happened to it.
+ *
+ * This works like nrt_client_send(), but returns the outcome according to
+ * the backpressure policy of the client. nrt_client_send() returns true for
+ * all outcomes where spans of the batch are kept.
+ *
+ * Batches are run through aggregation and sampling on the calling thread and
+ * then queued. Sender threads convert queued batches and hand them to the SDK
+ * for sending.
+ *
+ * @param client A client.
+ * @param batch The span batch to be sent.
+ * @return The outcome.
+ */
+nrt_send_result_t nrt_client_enqueue(nrt_client_t* client,
+                                     nrt_span_batch_t** batch);
+
+/**
+ * @brief Submit a span batch without blocking, for use from event loops.
+ *
+ * This works like nrt_client_enqueue(), but never waits for room in the
+ * queue: with NRT_BACKPRESSURE_BLOCK, a batch that doesn't fit is dropped
+ * right away and NRT_SEND_TIMEOUT is returned.
+ *
+ * Batches that go to the spool aren't written on the calling thread either.
+ * They are handed to a sender thread, which writes them, and
+ * NRT_SEND_SPOOLED is returned. If as many batches as fit into the queue are
+ * already waiting to be written, the batch is dropped and NRT_SEND_DROPPED is
+ * returned.
+ *
+ * If one of the NRT_SEND_QUEUED results is returned, the callback is called
+ * exactly once when the batch left the queue. For all other results, the
+ * result is final and the callback isn't called. Callbacks are only ever
+ * called from nrt_client_process_completions(), nrt_client_shutdown() and
+ * nrt_client_destroy(), on the calling thread.
+ *
+ * @param client A client.
+ * @param batch The span batch to be sent.
+ * @param callback Called with the delivery of the batch. May be NULL.
+ * @param user_data Passed to the callback.
+ * @return The outcome.
+ */
+nrt_send_result_t nrt_client_submit(nrt_client_t* client,
+                                    nrt_span_batch_t** batch,
+                                    nrt_completion_fn callback,
+                                    void* user_data);
+
+/**
+ * @brief Get a file descriptor signalling completions.
+ *
+ * The descriptor becomes readable when completions of submitted batches are
+ * pending, and can be added to poll, epoll, io_uring or any other event loop.
+ * When it is readable, call nrt_client_process_completions(). The descriptor
+ * is an eventfd on Linux and the read end of a pipe on other Unix systems. It
+ * is created on the first call and owned by the client, don't read from it or
+ * close it.
+ *
+ * @param client A client.
+ * @return The file descriptor, or -1 if the client is NULL or the platform
+ * has no descriptor to offer. Process completions periodically then.
+ */
+int nrt_client_completion_fd(nrt_client_t* client);
+
+/**
+ * @brief Call the callbacks of pending completions.
+ *
+ * Callbacks are called on the calling thread. This never blocks.
+ *
+ * @param client A client.
+ * @return The number of callbacks called.
+ */
+size_t nrt_client_process_completions(nrt_client_t* client);
+
+/**
+ * @brief Make the head sampling decision for a trace.
+ *
+ * Returns whether spans of the given trace pass head sampling and the rate
+ * limit of the client. Call this before building spans, to avoid creating
+ * spans and attributes that would be dropped anyway. Spans of kept traces can
+ * still be dropped by tail sampling.
+ *
+ * @param client A client.
+ * @param trace_id A trace id.
+ * @return True if the trace is sampled. Always true if the client samples
+ * nothing.
+ */
+bool nrt_client_sample_trace(nrt_client_t* client, const char* trace_id);
+
+/**
+ * @brief Make the head sampling decision for a binary trace id.
+ *
+ * This works like nrt_client_sample_trace().
+ *
+ * @param client A client.
+ * @param high The high 64 bits of the 128-bit trace id.
+ * @param low The low 64 bits of the 128-bit trace id.
+ * @return True if the trace is sampled.
+ */
+bool nrt_client_sample_trace_u128(nrt_client_t* client,
+                                  uint64_t high,
+                                  uint64_t low);
+
+/**
+ * @brief Get sampling statistics of a client.
+ *
+ * @param client A client.
+ * @param stats Receives the statistics.
+ * @return True if statistics could be retrieved.
+ */
+bool nrt_client_get_sampling_stats(nrt_client_t* client,
+                                   nrt_sampling_stats_t* stats);
+
+/**
+ * @brief Get spool statistics of a client.
+ *
+ * @param client A client.
+ * @param stats Receives the statistics. All zero if the client has no spool.
+ * @return True if statistics could be retrieved.
+ */
+bool nrt_client_get_spool_stats(nrt_client_t* client, nrt_spool_stats_t* stats);
+
+/**
+ * @brief Get statistics of a client.
+ *
+ * Counters are kept per thread group on separate cache lines and are read
+ * without taking locks, so this can be called at any rate without slowing
+ * down threads sending batches.
+ *
+ * @param client A client.
+ * @param stats Receives the statistics.
+ * @return True if statistics could be retrieved.
+ */
+bool nrt_client_get_stats(nrt_client_t* client, nrt_client_stats_t* stats);
+
+/**
+ * @brief Pass span aggregates to the callback right away.
+ *
+ * This ends the current aggregation interval early. The callback is called on
+ * the calling thread, unless no spans were aggregated.
+ *
+ * @param client A client.
+ * @return True if the client aggregates spans.
+ */
+bool nrt_client_harvest_aggregates(nrt_client_t* client);
+
+/**
+ * @brief Estimate a latency quantile of a span aggregate.
+ *
+ * The estimate is the midpoint of the bucket containing the quantile, which
+ * is within about 3% of the exact value.
+ *
+ * @param aggregate A span aggregate.
+ * @param q The quantile, between 0.0 and 1.0.
+ * @return The estimated latency in milliseconds.
+ */
+double nrt_span_aggregate_quantile(const nrt_span_aggregate_t* aggregate,
+                                   double q);
+
+/**
+ * @brief Pass metrics to the callback right away.
+ *
+ * This ends the current metrics interval early. The callback is called on the
+ * calling thread, unless no instrument has a value.
+ *
+ * @param client A client.
+ * @return True if the client has metrics enabled.
+ */
+bool nrt_client_harvest_metrics(nrt_client_t* client);
+
+/*
+ * Instruments
+ *
+ * Instruments are created once, for example at startup, and then updated
+ * from any number of threads. Updates don't take locks or allocate memory:
+ * each thread updates its own of 64 cache lines of the instrument, which are
+ * only added up when metrics are harvested.
+ *
+ * Creating an instrument with the name of an existing one returns another
+ * handle to it. Each handle has to be destroyed. Instruments stay valid after
+ * their client was shut down, but their values are no longer reported.
+ */
+
+/**
+ * @brief Create a counter.
+ *
+ * @param client A client with metrics enabled.
+ * @param name The name of the counter.
+ * @return A counter, or NULL if metrics aren't enabled, the name is NULL or
+ * used by a gauge or summary, or 10000 instruments exist.
+ */
+nrt_counter_t* nrt_counter_new(nrt_client_t* client, const char* name);
+
+/**
+ * @brief Add to a counter.
+ *
+ * @param counter A counter.
+ * @param value The value to add.
+ */
+void nrt_counter_add(nrt_counter_t* counter, uint64_t value);
+
+/**
+ * @brief Destroy a counter.
+ *
+ * Values added since the last harvest are still reported. The passed pointer
+ * will be set to NULL.
+ *
+ * @param counter A counter.
+ */
+void nrt_counter_destroy(nrt_counter_t** counter);
+
+/**
+ * @brief Create a gauge.
+ *
+ * @param client A client with metrics enabled.
+ * @param name The name of the gauge.
+ * @return A gauge, or NULL if metrics aren't enabled, the name is NULL or
+ * used by a counter or summary, or 10000 instruments exist.
+ */
+nrt_gauge_t* nrt_gauge_new(nrt_client_t* client, const char* name);
+
+/**
+ * @brief Set the value of a gauge.
+ *
+ * @param gauge A gauge.
+ * @param value The new value.
+ */
+void nrt_gauge_set(nrt_gauge_t* gauge, double value);
+
+/**
+ * @brief Destroy a gauge.
+ *
+ * The passed pointer will be set to NULL.
+ *
+ * @param gauge A gauge.
+ */
+void nrt_gauge_destroy(nrt_gauge_t** gauge);
+
+/**
+ * @brief Create a summary.
+ *
+ * @param client A client with metrics enabled.
+ * @param name The name of the summary.
+ * @return A summary, or NULL if metrics aren't enabled, the name is NULL or
+ * used by a counter or gauge, or 10000 instruments exist.
+ */
+nrt_summary_t* nrt_summary_new(nrt_client_t* client, const char* name);
+
+/**
+ * @brief Record a value to a summary.
+ *
+ * @param summary A summary.
+ * @param value The value.
+ */
+void nrt_summary_record(nrt_summary_t* summary, double value);
+
+/**
+ * @brief Destroy a summary.
+ *
+ * Values recorded since the last harvest are still reported. The passed
+ * pointer will be set to NULL.
+ *
+ * @param summary A summary.
+ */
+void nrt_summary_destroy(nrt_summary_t** summary);
+
 /**
  * @brief Shutdown a client.
  *
@@ -462,6 +2280,49 @@ bool nrt_client_send(nrt_client_t* client, nrt_span_batch_t** batch);
  */
 void nrt_client_shutdown(nrt_client_t** client);
 
+/**
+ * @brief Wait until queued span batches are handed to the SDK.
+ *
+ * Wakes all sender threads and waits for the queue to drain, at most for the
+ * given time. If the timeout passes, batches still queued are written to the
+ * spool if the client has one, and stay queued otherwise.
+ *
+ * The SDK sends the batches it was handed in the background, retrying with
+ * backoff on failure. Only nrt_client_shutdown() and
+ * nrt_client_shutdown_timeout() wait for that.
+ *
+ * @param client A client.
+ * @param timeout_ms The time to wait at most, in milliseconds.
+ * @param result Receives what was left undelivered. May be NULL.
+ * @return True if all queued batches were handed to the SDK in time.
+ */
+bool nrt_client_flush(nrt_client_t* client,
+                      uint64_t timeout_ms,
+                      nrt_flush_result_t* result);
+
+/**
+ * @brief Shutdown a client, giving up on pending data after a timeout.
+ *
+ * This works like nrt_client_shutdown(), but returns once the timeout passed,
+ * even if the SDK is still retrying or backing off. Sender threads stop
+ * taking batches from the queue at the timeout, and batches still queued are
+ * written to the spool if the client has one, or dropped. SDK clients are
+ * shut down in parallel, and those that didn't finish in time are left to
+ * finish in the background.
+ *
+ * The client object is freed in any case and the passed pointer will be set
+ * to NULL.
+ *
+ * @param client A client.
+ * @param timeout_ms The time to wait at most, in milliseconds.
+ * @param result Receives what was left undelivered. May be NULL.
+ * @return True if all pending data was handed over and the SDK finished
+ * sending in time.
+ */
+bool nrt_client_shutdown_timeout(nrt_client_t** client,
+                                 uint64_t timeout_ms,
+                                 nrt_flush_result_t* result);
+
 /**
  * @brief Destroy a client.
  *
@@ -472,16 +2333,145 @@ void nrt_client_shutdown(nrt_client_t** client);
  */
 void nrt_client_destroy(nrt_client_t** client);
 
+/**
+ * @brief Create a new span recorder.
+ *
+ * The recorder takes ownership of the passed client, which is shut down
+ * together with the recorder. The passed pointer will be set to NULL if the
+ * recorder was created.
+ *
+ * Each recording thread gets a buffer for up to twice `batch_max` spans,
+ * rounded up to a power of two. A thread whose buffer fills up wakes the
+ * background thread, which sends batches of at most `batch_max` spans.
+ *
+ * @param client A client. It must not be configured with
+ * nrt_client_config_set_export().
+ * @param batch_max The maximum number of spans in a batch. Must be greater
+ * than zero.
+ * @param flush_interval_ms The time in milliseconds after which a partially
+ * filled batch is sent. If zero, batches are only sent when they are full and
+ * when the recorder is shut down.
+ * @return A span recorder, or NULL if an argument is invalid.
+ */
+nrt_recorder_t* nrt_recorder_new(nrt_client_t** client,
+                                 size_t batch_max,
+                                 nrt_time_t flush_interval_ms);
+
+/**
+ * @brief Record a finished span.
+ *
+ * Append a span to the buffer of the calling thread. This never blocks. If the
+ * buffer is full because the background thread can't keep up, the span is
+ * dropped.
+ *
+ * The background thread passes buffered spans through the sampler of the
+ * client and stages them in its spool while the endpoint is unreachable, so
+ * neither takes locks or writes to disk on the recording thread. Spans of
+ * traces that aren't sampled still take room in the buffer until then.
+ *
+ * The recorder takes ownership of the span and the passed pointer will always
+ * be set to NULL.
+ *
+ * @param recorder A span recorder.
+ * @param span The span to be recorded.
+ * @return False if the span was dropped because the buffer is full, true
+ * otherwise.
+ */
+bool nrt_recorder_record(nrt_recorder_t* recorder, nrt_span_t** span);
+
+/**
+ * @brief Shutdown a span recorder.
+ *
+ * Sends all recorded spans, shuts down the client and frees the recorder. The
+ * passed pointer will be set to NULL.
+ *
+ * No thread may record spans to the recorder while or after it is shut down.
+ *
+ * @param recorder A span recorder.
+ */
+void nrt_recorder_shutdown(nrt_recorder_t** recorder);
+
+/**
+ * @brief Destroy a span recorder.
+ *
+ * Destroys the recorder and its client without sending buffered spans. The
+ * passed pointer will be set to NULL.
+ *
+ * @param recorder A span recorder.
+ */
+void nrt_recorder_destroy(nrt_recorder_t** recorder);
+
+/**
+ * @brief Open exported span batches for replay.
+ *
+ * Opens a file written by a client configured with
+ * nrt_client_config_set_export(), or all such files in a directory in the
+ * order they were written. Files are read one at a time when
+ * nrt_replay_next() reaches them. Uncompressed files are mapped into memory
+ * and parsed in place, compressed files are decompressed into memory first.
+ *
+ * Spans keep their ids, timestamps and attributes, so sending the batches
+ * reproduces the exported traffic. Common attributes of a payload are set on
+ * each of its spans.
+ *
+ * @param path An export file or directory.
+ * @return A replay, or NULL if the path can't be read.
+ */
+nrt_replay_t* nrt_replay_open(const char* path);
+
+/**
+ * @brief Read the next span batch of a replay.
+ *
+ * Each line of a file becomes a span batch, which the caller owns and sends
+ * or destroys. Lines that aren't valid span batches are skipped and counted
+ * in nrt_replay_stats_t, as are files that can't be read.
+ *
+ * @param replay A replay.
+ * @return A span batch, or NULL once all files were read.
+ */
+nrt_span_batch_t* nrt_replay_next(nrt_replay_t* replay);
+
+/**
+ * @brief Get statistics of a replay.
+ *
+ * @param replay A replay.
+ * @param stats Receives the statistics.
+ * @return True if statistics could be retrieved.
+ */
+bool nrt_replay_get_stats(nrt_replay_t* replay, nrt_replay_stats_t* stats);
+
+/**
+ * @brief Destroy a replay.
+ *
+ * Closes the file being read. The passed pointer will be set to NULL.
+ *
+ * @param replay A replay.
+ */
+void nrt_replay_destroy(nrt_replay_t** replay);
+
 /**
  * A list of examples for Doxygen to cross-reference. If a function in
  * newrelic-telemetry-sdk.h appears in one of these examples, the example source
  * file appears under the "Examples" header.
  *
+ * \example aggregation.c
+ * \example async.c
  * \example attributes.c
+ * \example backpressure.c
  * \example configuration.c
+ * \example export.c
+ * \example flush.c
  * \example log.c
+ * \example metrics.c
+ * \example recorder.c
+ * \example sampling.c
  * \example simple.c
  * \example span.c
+ * \example span_batch.c
+ * \example span_pool.c
+ * \example span_template.c
+ * \example spool.c
+ * \example stats.c
  * \example trace_api.c
  */
 
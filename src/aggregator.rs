@@ -0,0 +1,310 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::harvester::{Harvest, HarvestConfig, Harvester};
+use crate::histogram::{self, bucket, store_max, store_min, BUCKETS};
+use crate::pool::{thread_shard, SHARDS};
+use crate::span::Span;
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::ffi::c_void;
+use std::hash::{Hash, Hasher};
+use std::os::raw::c_char;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, PoisonError, RwLock};
+use std::time::Duration;
+
+/// Distinct name and service name pairs that are aggregated at most. Spans of
+/// further pairs are aggregated under `OVERFLOW_NAME`.
+const KEYS_MAX: usize = 10_000;
+const OVERFLOW_NAME: &str = "other";
+
+/// Counters updated by the threads of one shard, on their own cache line.
+#[repr(align(64))]
+struct Stripe {
+    count: AtomicU64,
+    errors: AtomicU64,
+    duration_sum: AtomicU64,
+    duration_min: AtomicU64,
+    duration_max: AtomicU64,
+}
+
+impl Default for Stripe {
+    fn default() -> Self {
+        Stripe {
+            count: AtomicU64::new(0),
+            errors: AtomicU64::new(0),
+            duration_sum: AtomicU64::new(0),
+            duration_min: AtomicU64::new(u64::MAX),
+            duration_max: AtomicU64::new(0),
+        }
+    }
+}
+
+/// Rate, errors and a latency histogram of all spans with the same name and
+/// service name.
+struct Aggregate {
+    name: String,
+    service_name: String,
+    stripes: Vec<Stripe>,
+    buckets: Vec<AtomicU64>,
+}
+
+impl Aggregate {
+    fn new(name: &str, service_name: &str) -> Self {
+        let mut stripes = Vec::with_capacity(SHARDS);
+        stripes.resize_with(SHARDS, Stripe::default);
+        let mut buckets = Vec::with_capacity(BUCKETS);
+        buckets.resize_with(BUCKETS, || AtomicU64::new(0));
+        Aggregate {
+            name: name.to_string(),
+            service_name: service_name.to_string(),
+            stripes,
+            buckets,
+        }
+    }
+
+    fn record(&self, error: bool, duration: Option<Duration>) {
+        let stripe = &self.stripes[thread_shard()];
+        stripe.count.fetch_add(1, Ordering::Relaxed);
+        if error {
+            stripe.errors.fetch_add(1, Ordering::Relaxed);
+        }
+        if let Some(duration) = duration {
+            let ns = duration.as_nanos() as u64;
+            stripe.duration_sum.fetch_add(ns, Ordering::Relaxed);
+            store_min(&stripe.duration_min, ns);
+            store_max(&stripe.duration_max, ns);
+            self.buckets[bucket(ns)].fetch_add(1, Ordering::Relaxed);
+        }
+    }
+
+    /// Returns and resets the counters. Counters are reset one by one, so a
+    /// span recorded concurrently may be split across two harvests.
+    fn harvest(&self, buckets: &mut Vec<u64>) -> Option<Harvested> {
+        let mut harvested = Harvested {
+            count: 0,
+            errors: 0,
+            duration_sum: 0,
+            duration_min: u64::MAX,
+            duration_max: 0,
+        };
+        for stripe in self.stripes.iter() {
+            harvested.count += stripe.count.swap(0, Ordering::Relaxed);
+            harvested.errors += stripe.errors.swap(0, Ordering::Relaxed);
+            harvested.duration_sum += stripe.duration_sum.swap(0, Ordering::Relaxed);
+            harvested.duration_min = harvested
+                .duration_min
+                .min(stripe.duration_min.swap(u64::MAX, Ordering::Relaxed));
+            harvested.duration_max = harvested
+                .duration_max
+                .max(stripe.duration_max.swap(0, Ordering::Relaxed));
+        }
+        if harvested.count == 0 {
+            return None;
+        }
+        buckets.extend(self.buckets.iter().map(|b| b.swap(0, Ordering::Relaxed)));
+        Some(harvested)
+    }
+}
+
+struct Harvested {
+    count: u64,
+    errors: u64,
+    duration_sum: u64,
+    duration_min: u64,
+    duration_max: u64,
+}
+
+/// The aggregate of one name and service name over one interval, as it is
+/// passed to the C callback.
+#[repr(C)]
+pub struct AggregateDesc {
+    name: *const c_char,
+    name_len: usize,
+    service_name: *const c_char,
+    service_name_len: usize,
+    start: u64,
+    end: u64,
+    count: u64,
+    errors: u64,
+    duration_sum_ms: f64,
+    duration_min_ms: f64,
+    duration_max_ms: f64,
+    buckets: *const u64,
+    buckets_len: usize,
+}
+
+pub type AggregateCallback = extern "C" fn(*const AggregateDesc, usize, *mut c_void);
+
+/// The aggregation settings of a client configuration.
+pub type AggregationConfig = HarvestConfig<AggregateCallback>;
+
+/// Folds spans into per name and service name aggregates, which are passed to
+/// a callback on an interval.
+///
+/// Aggregates are looked up in a sharded table. Their counters are striped
+/// per thread shard so threads recording spans with the same name don't
+/// contend on a cache line.
+pub struct Aggregator {
+    config: AggregationConfig,
+    shards: Vec<RwLock<HashMap<u64, Vec<Arc<Aggregate>>>>>,
+    keys: AtomicUsize,
+    overflow: Aggregate,
+    harvester: Harvester,
+}
+
+impl Aggregator {
+    /// Creates an aggregator and starts its harvest thread.
+    pub fn start(config: AggregationConfig) -> Arc<Aggregator> {
+        let mut shards = Vec::with_capacity(SHARDS * 4);
+        shards.resize_with(SHARDS * 4, || RwLock::new(HashMap::new()));
+        let aggregator = Arc::new(Aggregator {
+            config,
+            shards,
+            keys: AtomicUsize::new(0),
+            overflow: Aggregate::new(OVERFLOW_NAME, ""),
+            harvester: Harvester::new("aggregator"),
+        });
+        Harvester::start(&aggregator, aggregator.config.interval);
+        aggregator
+    }
+
+    pub fn record(&self, span: &Span) {
+        let name = span.name().unwrap_or("");
+        let service_name = span.service_name().unwrap_or("");
+
+        let mut hasher = DefaultHasher::new();
+        (name, service_name).hash(&mut hasher);
+        let hash = hasher.finish();
+        let shard = &self.shards[hash as usize % self.shards.len()];
+
+        let matches = |a: &&Arc<Aggregate>| a.name == name && a.service_name == service_name;
+        {
+            let aggregates = shard.read().unwrap_or_else(PoisonError::into_inner);
+            if let Some(aggregate) = aggregates.get(&hash).and_then(|v| v.iter().find(matches)) {
+                aggregate.record(span.is_error(), span.duration());
+                return;
+            }
+        }
+
+        let mut aggregates = shard.write().unwrap_or_else(PoisonError::into_inner);
+        let candidates = aggregates.entry(hash).or_insert_with(Vec::new);
+        if let Some(aggregate) = candidates.iter().find(matches) {
+            aggregate.record(span.is_error(), span.duration());
+            return;
+        }
+        if self.keys.fetch_add(1, Ordering::Relaxed) >= KEYS_MAX {
+            self.keys.fetch_sub(1, Ordering::Relaxed);
+            self.overflow.record(span.is_error(), span.duration());
+            return;
+        }
+        let aggregate = Arc::new(Aggregate::new(name, service_name));
+        aggregate.record(span.is_error(), span.duration());
+        candidates.push(aggregate);
+    }
+
+    /// Passes the aggregates of the current interval to the callback and
+    /// starts a new interval.
+    pub fn harvest(&self) {
+        self.harvester.harvest(self);
+    }
+
+    /// Stops the harvest thread, optionally harvesting one last time.
+    pub fn stop(&self, harvest: bool) {
+        self.harvester.stop(self, harvest);
+    }
+}
+
+/// The aggregates of an interval, along with the aggregates and buckets
+/// their descriptions point into.
+pub struct AggregateSnapshot {
+    descs: Vec<AggregateDesc>,
+    _aggregates: Vec<Arc<Aggregate>>,
+    _buckets: Vec<u64>,
+}
+
+impl Harvest for Aggregator {
+    type Snapshot = AggregateSnapshot;
+
+    fn harvester(&self) -> &Harvester {
+        &self.harvester
+    }
+
+    fn collect(&self, start: u64, end: u64) -> AggregateSnapshot {
+        let mut aggregates = Vec::new();
+        for shard in self.shards.iter() {
+            let shard = shard.read().unwrap_or_else(PoisonError::into_inner);
+            for candidates in shard.values() {
+                aggregates.extend(candidates.iter().cloned());
+            }
+        }
+
+        let mut harvested = Vec::with_capacity(aggregates.len() + 1);
+        let mut buckets = Vec::new();
+        let all = aggregates
+            .iter()
+            .map(|a| &**a)
+            .chain(std::iter::once(&self.overflow));
+        for aggregate in all {
+            let offset = buckets.len();
+            if let Some(h) = aggregate.harvest(&mut buckets) {
+                harvested.push((aggregate, h, offset));
+            }
+        }
+        let descs: Vec<AggregateDesc> = harvested
+            .iter()
+            .map(|(aggregate, h, offset)| AggregateDesc {
+                name: aggregate.name.as_ptr() as *const c_char,
+                name_len: aggregate.name.len(),
+                service_name: aggregate.service_name.as_ptr() as *const c_char,
+                service_name_len: aggregate.service_name.len(),
+                start,
+                end,
+                count: h.count,
+                errors: h.errors,
+                duration_sum_ms: h.duration_sum as f64 / 1e6,
+                duration_min_ms: if h.duration_min == u64::MAX {
+                    0.0
+                } else {
+                    h.duration_min as f64 / 1e6
+                },
+                duration_max_ms: h.duration_max as f64 / 1e6,
+                buckets: buckets[*offset..].as_ptr(),
+                buckets_len: BUCKETS,
+            })
+            .collect();
+
+        AggregateSnapshot {
+            descs,
+            _aggregates: aggregates,
+            _buckets: buckets,
+        }
+    }
+
+    fn report(&self, snapshot: AggregateSnapshot) {
+        let descs = &snapshot.descs;
+        if !descs.is_empty() {
+            (self.config.callback)(descs.as_ptr(), descs.len(), self.config.user_data);
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_aggregate_quantile(aggregate: *const AggregateDesc, q: f64) -> f64 {
+    let aggregate = match unsafe { aggregate.as_ref() } {
+        Some(aggregate) => aggregate,
+        None => return 0.0,
+    };
+    if aggregate.buckets.is_null() || aggregate.buckets_len == 0 {
+        return 0.0;
+    }
+    let buckets = unsafe { std::slice::from_raw_parts(aggregate.buckets, aggregate.buckets_len) };
+    match histogram::quantile(buckets, q) {
+        Some(ns) => (ns / 1e6)
+            .max(aggregate.duration_min_ms)
+            .min(aggregate.duration_max_ms),
+        None => 0.0,
+    }
+}
@@ -0,0 +1,222 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::intern::Str;
+use crate::pool::Pool;
+use newrelic_telemetry::attribute::Value;
+use serde::ser::{Serialize, Serializer};
+use std::collections::hash_map::DefaultHasher;
+use std::hash::{Hash, Hasher};
+use std::mem;
+use std::slice;
+use std::sync::Arc;
+use std::vec;
+
+/// Collections up to this size are searched linearly, larger collections get
+/// a hash index.
+const LINEAR_MAX: usize = 16;
+
+#[derive(Clone, Debug)]
+pub enum AttributeValue {
+    Int(i64),
+    UInt(u64),
+    Double(f64),
+    Str(Str),
+    Bool(bool),
+}
+
+impl AttributeValue {
+    /// Returns whether both values are of the same type and equal. Doubles
+    /// are compared bitwise.
+    pub fn same(&self, other: &AttributeValue) -> bool {
+        match (self, other) {
+            (AttributeValue::Int(a), AttributeValue::Int(b)) => a == b,
+            (AttributeValue::UInt(a), AttributeValue::UInt(b)) => a == b,
+            (AttributeValue::Double(a), AttributeValue::Double(b)) => a.to_bits() == b.to_bits(),
+            (AttributeValue::Str(a), AttributeValue::Str(b)) => a == b,
+            (AttributeValue::Bool(a), AttributeValue::Bool(b)) => a == b,
+            _ => false,
+        }
+    }
+}
+
+impl From<i64> for AttributeValue {
+    fn from(value: i64) -> Self {
+        AttributeValue::Int(value)
+    }
+}
+
+impl From<u64> for AttributeValue {
+    fn from(value: u64) -> Self {
+        AttributeValue::UInt(value)
+    }
+}
+
+impl From<f64> for AttributeValue {
+    fn from(value: f64) -> Self {
+        AttributeValue::Double(value)
+    }
+}
+
+impl From<Str> for AttributeValue {
+    fn from(value: Str) -> Self {
+        AttributeValue::Str(value)
+    }
+}
+
+impl From<bool> for AttributeValue {
+    fn from(value: bool) -> Self {
+        AttributeValue::Bool(value)
+    }
+}
+
+impl From<AttributeValue> for Value {
+    fn from(value: AttributeValue) -> Self {
+        match value {
+            AttributeValue::Int(v) => v.into(),
+            AttributeValue::UInt(v) => v.into(),
+            AttributeValue::Double(v) => v.into(),
+            AttributeValue::Str(v) => v.into_string().into(),
+            AttributeValue::Bool(v) => v.into(),
+        }
+    }
+}
+
+/// Non-finite doubles are written as null, like the SDK sends them.
+impl Serialize for AttributeValue {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        match self {
+            AttributeValue::Int(v) => serializer.serialize_i64(*v),
+            AttributeValue::UInt(v) => serializer.serialize_u64(*v),
+            AttributeValue::Double(v) => serializer.serialize_f64(*v),
+            AttributeValue::Str(v) => serializer.serialize_str(v),
+            AttributeValue::Bool(v) => serializer.serialize_bool(*v),
+        }
+    }
+}
+
+/// A collection of attributes with unique keys, kept in insertion order.
+///
+/// Most spans carry only a handful of attributes, so entries are stored in a
+/// flat vector and looked up with a linear scan. Only once a collection grows
+/// beyond `LINEAR_MAX` entries, an open addressing index of entry positions is
+/// built on the side.
+#[derive(Default)]
+pub struct Attributes {
+    entries: Vec<(Str, AttributeValue)>,
+    index: Vec<u32>,
+    pub(crate) pool: Option<Arc<Pool>>,
+}
+
+fn hash_key(key: &str) -> usize {
+    let mut hasher = DefaultHasher::new();
+    key.hash(&mut hasher);
+    hasher.finish() as usize
+}
+
+impl Attributes {
+    pub fn new() -> Self {
+        Attributes::default()
+    }
+
+    /// Inserts an attribute, replacing the value of an existing attribute with
+    /// the same key.
+    pub fn insert(&mut self, key: Str, value: AttributeValue) {
+        if let Some(i) = self.position(&key) {
+            self.entries[i].1 = value;
+            return;
+        }
+
+        self.entries.push((key, value));
+
+        let len = self.entries.len();
+        if len > LINEAR_MAX {
+            if self.index.len() < len * 2 {
+                self.rebuild_index();
+            } else {
+                self.index_insert(len - 1);
+            }
+        }
+    }
+
+    pub fn get(&self, key: &str) -> Option<&AttributeValue> {
+        self.position(key).map(|i| &self.entries[i].1)
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Returns all attributes in insertion order.
+    pub fn iter(&self) -> slice::Iter<'_, (Str, AttributeValue)> {
+        self.entries.iter()
+    }
+
+    /// Moves all attributes of another collection into this one, leaving the
+    /// other collection empty. Values of `other` replace values with the same
+    /// key.
+    pub fn append(&mut self, other: &mut Attributes) {
+        if self.entries.is_empty() {
+            mem::swap(&mut self.entries, &mut other.entries);
+            mem::swap(&mut self.index, &mut other.index);
+            return;
+        }
+        for (key, value) in other.drain() {
+            self.insert(key, value);
+        }
+    }
+
+    /// Removes all attributes and returns them in insertion order, keeping
+    /// allocated buffers.
+    pub fn drain(&mut self) -> vec::Drain<'_, (Str, AttributeValue)> {
+        self.index.clear();
+        self.entries.drain(..)
+    }
+
+    pub fn clear(&mut self) {
+        self.index.clear();
+        self.entries.clear();
+    }
+
+    /// Returns the collection to its pool, or frees it if it isn't pooled.
+    pub fn release(mut self: Box<Self>) {
+        if let Some(pool) = self.pool.take() {
+            pool.put_attributes(self);
+        }
+    }
+
+    fn position(&self, key: &str) -> Option<usize> {
+        if self.index.is_empty() {
+            return self.entries.iter().position(|(k, _)| &**k == key);
+        }
+
+        let mask = self.index.len() - 1;
+        let mut slot = hash_key(key) & mask;
+        loop {
+            match self.index[slot] {
+                0 => return None,
+                i if &*self.entries[i as usize - 1].0 == key => return Some(i as usize - 1),
+                _ => slot = (slot + 1) & mask,
+            }
+        }
+    }
+
+    fn index_insert(&mut self, position: usize) {
+        let mask = self.index.len() - 1;
+        let mut slot = hash_key(&self.entries[position].0) & mask;
+        while self.index[slot] != 0 {
+            slot = (slot + 1) & mask;
+        }
+        self.index[slot] = position as u32 + 1;
+    }
+
+    fn rebuild_index(&mut self) {
+        let size = (self.entries.len() * 4).next_power_of_two();
+        self.index.clear();
+        self.index.resize(size, 0);
+        for position in 0..self.entries.len() {
+            self.index_insert(position);
+        }
+    }
+}
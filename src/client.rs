@@ -0,0 +1,937 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::aggregator::Aggregator;
+use crate::clock;
+use crate::completion::{Completion, Completions, Delivery};
+use crate::export::Exporter;
+use crate::metrics::Meter;
+use crate::queue::{BoundedQueue, CachePadded};
+use crate::sampler::Sampler;
+use crate::span::{Span, SpanBatch};
+use crate::spool::{Spool, REPLAY_MAX};
+use crate::stats::{ClientStats, Stats};
+use newrelic_telemetry::blocking::Client as SdkClient;
+use std::sync::atomic::{self, AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::{mpsc, Arc, Condvar, Mutex, PoisonError};
+use std::thread::{self, JoinHandle, Thread};
+use std::time::{Duration, Instant};
+
+/// How long sender threads sleep at most, so spooled batches are replayed
+/// even if nothing is sent.
+const SENDER_PARK_MAX: Duration = Duration::from_secs(1);
+
+/// The stages spans pass before they are converted for the SDK, and the
+/// metric instruments harvested alongside.
+///
+/// Spans are aggregated first, so aggregates include spans that are sampled
+/// out afterwards.
+#[derive(Clone, Default)]
+pub struct Pipeline {
+    pub aggregator: Option<Arc<Aggregator>>,
+    pub sampler: Option<Arc<Sampler>>,
+    pub meter: Option<Arc<Meter>>,
+}
+
+impl Pipeline {
+    /// Passes a span through all stages. Returns the span if it is to be sent
+    /// right away.
+    pub fn process(&self, span: Box<Span>) -> Option<Box<Span>> {
+        if let Some(aggregator) = &self.aggregator {
+            aggregator.record(&span);
+        }
+        match &self.sampler {
+            Some(sampler) => sampler.sample(span),
+            None => Some(span),
+        }
+    }
+
+    /// Passes all spans through all stages and adds spans held back by the
+    /// sampler that were decided in the meantime.
+    pub fn filter(&self, spans: &mut Vec<Box<Span>>) {
+        if let Some(aggregator) = &self.aggregator {
+            for span in spans.iter() {
+                aggregator.record(span);
+            }
+        }
+        if let Some(sampler) = &self.sampler {
+            sampler.filter(spans);
+        }
+    }
+
+    /// Appends spans held back by the sampler to `spans`, and passes the
+    /// last aggregates and metrics to the callbacks.
+    pub fn shutdown(&self, spans: &mut Vec<Box<Span>>) {
+        if let Some(sampler) = &self.sampler {
+            sampler.flush(true, spans);
+        }
+        if let Some(aggregator) = &self.aggregator {
+            aggregator.stop(true);
+        }
+        if let Some(meter) = &self.meter {
+            meter.stop(true);
+        }
+    }
+}
+
+/// Where a sender thread hands the batches it takes from the queue.
+pub enum Destination {
+    /// A client of the Rust SDK, which sends them to the trace endpoint.
+    Sdk(SdkClient),
+    /// The exporter, which writes them to local files. All sender threads
+    /// share it.
+    Export(Arc<Exporter>),
+}
+
+impl Destination {
+    /// Hands over the spans of a batch in payloads of at most `payload_max`
+    /// estimated bytes. Returns the number of payloads and their size: as
+    /// estimated for the SDK, and as written for the exporter. The batch is
+    /// left empty and its spans are released.
+    fn send(&self, batch: &mut SpanBatch, payload_max: usize) -> (usize, usize) {
+        match self {
+            Destination::Sdk(sdk) => {
+                let (mut payloads, mut bytes) = (0, 0);
+                batch.to_sdk(payload_max, |batch, size| {
+                    sdk.send_spans(batch);
+                    payloads += 1;
+                    bytes += size;
+                });
+                (payloads, bytes)
+            }
+            Destination::Export(exporter) => exporter.write(batch, payload_max),
+        }
+    }
+
+    /// Writes what the exporter buffered. SDK clients send on their own.
+    fn flush(&self) {
+        if let Destination::Export(exporter) = self {
+            exporter.flush();
+        }
+    }
+
+    /// Sends or writes what was handed over and lets go of the destination.
+    fn shutdown(self) {
+        match self {
+            Destination::Sdk(sdk) => sdk.shutdown(),
+            Destination::Export(exporter) => exporter.close(),
+        }
+    }
+}
+
+/// What `Client::send` does with a batch when the queue is full.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum Backpressure {
+    /// Drop the batch.
+    DropNewest,
+    /// Drop the oldest queued batch to make room.
+    DropOldest,
+    /// Wait up to the given time for room.
+    Block(Duration),
+    /// Once the queue is half full, keep a share of traces that shrinks as
+    /// the queue fills up. Drop the batch if the queue is full.
+    Sample,
+}
+
+impl Default for Backpressure {
+    fn default() -> Self {
+        Backpressure::DropNewest
+    }
+}
+
+/// The outcome of `Client::send`.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum SendResult {
+    Queued = 0,
+    QueuedDroppedOldest = 1,
+    QueuedSampled = 2,
+    Spooled = 3,
+    Dropped = 4,
+    Timeout = 5,
+    Invalid = 6,
+}
+
+impl SendResult {
+    /// Returns whether the spans of the batch, or some of them, will be sent.
+    pub fn is_accepted(self) -> bool {
+        match self {
+            SendResult::Queued
+            | SendResult::QueuedDroppedOldest
+            | SendResult::QueuedSampled
+            | SendResult::Spooled => true,
+            SendResult::Dropped | SendResult::Timeout | SendResult::Invalid => false,
+        }
+    }
+}
+
+/// What a flush or shutdown with a deadline left undelivered.
+///
+/// Spans the SDK clients were handed are delivered by them, and aren't
+/// counted here.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct FlushResult {
+    /// Spans not handed to an SDK client yet: still queued after a flush, or
+    /// held by sender threads still running after a shutdown.
+    spans_pending: u64,
+    /// Spans written to the spool instead of being sent.
+    spans_spooled: u64,
+    /// Spans dropped because the deadline passed.
+    spans_dropped: u64,
+    /// SDK clients that were still sending at the deadline. They are left to
+    /// finish in the background, and what they hold is lost if the process
+    /// exits.
+    sdk_clients_abandoned: u64,
+    /// Whether the deadline passed before everything was handed over.
+    pub timed_out: bool,
+}
+
+/// State shared between a client and its sender threads.
+struct Shared {
+    pipeline: Pipeline,
+    spool: Option<Arc<Spool>>,
+    exporter: Option<Arc<Exporter>>,
+    queue: BoundedQueue<Box<SpanBatch>>,
+    /// Batches submitted without blocking that go to the spool. The first
+    /// sender thread writes them, so submitting never touches the disk.
+    spool_handoff: BoundedQueue<Box<SpanBatch>>,
+    backpressure: Backpressure,
+    /// Batches with larger estimated payloads are sent in several requests.
+    payload_max: usize,
+    /// Set per sender thread while it is about to park or parked.
+    sleeping: Vec<CachePadded<AtomicBool>>,
+    /// Set per sender thread once it exited.
+    exited: Vec<AtomicBool>,
+    /// Spans queued or being handed to the SDK by a sender thread.
+    pending: AtomicUsize,
+    /// Threads waiting for pending spans to be sent or senders to exit.
+    watchers: AtomicUsize,
+    progress: (Mutex<()>, Condvar),
+    /// Sender threads stop taking batches from the queue after this reading
+    /// of the clock, unless it is zero.
+    deadline: AtomicU64,
+    /// Producers waiting for room in the queue.
+    waiters: AtomicUsize,
+    room: (Mutex<()>, Condvar),
+    stop: AtomicBool,
+    discard: AtomicBool,
+    stats: Stats,
+    completions: Completions,
+}
+
+impl Shared {
+    /// Releases a batch taken from the queue without sending it.
+    fn drop_queued(&self, mut batch: Box<SpanBatch>) {
+        let spans = batch.len();
+        if let Some(completion) = batch.completion.take() {
+            self.completions
+                .complete(completion, Delivery::Dropped, spans);
+        }
+        batch.release();
+        self.finish_pending(spans);
+    }
+
+    /// Writes the batches handed off for spooling.
+    fn write_handoff(&self) {
+        if let Some(spool) = &self.spool {
+            while let Some(mut batch) = self.spool_handoff.pop() {
+                spool.write(batch.spans_mut());
+                batch.release();
+            }
+        }
+    }
+
+    /// Accounts for spans that are no longer pending, and wakes threads
+    /// waiting for the queue to drain.
+    fn finish_pending(&self, spans: usize) {
+        // Pairs with `wait`: either this sees the watcher, or the watcher sees
+        // nothing pending.
+        if self.pending.fetch_sub(spans, Ordering::SeqCst) == spans {
+            self.notify_progress();
+        }
+    }
+
+    fn notify_progress(&self) {
+        if self.watchers.load(Ordering::SeqCst) > 0 {
+            let _guard = self
+                .progress
+                .0
+                .lock()
+                .unwrap_or_else(PoisonError::into_inner);
+            self.progress.1.notify_all();
+        }
+    }
+
+    /// Waits until `done` returns true or the deadline passes. Returns the
+    /// last result of `done`.
+    fn wait<F: Fn(&Shared) -> bool>(&self, deadline: Instant, done: F) -> bool {
+        let mut guard = self
+            .progress
+            .0
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+        self.watchers.fetch_add(1, Ordering::SeqCst);
+        let result = loop {
+            if done(self) {
+                break true;
+            }
+            let now = Instant::now();
+            if now >= deadline {
+                break false;
+            }
+            guard = self
+                .progress
+                .1
+                .wait_timeout(guard, deadline - now)
+                .unwrap_or_else(PoisonError::into_inner)
+                .0;
+        };
+        self.watchers.fetch_sub(1, Ordering::SeqCst);
+        result
+    }
+
+    /// Takes all batches left in the queue and writes them to the spool, or
+    /// drops them unless `keep` is set. Without a spool, kept batches stay
+    /// queued.
+    fn evacuate(&self, keep: bool, result: &mut FlushResult) {
+        match &self.spool {
+            Some(spool) => {
+                while let Some(mut batch) = self.queue.pop() {
+                    let spans = batch.len();
+                    spool.write(batch.spans_mut());
+                    if let Some(completion) = batch.completion.take() {
+                        self.completions
+                            .complete(completion, Delivery::Spooled, spans);
+                    }
+                    batch.release();
+                    self.finish_pending(spans);
+                    result.spans_spooled += spans as u64;
+                }
+                self.notify_room();
+            }
+            None if keep => {}
+            None => {
+                while let Some(batch) = self.queue.pop() {
+                    result.spans_dropped += batch.len() as u64;
+                    self.drop_queued(batch);
+                }
+                self.notify_room();
+            }
+        }
+        result.spans_pending = self.pending.load(Ordering::SeqCst) as u64;
+    }
+
+    /// Wakes producers blocked on a full queue.
+    fn notify_room(&self) {
+        if self.waiters.load(Ordering::SeqCst) > 0 {
+            let _guard = self.room.0.lock().unwrap_or_else(PoisonError::into_inner);
+            self.room.1.notify_all();
+        }
+    }
+}
+
+/// What a client is made of, for use by a recorder.
+pub struct Parts {
+    pub sdk: SdkClient,
+    pub pipeline: Pipeline,
+    pub spool: Option<Arc<Spool>>,
+    pub payload_max: usize,
+}
+
+/// A client as it is used via the C API.
+///
+/// This runs spans through the aggregator and the sampler, if configured, on
+/// the calling thread. Batches are then put into a bounded queue, from which
+/// one or more sender threads convert them and hand them to clients of the
+/// Rust SDK, one per sender thread. Each SDK client has its own worker
+/// thread, connections, and retry and backoff state, so requests of
+/// different senders are compressed and sent in parallel. What happens when
+/// the queue is full is determined by the backpressure policy. With a spool,
+/// batches are written to disk instead while the endpoint is unreachable, and
+/// replayed by the first sender thread later. With an exporter, sender
+/// threads write batches to files instead of handing them to SDK clients.
+pub struct Client {
+    shared: Arc<Shared>,
+    senders: Vec<JoinHandle<Destination>>,
+    sender_threads: Vec<Thread>,
+}
+
+impl Client {
+    /// Creates a client and starts a sender thread for each destination.
+    /// The first one replays batches left in the spool by a previous process.
+    pub fn new(
+        destinations: Vec<Destination>,
+        pipeline: Pipeline,
+        spool: Option<Arc<Spool>>,
+        queue_max: usize,
+        backpressure: Backpressure,
+        payload_max: usize,
+    ) -> Self {
+        let exporter = destinations
+            .iter()
+            .find_map(|destination| match destination {
+                Destination::Export(exporter) => Some(exporter.clone()),
+                Destination::Sdk(_) => None,
+            });
+        let handoff_max = if spool.is_some() { queue_max } else { 0 };
+        let shared = Arc::new(Shared {
+            pipeline,
+            spool,
+            exporter,
+            queue: BoundedQueue::new(queue_max),
+            spool_handoff: BoundedQueue::new(handoff_max),
+            backpressure,
+            payload_max,
+            sleeping: destinations
+                .iter()
+                .map(|_| CachePadded(AtomicBool::new(false)))
+                .collect(),
+            exited: destinations
+                .iter()
+                .map(|_| AtomicBool::new(false))
+                .collect(),
+            pending: AtomicUsize::new(0),
+            watchers: AtomicUsize::new(0),
+            progress: (Mutex::new(()), Condvar::new()),
+            deadline: AtomicU64::new(0),
+            waiters: AtomicUsize::new(0),
+            room: (Mutex::new(()), Condvar::new()),
+            stop: AtomicBool::new(false),
+            discard: AtomicBool::new(false),
+            stats: Stats::new(),
+            completions: Completions::new(),
+        });
+        let senders: Vec<JoinHandle<Destination>> = destinations
+            .into_iter()
+            .enumerate()
+            .map(|(id, destination)| {
+                let sender_shared = shared.clone();
+                thread::Builder::new()
+                    .name(format!("nrt-sender-{}", id))
+                    .spawn(move || {
+                        let destination = send_loop(id, destination, &sender_shared);
+                        sender_shared.exited[id].store(true, Ordering::SeqCst);
+                        sender_shared.notify_progress();
+                        destination
+                    })
+                    .expect("unable to spawn sender thread")
+            })
+            .collect();
+        let sender_threads = senders.iter().map(|s| s.thread().clone()).collect();
+
+        Client {
+            shared,
+            senders,
+            sender_threads,
+        }
+    }
+
+    pub fn sampler(&self) -> Option<&Arc<Sampler>> {
+        self.shared.pipeline.sampler.as_ref()
+    }
+
+    pub fn aggregator(&self) -> Option<&Arc<Aggregator>> {
+        self.shared.pipeline.aggregator.as_ref()
+    }
+
+    pub fn meter(&self) -> Option<&Arc<Meter>> {
+        self.shared.pipeline.meter.as_ref()
+    }
+
+    pub fn spool(&self) -> Option<&Arc<Spool>> {
+        self.shared.spool.as_ref()
+    }
+
+    /// Returns whether batches are written to files instead of being sent.
+    pub fn exports(&self) -> bool {
+        self.shared.exporter.is_some()
+    }
+
+    /// Returns the statistics of this client. This never blocks producers
+    /// or the sender threads.
+    pub fn stats(&self) -> ClientStats {
+        let shared = &*self.shared;
+        let mut stats = shared.stats.get();
+        stats.queue_depth = shared.queue.len() as u64;
+        stats.queue_capacity = shared.queue.capacity() as u64;
+        stats
+    }
+
+    /// Passes the spans of the batch through the pipeline and queues the
+    /// remaining spans for sending, or spools them while the endpoint is
+    /// unreachable or the queue is full. Batches that aren't queued are
+    /// released.
+    pub fn send(&self, batch: Box<SpanBatch>) -> SendResult {
+        self.submit(batch, None, true)
+    }
+
+    /// Like `send`, but the completion, if given, is passed to
+    /// `process_completions` once a queued batch left the queue. Unless
+    /// `may_block` is set, a full queue is never waited for.
+    pub fn submit(
+        &self,
+        mut batch: Box<SpanBatch>,
+        completion: Option<Completion>,
+        may_block: bool,
+    ) -> SendResult {
+        let start = clock::now();
+        let shared = &*self.shared;
+        shared.pipeline.filter(batch.spans_mut());
+        let spans = batch.len();
+        batch.completion = completion;
+        let (result, dropped) = self.enqueue(batch, may_block);
+        shared
+            .stats
+            .record_enqueue(result, spans, dropped, clock::now().saturating_sub(start));
+        result
+    }
+
+    /// Queues or spools a batch that passed the pipeline. Returns the outcome
+    /// and the number of spans that were dropped.
+    fn enqueue(&self, mut batch: Box<SpanBatch>, may_block: bool) -> (SendResult, usize) {
+        let shared = &*self.shared;
+        if batch.is_empty() {
+            // Nothing is left to send, which is as good as sent.
+            if let Some(completion) = batch.completion.take() {
+                shared
+                    .completions
+                    .complete(completion, Delivery::HandedOff, 0);
+            }
+            batch.release();
+            return (SendResult::Queued, 0);
+        }
+        if let Some(spool) = &shared.spool {
+            if !spool.is_up() {
+                let spans = batch.len();
+                return match self.spool_batch(spool, batch, may_block) {
+                    SendResult::Spooled => (SendResult::Spooled, 0),
+                    result => (result, spans),
+                };
+            }
+        }
+
+        let spans = batch.len();
+        let mut sampled = false;
+        if shared.backpressure == Backpressure::Sample {
+            sampled = sample_down(
+                batch.spans_mut(),
+                shared.queue.len(),
+                shared.queue.capacity(),
+            );
+            if batch.is_empty() {
+                batch.release();
+                return (SendResult::Dropped, spans);
+            }
+        }
+        let dropped = spans - batch.len();
+
+        batch.queued_at = clock::now();
+        shared.pending.fetch_add(batch.len(), Ordering::SeqCst);
+        let pushed = match shared.queue.push(batch) {
+            Ok(()) if sampled => Ok(SendResult::QueuedSampled),
+            Ok(()) => Ok(SendResult::Queued),
+            Err(batch) => match shared.backpressure {
+                Backpressure::DropNewest | Backpressure::Sample => {
+                    Err((batch, SendResult::Dropped))
+                }
+                Backpressure::DropOldest => Ok(self.push_dropping_oldest(batch)),
+                Backpressure::Block(_) if !may_block => Err((batch, SendResult::Timeout)),
+                Backpressure::Block(timeout) => self
+                    .push_blocking(batch, timeout)
+                    .map(|_| SendResult::Queued)
+                    .map_err(|batch| (batch, SendResult::Timeout)),
+            },
+        };
+
+        match pushed {
+            Ok(result) => {
+                self.wake_sender();
+                (result, dropped)
+            }
+            Err((batch, result)) => {
+                shared.finish_pending(batch.len());
+                // The spool takes what the queue has no room for.
+                if let Some(spool) = &shared.spool {
+                    return match self.spool_batch(spool, batch, may_block) {
+                        SendResult::Spooled => (SendResult::Spooled, dropped),
+                        result => (result, spans),
+                    };
+                }
+                batch.release();
+                (result, spans)
+            }
+        }
+    }
+
+    /// Writes a batch to the spool, or unless `may_block` is set, hands it
+    /// to the first sender thread for writing. Returns `Spooled`, or
+    /// `Dropped` if the hand-off is full.
+    fn spool_batch(&self, spool: &Spool, mut batch: Box<SpanBatch>, may_block: bool) -> SendResult {
+        if may_block {
+            spool.write(batch.spans_mut());
+            batch.release();
+            return SendResult::Spooled;
+        }
+        // Spooled batches get no completion.
+        batch.completion = None;
+        match self.shared.spool_handoff.push(batch) {
+            Ok(()) => {
+                self.sender_threads[0].unpark();
+                SendResult::Spooled
+            }
+            Err(batch) => {
+                batch.release();
+                SendResult::Dropped
+            }
+        }
+    }
+
+    fn push_dropping_oldest(&self, mut batch: Box<SpanBatch>) -> SendResult {
+        loop {
+            if let Some(oldest) = self.shared.queue.pop() {
+                self.shared.stats.record_evicted(oldest.len());
+                self.shared.drop_queued(oldest);
+            }
+            match self.shared.queue.push(batch) {
+                Ok(()) => return SendResult::QueuedDroppedOldest,
+                Err(rejected) => batch = rejected,
+            }
+        }
+    }
+
+    fn push_blocking(
+        &self,
+        mut batch: Box<SpanBatch>,
+        timeout: Duration,
+    ) -> Result<(), Box<SpanBatch>> {
+        let shared = &*self.shared;
+        let deadline = Instant::now() + timeout;
+        let mut guard = shared.room.0.lock().unwrap_or_else(PoisonError::into_inner);
+        shared.waiters.fetch_add(1, Ordering::SeqCst);
+        let result = loop {
+            match shared.queue.push(batch) {
+                Ok(()) => break Ok(()),
+                Err(rejected) => batch = rejected,
+            }
+            // The queue might be full because the sender threads are asleep.
+            self.wake_sender();
+            let now = Instant::now();
+            if now >= deadline {
+                break Err(batch);
+            }
+            guard = shared
+                .room
+                .1
+                .wait_timeout(guard, deadline - now)
+                .unwrap_or_else(PoisonError::into_inner)
+                .0;
+        };
+        shared.waiters.fetch_sub(1, Ordering::SeqCst);
+        result
+    }
+
+    /// Wakes a sleeping sender thread for a new batch.
+    fn wake_sender(&self) {
+        // Pairs with the fence in `send_loop`: either a sender sees the new
+        // batch before it parks, or this sees that it is sleeping. If no
+        // sender is seen sleeping, all of them will see the batch.
+        atomic::fence(Ordering::SeqCst);
+        let sleeping = self.shared.sleeping.iter();
+        for (flag, thread) in sleeping.zip(self.sender_threads.iter()) {
+            if flag.0.load(Ordering::Relaxed) {
+                thread.unpark();
+                return;
+            }
+        }
+    }
+
+    fn wake_senders(&self) {
+        for thread in self.sender_threads.iter() {
+            thread.unpark();
+        }
+    }
+
+    /// Stops the sender threads and returns the destinations of those that
+    /// exited without panicking, and the number of threads still sending at
+    /// the deadline. Those are left running. Queued batches are sent unless
+    /// `discard` is set or the deadline passes.
+    fn stop(&mut self, discard: bool, deadline: Option<Instant>) -> (Vec<Destination>, usize) {
+        let shared = &*self.shared;
+        if let Some(deadline) = deadline {
+            let left = deadline.saturating_duration_since(Instant::now());
+            let at = clock::now() + left.as_nanos() as u64;
+            shared.deadline.store(at.max(1), Ordering::Relaxed);
+        }
+        shared.discard.store(discard, Ordering::Relaxed);
+        shared.stop.store(true, Ordering::Release);
+        self.wake_senders();
+        if let Some(deadline) = deadline {
+            shared.wait(deadline, |shared| {
+                shared.exited.iter().all(|e| e.load(Ordering::SeqCst))
+            });
+        }
+        let mut destinations = Vec::with_capacity(self.senders.len());
+        let mut running = 0;
+        for (id, sender) in self.senders.drain(..).enumerate() {
+            if deadline.is_some() && !shared.exited[id].load(Ordering::SeqCst) {
+                running += 1;
+                continue;
+            }
+            match sender.join() {
+                Ok(destination) => destinations.push(destination),
+                Err(_) => log::error!("sender thread panicked"),
+            }
+        }
+        (destinations, running)
+    }
+
+    /// Waits up to `timeout` until all queued batches are handed to the SDK
+    /// clients. If the timeout passes, remaining batches are written to the
+    /// spool if there is one, and stay queued otherwise.
+    pub fn flush(&self, timeout: Duration) -> FlushResult {
+        let shared = &*self.shared;
+        let deadline = Instant::now() + timeout;
+        let mut result = FlushResult::default();
+        self.wake_senders();
+        if !shared.wait(deadline, |shared| {
+            shared.pending.load(Ordering::SeqCst) == 0
+        }) {
+            result.timed_out = true;
+            shared.evacuate(true, &mut result);
+        }
+        if let Some(exporter) = &shared.exporter {
+            exporter.flush();
+        }
+        result
+    }
+
+    /// Sends queued batches and spans held back by the pipeline, and shuts
+    /// down the SDK clients. Spooled batches that weren't replayed yet stay on
+    /// disk.
+    pub fn shutdown(self) {
+        self.finish(None);
+    }
+
+    /// Like `shutdown`, but returns once `timeout` passed. Batches still
+    /// queued then are written to the spool, or dropped without one. SDK
+    /// clients still sending then are left to finish in the background.
+    pub fn shutdown_timeout(self, timeout: Duration) -> FlushResult {
+        self.finish(Some(Instant::now() + timeout))
+    }
+
+    fn finish(mut self, deadline: Option<Instant>) -> FlushResult {
+        let mut result = FlushResult::default();
+        let (destinations, running) = self.stop(false, deadline);
+        let shared = &*self.shared;
+        // The first sender thread may have been abandoned at the deadline.
+        shared.write_handoff();
+        shared.evacuate(false, &mut result);
+        result.sdk_clients_abandoned = running as u64;
+        let expired = || deadline.map_or(false, |deadline| Instant::now() >= deadline);
+
+        let mut batch = SpanBatch::new();
+        shared.pipeline.shutdown(batch.spans_mut());
+        if !batch.is_empty() {
+            match (&shared.spool, destinations.first()) {
+                (Some(spool), _) if !spool.is_up() || expired() => {
+                    result.spans_spooled += batch.len() as u64;
+                    spool.write(batch.spans_mut());
+                }
+                (_, Some(destination)) if !expired() => {
+                    destination.send(&mut batch, shared.payload_max);
+                }
+                _ => {
+                    result.spans_dropped += batch.len() as u64;
+                    batch.reset();
+                }
+            }
+        }
+
+        result.sdk_clients_abandoned += shutdown_destinations(destinations, deadline) as u64;
+        if let Some(spool) = &shared.spool {
+            spool.shutdown();
+        }
+        shared.completions.process();
+        result.timed_out = expired()
+            && (result.spans_pending > 0
+                || result.spans_spooled > 0
+                || result.spans_dropped > 0
+                || result.sdk_clients_abandoned > 0);
+        result
+    }
+
+    /// Returns the file descriptor that is readable while completions are
+    /// pending, or -1 if there is none on this platform.
+    pub fn completion_fd(&self) -> i32 {
+        self.shared.completions.fd()
+    }
+
+    /// Calls the callbacks of pending completions on the calling thread.
+    pub fn process_completions(&self) -> usize {
+        self.shared.completions.process()
+    }
+
+    /// Stops the sender threads after sending all queued batches, and returns
+    /// the parts of the client. Only the first SDK client is kept, the others
+    /// are shut down once they sent what they were handed. Returns `None` for
+    /// a client with an exporter, since recorders hand spans to SDK clients
+    /// only.
+    pub fn into_parts(mut self) -> Option<Parts> {
+        let mut sdk = None;
+        for destination in self.stop(false, None).0 {
+            match destination {
+                Destination::Sdk(first) if sdk.is_none() => sdk = Some(first),
+                other => other.shutdown(),
+            }
+        }
+        Some(Parts {
+            sdk: sdk?,
+            pipeline: self.shared.pipeline.clone(),
+            spool: self.shared.spool.clone(),
+            payload_max: self.shared.payload_max,
+        })
+    }
+}
+
+impl Drop for Client {
+    /// Stops the sender threads, dropping queued batches, and calls the
+    /// callbacks of all batches submitted with one.
+    fn drop(&mut self) {
+        self.stop(true, None);
+        let shared = &*self.shared;
+        while let Some(batch) = shared.queue.pop() {
+            shared.drop_queued(batch);
+        }
+        shared.completions.process();
+    }
+}
+
+/// Keeps only a share of the traces of a batch when the queue is more than
+/// half full. The share falls linearly from all traces at half full to none
+/// when full. Returns whether any spans were dropped.
+fn sample_down(spans: &mut Vec<Box<Span>>, len: usize, capacity: usize) -> bool {
+    let half = capacity / 2;
+    if len <= half {
+        return false;
+    }
+    let ratio = capacity.saturating_sub(len) as f64 / (capacity - half) as f64;
+    let threshold = (ratio * 2f64.powi(64)) as u64;
+    let before = spans.len();
+    let mut kept = Vec::with_capacity(before);
+    for span in spans.drain(..) {
+        if span.trace_key() < threshold {
+            kept.push(span);
+        } else {
+            span.release();
+        }
+    }
+    *spans = kept;
+    spans.len() < before
+}
+
+/// Shuts down destinations in parallel, so each SDK client sends what it was
+/// handed and waits for its own retries and backoff. Returns the number of
+/// destinations still sending at the deadline, which are left to finish in
+/// the background.
+fn shutdown_destinations(destinations: Vec<Destination>, deadline: Option<Instant>) -> usize {
+    let (done, finished) = mpsc::channel();
+    let mut started = 0;
+    for (id, destination) in destinations.into_iter().enumerate() {
+        let done = done.clone();
+        let spawned = thread::Builder::new()
+            .name(format!("nrt-shutdown-{}", id))
+            .spawn(move || {
+                destination.shutdown();
+                let _ = done.send(());
+            });
+        match spawned {
+            Ok(_) => started += 1,
+            Err(err) => log::error!("unable to spawn shutdown thread: {}", err),
+        }
+    }
+    drop(done);
+
+    let mut stopped = 0;
+    while stopped < started {
+        let received = match deadline {
+            None => finished.recv().is_ok(),
+            Some(deadline) => {
+                let left = deadline.saturating_duration_since(Instant::now());
+                finished.recv_timeout(left).is_ok()
+            }
+        };
+        if !received {
+            break;
+        }
+        stopped += 1;
+    }
+    started - stopped
+}
+
+/// Sends queued batches to the destination of sender `id`. The first sender
+/// also replays spooled batches.
+fn send_loop(id: usize, destination: Destination, shared: &Shared) -> Destination {
+    loop {
+        let stop = shared.stop.load(Ordering::Acquire);
+        if id == 0 {
+            shared.write_handoff();
+        }
+        if stop && shared.discard.load(Ordering::Relaxed) {
+            return destination;
+        }
+
+        while let Some(mut batch) = pop_until_deadline(shared, stop) {
+            shared.notify_room();
+            let start = clock::now();
+            let queued = start.saturating_sub(batch.queued_at);
+            let spans = batch.len();
+            let completion = batch.completion.take();
+            let (payloads, bytes) = destination.send(&mut batch, shared.payload_max);
+            batch.release();
+            let end = clock::now();
+            shared
+                .stats
+                .record_sent(spans, payloads, bytes, queued, end - start);
+            if let Some(completion) = completion {
+                shared
+                    .completions
+                    .complete(completion, Delivery::HandedOff, spans);
+            }
+            shared.finish_pending(spans);
+        }
+        if let (0, Some(spool)) = (id, &shared.spool) {
+            if !stop && spool.is_up() {
+                for mut batch in spool.read(REPLAY_MAX) {
+                    destination.send(&mut batch, shared.payload_max);
+                }
+            }
+        }
+        if stop {
+            return destination;
+        }
+        destination.flush();
+
+        let sleeping = &shared.sleeping[id].0;
+        sleeping.store(true, Ordering::Relaxed);
+        atomic::fence(Ordering::SeqCst);
+        // Batches handed off for spooling unpark the first thread directly.
+        if shared.queue.is_empty() && !shared.stop.load(Ordering::Acquire) {
+            thread::park_timeout(SENDER_PARK_MAX);
+        }
+        sleeping.store(false, Ordering::Relaxed);
+    }
+}
+
+/// Pops a queued batch, unless the client is stopping and its deadline
+/// passed.
+fn pop_until_deadline(shared: &Shared, stop: bool) -> Option<Box<SpanBatch>> {
+    if stop {
+        let deadline = shared.deadline.load(Ordering::Relaxed);
+        if deadline != 0 && clock::now() >= deadline {
+            return None;
+        }
+    }
+    shared.queue.pop()
+}
@@ -0,0 +1,62 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use lazy_static::lazy_static;
+use std::time::{SystemTime, UNIX_EPOCH};
+
+/// A monotonic clock anchored once to wall time.
+///
+/// Unlike wall time the monotonic clock never jumps, so durations measured
+/// with it are always accurate. Timestamps are derived from the wall time
+/// read when the clock was anchored.
+struct Anchor {
+    monotonic_ns: u64,
+    epoch_ns: u64,
+}
+
+lazy_static! {
+    static ref ANCHOR: Anchor = {
+        let monotonic_ns = now();
+        let epoch_ns = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .map(|d| d.as_nanos() as u64)
+            .unwrap_or(0);
+        Anchor {
+            monotonic_ns,
+            epoch_ns,
+        }
+    };
+}
+
+/// Returns the current reading of the monotonic clock in nanoseconds.
+///
+/// On Unix this reads `CLOCK_MONOTONIC` directly, which is served from the
+/// vDSO on Linux and doesn't need a system call.
+#[cfg(unix)]
+pub fn now() -> u64 {
+    let mut ts = libc::timespec {
+        tv_sec: 0,
+        tv_nsec: 0,
+    };
+    unsafe { libc::clock_gettime(libc::CLOCK_MONOTONIC, &mut ts) };
+    ts.tv_sec as u64 * 1_000_000_000 + ts.tv_nsec as u64
+}
+
+/// Returns the current reading of the monotonic clock in nanoseconds.
+#[cfg(not(unix))]
+pub fn now() -> u64 {
+    use std::time::Instant;
+
+    lazy_static! {
+        static ref START: Instant = Instant::now();
+    }
+    START.elapsed().as_nanos() as u64
+}
+
+/// Converts a reading of `now()` into milliseconds since the Unix epoch.
+pub fn to_epoch_ms(ns: u64) -> u64 {
+    // The reading may predate the anchor if this is the first use.
+    let since_anchor = ns as i64 - ANCHOR.monotonic_ns as i64;
+    (ANCHOR.epoch_ns as i64 + since_anchor) as u64 / 1_000_000
+}
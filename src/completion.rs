@@ -0,0 +1,205 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use std::ffi::c_void;
+use std::io;
+use std::mem;
+use std::sync::{Mutex, MutexGuard, PoisonError};
+
+/// What became of a submitted batch.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum Delivery {
+    HandedOff = 0,
+    Dropped = 1,
+    Spooled = 2,
+}
+
+pub type CompletionCallback = extern "C" fn(Delivery, usize, *mut c_void);
+
+/// The callback of a submitted batch, called once the batch left the queue.
+pub struct Completion {
+    pub callback: CompletionCallback,
+    pub user_data: *mut c_void,
+}
+
+unsafe impl Send for Completion {}
+
+struct State {
+    pending: Vec<(Completion, Delivery, usize)>,
+    notifier: Option<Notifier>,
+}
+
+/// Completions of submitted batches, collected by the sender threads until
+/// the application processes them.
+///
+/// Callbacks are only ever called by `process`, on the thread of the caller,
+/// so an event loop can handle completions without running code on the
+/// sender threads. On Unix, a file descriptor that becomes readable while
+/// completions are pending is created on first use.
+pub struct Completions {
+    state: Mutex<State>,
+}
+
+impl Completions {
+    pub fn new() -> Self {
+        Completions {
+            state: Mutex::new(State {
+                pending: Vec::new(),
+                notifier: None,
+            }),
+        }
+    }
+
+    fn lock(&self) -> MutexGuard<'_, State> {
+        self.state.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    /// Records the delivery of a batch of `spans` spans, and signals the file
+    /// descriptor if nothing was pending before.
+    pub fn complete(&self, completion: Completion, delivery: Delivery, spans: usize) {
+        let mut state = self.lock();
+        state.pending.push((completion, delivery, spans));
+        if state.pending.len() == 1 {
+            if let Some(notifier) = &state.notifier {
+                notifier.notify();
+            }
+        }
+    }
+
+    /// Returns the file descriptor signalling pending completions, or -1 if
+    /// it can't be created on this platform.
+    pub fn fd(&self) -> i32 {
+        let mut state = self.lock();
+        if state.notifier.is_none() {
+            match Notifier::new() {
+                Ok(notifier) => {
+                    if !state.pending.is_empty() {
+                        notifier.notify();
+                    }
+                    state.notifier = Some(notifier);
+                }
+                Err(err) => {
+                    log::error!("unable to create completion notifier: {}", err);
+                    return -1;
+                }
+            }
+        }
+        state.notifier.as_ref().map_or(-1, Notifier::fd)
+    }
+
+    /// Calls the callbacks of all pending completions on the calling thread
+    /// and returns how many were called.
+    pub fn process(&self) -> usize {
+        let pending = {
+            let mut state = self.lock();
+            if let Some(notifier) = &state.notifier {
+                notifier.clear();
+            }
+            mem::replace(&mut state.pending, Vec::new())
+        };
+        for (completion, delivery, spans) in pending.iter() {
+            (completion.callback)(*delivery, *spans, completion.user_data);
+        }
+        pending.len()
+    }
+}
+
+/// A file descriptor that is readable while it is notified: an eventfd on
+/// Linux and a pipe on other Unix systems.
+#[cfg(unix)]
+struct Notifier {
+    read_fd: i32,
+    write_fd: i32,
+}
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+impl Notifier {
+    fn new() -> io::Result<Self> {
+        let fd = unsafe { libc::eventfd(0, libc::EFD_NONBLOCK | libc::EFD_CLOEXEC) };
+        if fd < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(Notifier {
+            read_fd: fd,
+            write_fd: fd,
+        })
+    }
+
+    fn notify(&self) {
+        let value = 1u64;
+        unsafe { libc::write(self.write_fd, &value as *const u64 as *const c_void, 8) };
+    }
+}
+
+#[cfg(all(unix, not(any(target_os = "linux", target_os = "android"))))]
+impl Notifier {
+    fn new() -> io::Result<Self> {
+        let mut fds = [0; 2];
+        if unsafe { libc::pipe(fds.as_mut_ptr()) } != 0 {
+            return Err(io::Error::last_os_error());
+        }
+        for &fd in fds.iter() {
+            unsafe {
+                libc::fcntl(fd, libc::F_SETFL, libc::O_NONBLOCK);
+                libc::fcntl(fd, libc::F_SETFD, libc::FD_CLOEXEC);
+            }
+        }
+        Ok(Notifier {
+            read_fd: fds[0],
+            write_fd: fds[1],
+        })
+    }
+
+    fn notify(&self) {
+        let value = 1u8;
+        unsafe { libc::write(self.write_fd, &value as *const u8 as *const c_void, 1) };
+    }
+}
+
+#[cfg(unix)]
+impl Notifier {
+    fn fd(&self) -> i32 {
+        self.read_fd
+    }
+
+    /// Reads until the descriptor isn't readable anymore.
+    fn clear(&self) {
+        let mut buf = [0u8; 64];
+        while unsafe { libc::read(self.read_fd, buf.as_mut_ptr() as *mut c_void, buf.len()) } > 0 {}
+    }
+}
+
+#[cfg(unix)]
+impl Drop for Notifier {
+    fn drop(&mut self) {
+        unsafe { libc::close(self.read_fd) };
+        if self.write_fd != self.read_fd {
+            unsafe { libc::close(self.write_fd) };
+        }
+    }
+}
+
+/// There is no file descriptor to poll on other platforms, completions have
+/// to be processed periodically there.
+#[cfg(not(unix))]
+struct Notifier;
+
+#[cfg(not(unix))]
+impl Notifier {
+    fn new() -> io::Result<Self> {
+        Err(io::Error::new(
+            io::ErrorKind::Other,
+            "not supported on this platform",
+        ))
+    }
+
+    fn fd(&self) -> i32 {
+        -1
+    }
+
+    fn notify(&self) {}
+
+    fn clear(&self) {}
+}
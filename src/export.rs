@@ -0,0 +1,276 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::lock;
+use crate::span::SpanBatch;
+use flate2::write::GzEncoder;
+use flate2::Compression;
+use std::collections::VecDeque;
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, IoSlice, Write};
+use std::mem;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex};
+
+pub const EXTENSION: &str = "ndjson";
+pub const GZIP_EXTENSION: &str = "ndjson.gz";
+
+/// Records are collected up to this many bytes before they are written with
+/// one `writev`.
+const BUFFER_MAX: usize = 256 * 1024;
+
+/// Buffers passed to one `writev` at most, the lowest `IOV_MAX` of common
+/// platforms.
+const IOV_MAX: usize = 1024;
+
+/// Files are rotated at this size unless configured otherwise.
+pub const FILE_BYTES_DEFAULT: u64 = 16 * 1024 * 1024;
+
+/// The export settings of a client configuration.
+#[derive(Clone)]
+pub struct ExportConfig {
+    pub dir: PathBuf,
+    pub file_bytes_max: u64,
+    pub files_max: u32,
+    pub compress: bool,
+}
+
+#[derive(Default)]
+struct State {
+    /// The file being appended to, with its sequence number and length.
+    file: Option<(u64, File, u64)>,
+    /// Sequence numbers of the files written before, oldest first.
+    closed: VecDeque<u64>,
+    next_seq: u64,
+    /// Records waiting to be written.
+    pending: Vec<Vec<u8>>,
+    pending_len: usize,
+}
+
+/// Writes span batches to local files instead of sending them.
+///
+/// Each payload the client would send is written as one line of JSON in the
+/// format of the trace API, so a sidecar can forward lines as they are and
+/// `nrt_replay_open` can read them back. With compression, the lines of each
+/// batch are written as a gzip member of their own, and the concatenated
+/// members of a file decompress to the same lines.
+///
+/// Sender threads encode and compress batches in parallel. The records are
+/// collected and appended to the current file with one `writev` once enough
+/// of them are buffered, or when the senders run out of batches. Files are
+/// opened with `O_APPEND` and named after a sequence number, and rotated at a
+/// size limit. The oldest files are deleted beyond a file limit.
+pub struct Exporter {
+    dir: PathBuf,
+    file_bytes_max: u64,
+    files_max: u32,
+    compression: Option<Compression>,
+    state: Mutex<State>,
+}
+
+impl Exporter {
+    /// Opens the export directory. Files left by a previous process are kept
+    /// and count towards the file limit, new files are numbered after them.
+    pub fn open(config: &ExportConfig, compression: Compression) -> io::Result<Arc<Exporter>> {
+        fs::create_dir_all(&config.dir)?;
+        let mut state = State::default();
+        let mut seqs: Vec<u64> = list(&config.dir)?.iter().map(|(seq, _)| *seq).collect();
+        seqs.sort();
+        state.next_seq = seqs.last().map_or(0, |seq| seq + 1);
+        state.closed = seqs.into();
+
+        Ok(Arc::new(Exporter {
+            dir: config.dir.clone(),
+            file_bytes_max: match config.file_bytes_max {
+                0 => FILE_BYTES_DEFAULT,
+                max => max,
+            },
+            files_max: config.files_max,
+            compression: if config.compress {
+                Some(compression)
+            } else {
+                None
+            },
+            state: Mutex::new(state),
+        }))
+    }
+
+    fn path(&self, seq: u64) -> PathBuf {
+        let extension = match self.compression {
+            Some(_) => GZIP_EXTENSION,
+            None => EXTENSION,
+        };
+        self.dir.join(format!("{:016x}.{}", seq, extension))
+    }
+
+    /// Encodes the spans of the batch as lines of JSON, one per payload, and
+    /// buffers them for writing. Returns the number of lines and the bytes
+    /// buffered. The batch is left empty and its spans are released.
+    pub fn write(&self, batch: &mut SpanBatch, payload_max: usize) -> (usize, usize) {
+        let mut record = Vec::new();
+        let lines = batch.to_json(payload_max, &mut record);
+        if lines == 0 {
+            return (0, 0);
+        }
+        if let Some(compression) = self.compression {
+            let mut encoder = GzEncoder::new(Vec::with_capacity(record.len() / 4), compression);
+            match encoder.write_all(&record).and_then(|_| encoder.finish()) {
+                Ok(compressed) => record = compressed,
+                Err(err) => {
+                    log::error!("unable to compress exported batch: {}", err);
+                    return (0, 0);
+                }
+            }
+        }
+
+        let bytes = record.len();
+        let mut state = lock(&self.state);
+        state.pending.push(record);
+        state.pending_len += bytes;
+        if state.pending_len >= BUFFER_MAX {
+            self.write_pending(&mut state);
+        }
+        (lines, bytes)
+    }
+
+    /// Writes all buffered records.
+    pub fn flush(&self) {
+        self.write_pending(&mut lock(&self.state));
+    }
+
+    /// Writes all buffered records and syncs the current file to disk. The
+    /// next record starts a new file.
+    pub fn close(&self) {
+        let mut state = lock(&self.state);
+        self.write_pending(&mut state);
+        self.close_file(&mut state);
+    }
+
+    fn close_file(&self, state: &mut State) {
+        if let Some((seq, file, _)) = state.file.take() {
+            if let Err(err) = file.sync_data() {
+                log::error!("unable to sync export file: {}", err);
+            }
+            state.closed.push_back(seq);
+        }
+    }
+
+    /// Appends the buffered records to the current file, rotating it first
+    /// if they would push it beyond its size limit. Records are dropped if
+    /// they can't be written.
+    fn write_pending(&self, state: &mut State) {
+        if state.pending.is_empty() {
+            return;
+        }
+        let records = mem::replace(&mut state.pending, Vec::new());
+        let len = mem::replace(&mut state.pending_len, 0) as u64;
+
+        let full = match &state.file {
+            Some((_, _, written)) => *written > 0 && written + len > self.file_bytes_max,
+            None => false,
+        };
+        if full {
+            self.close_file(state);
+        }
+        if state.file.is_none() {
+            let seq = state.next_seq;
+            let opened = OpenOptions::new()
+                .append(true)
+                .create_new(true)
+                .open(self.path(seq));
+            match opened {
+                Ok(file) => {
+                    state.next_seq += 1;
+                    state.file = Some((seq, file, 0));
+                }
+                Err(err) => {
+                    log::error!("unable to create export file: {}", err);
+                    return;
+                }
+            }
+            while self.files_max > 0 && state.closed.len() >= self.files_max as usize {
+                if let Some(oldest) = state.closed.pop_front() {
+                    self.remove(oldest);
+                }
+            }
+        }
+
+        let (_, file, written) = state.file.as_mut().unwrap();
+        match write_all_vectored(file, &records) {
+            Ok(()) => *written += len,
+            Err(err) => log::error!("unable to write export file: {}", err),
+        }
+    }
+
+    /// Removes an old file, whatever its extension.
+    fn remove(&self, seq: u64) {
+        for extension in &[EXTENSION, GZIP_EXTENSION] {
+            let path = self.dir.join(format!("{:016x}.{}", seq, extension));
+            match fs::remove_file(&path) {
+                Ok(()) => return,
+                Err(err) if err.kind() == io::ErrorKind::NotFound => {}
+                Err(err) => log::error!("unable to remove export file: {}", err),
+            }
+        }
+    }
+}
+
+impl Drop for Exporter {
+    fn drop(&mut self) {
+        self.close();
+    }
+}
+
+/// Writes all buffers with as few calls to `writev` as possible.
+fn write_all_vectored(file: &mut File, bufs: &[Vec<u8>]) -> io::Result<()> {
+    let (mut done, mut offset) = (0, 0);
+    while done < bufs.len() {
+        let slices: Vec<IoSlice> = bufs[done..]
+            .iter()
+            .take(IOV_MAX)
+            .enumerate()
+            .map(|(i, buf)| IoSlice::new(if i == 0 { &buf[offset..] } else { buf }))
+            .collect();
+        let mut written = match file.write_vectored(&slices) {
+            Ok(0) => return Err(io::ErrorKind::WriteZero.into()),
+            Ok(written) => written,
+            Err(err) if err.kind() == io::ErrorKind::Interrupted => continue,
+            Err(err) => return Err(err),
+        };
+        while written > 0 {
+            let left = bufs[done].len() - offset;
+            if written < left {
+                offset += written;
+                break;
+            }
+            written -= left;
+            done += 1;
+            offset = 0;
+        }
+    }
+    Ok(())
+}
+
+/// Returns the sequence number of an exported file from its name.
+fn seq_of(name: &str) -> Option<u64> {
+    let mut parts = name.splitn(2, '.');
+    let (stem, extension) = (parts.next()?, parts.next()?);
+    if extension != EXTENSION && extension != GZIP_EXTENSION {
+        return None;
+    }
+    u64::from_str_radix(stem, 16).ok()
+}
+
+/// Returns the sequence numbers and paths of the exported files in a
+/// directory, in no particular order.
+pub fn list(dir: &Path) -> io::Result<Vec<(u64, PathBuf)>> {
+    let mut files = Vec::new();
+    for entry in fs::read_dir(dir)? {
+        let path = entry?.path();
+        if let Some(seq) = path.file_name().and_then(|n| n.to_str()).and_then(seq_of) {
+            files.push((seq, path));
+        }
+    }
+    Ok(files)
+}
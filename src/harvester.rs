@@ -0,0 +1,136 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::clock;
+use crate::lock;
+use std::ffi::c_void;
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+use std::thread::{self, JoinHandle};
+use std::time::Duration;
+
+/// The settings of a feature that passes what it collected to a callback on
+/// an interval.
+#[derive(Clone)]
+pub struct HarvestConfig<C> {
+    pub interval: Duration,
+    pub callback: C,
+    pub user_data: *mut c_void,
+}
+
+// The user data is only handed back to the callback, which has to be
+// thread-safe.
+unsafe impl<C> Send for HarvestConfig<C> {}
+unsafe impl<C> Sync for HarvestConfig<C> {}
+
+/// Something that is harvested on an interval by the `Harvester` it owns.
+pub trait Harvest: Send + Sync + 'static {
+    /// What was collected in an interval, ready for the callback.
+    type Snapshot;
+
+    fn harvester(&self) -> &Harvester;
+
+    /// Takes what was collected between `start` and `end`, in milliseconds
+    /// since the epoch.
+    fn collect(&self, start: u64, end: u64) -> Self::Snapshot;
+
+    /// Passes a snapshot to the callback.
+    fn report(&self, snapshot: Self::Snapshot);
+}
+
+/// Harvests its owner on an interval on a thread of its own, and keeps track
+/// of where the current interval started. Collecting is serialized, so each
+/// interval is passed to the callback once. The callback runs without any
+/// lock held, so it may harvest or shut down the client itself.
+pub struct Harvester {
+    name: &'static str,
+    interval_start: AtomicU64,
+    harvest_lock: Mutex<()>,
+    stop: AtomicBool,
+    thread: Mutex<Option<JoinHandle<()>>>,
+}
+
+impl Harvester {
+    /// Creates a harvester whose interval starts now. `name` names its
+    /// thread and its log messages.
+    pub fn new(name: &'static str) -> Self {
+        Harvester {
+            name,
+            interval_start: AtomicU64::new(clock::now()),
+            harvest_lock: Mutex::new(()),
+            stop: AtomicBool::new(false),
+            thread: Mutex::new(None),
+        }
+    }
+
+    /// Starts the thread harvesting `target` every `interval`.
+    pub fn start<T: Harvest>(target: &Arc<T>, interval: Duration) {
+        let harvester = target.harvester();
+        let weak = Arc::downgrade(target);
+        match thread::Builder::new()
+            .name(format!("nrt-{}", harvester.name))
+            .spawn(move || harvest_loop(weak, interval))
+        {
+            Ok(handle) => *lock(&harvester.thread) = Some(handle),
+            Err(err) => log::error!("unable to start {} thread: {}", harvester.name, err),
+        }
+    }
+
+    /// Passes what `target` collected in the current interval to the
+    /// callback and starts a new interval.
+    pub fn harvest<T: Harvest>(&self, target: &T) {
+        let snapshot = {
+            let _guard = lock(&self.harvest_lock);
+            let now = clock::now();
+            let start = clock::to_epoch_ms(self.interval_start.swap(now, Ordering::Relaxed));
+            target.collect(start, clock::to_epoch_ms(now))
+        };
+        target.report(snapshot);
+    }
+
+    /// Stops the harvest thread, optionally harvesting `target` one last
+    /// time.
+    pub fn stop<T: Harvest>(&self, target: &T, harvest: bool) {
+        self.stop.store(true, Ordering::Release);
+        let thread = lock(&self.thread).take();
+        if let Some(thread) = thread {
+            thread.thread().unpark();
+            // A callback that shuts down the client runs on the harvest
+            // thread, which exits on its own once the callback returns.
+            if thread.thread().id() != thread::current().id() && thread.join().is_err() {
+                log::error!("{} thread panicked", self.name);
+            }
+        }
+        if harvest {
+            self.harvest(target);
+        }
+    }
+}
+
+impl Drop for Harvester {
+    fn drop(&mut self) {
+        // The harvest thread only holds a weak reference to the owner and
+        // exits on its own once it can't upgrade it anymore.
+        self.stop.store(true, Ordering::Release);
+        if let Some(thread) = lock(&self.thread).take() {
+            thread.thread().unpark();
+        }
+    }
+}
+
+fn harvest_loop<T: Harvest>(target: Weak<T>, interval: Duration) {
+    loop {
+        thread::park_timeout(interval);
+        let target = match target.upgrade() {
+            Some(target) => target,
+            None => return,
+        };
+        let harvester = target.harvester();
+        if harvester.stop.load(Ordering::Acquire) {
+            return;
+        }
+        // Spurious wakeups may harvest early, which is harmless.
+        harvester.harvest(&*target);
+    }
+}
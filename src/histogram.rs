@@ -0,0 +1,162 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::pool::{thread_shard, SHARDS};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+/// Buckets below this value are one nanosecond wide.
+const SUB_BUCKETS: usize = 16;
+const SUB_BUCKET_BITS: u32 = 4;
+
+/// Durations of 2^45 ns (almost ten hours) and more share the last bucket.
+const EXPONENT_MAX: u32 = 45;
+
+pub const BUCKETS: usize =
+    SUB_BUCKETS + (EXPONENT_MAX - SUB_BUCKET_BITS + 1) as usize * SUB_BUCKETS;
+
+/// Returns the histogram bucket of a duration in nanoseconds.
+///
+/// Buckets are log-linear: each power of two is split into 16 buckets of
+/// equal width, which bounds the relative error of a bucket to 1/16.
+#[inline]
+pub fn bucket(ns: u64) -> usize {
+    if ns < SUB_BUCKETS as u64 {
+        return ns as usize;
+    }
+    let exponent = 63 - ns.leading_zeros();
+    if exponent > EXPONENT_MAX {
+        return BUCKETS - 1;
+    }
+    let sub = (ns >> (exponent - SUB_BUCKET_BITS)) as usize & (SUB_BUCKETS - 1);
+    (exponent - SUB_BUCKET_BITS + 1) as usize * SUB_BUCKETS + sub
+}
+
+/// Returns the lower bound and the width of a bucket in nanoseconds.
+fn bucket_bounds(bucket: usize) -> (u64, u64) {
+    if bucket < SUB_BUCKETS {
+        return (bucket as u64, 1);
+    }
+    let shift = (bucket / SUB_BUCKETS - 1) as u32;
+    let sub = (bucket % SUB_BUCKETS) as u64;
+    ((SUB_BUCKETS as u64 + sub) << shift, 1 << shift)
+}
+
+/// Estimates a quantile from bucket counts, as the midpoint of the bucket
+/// containing it, in nanoseconds. Returns `None` if all buckets are empty.
+pub fn quantile(buckets: &[u64], q: f64) -> Option<f64> {
+    let total: u64 = buckets.iter().sum();
+    if total == 0 {
+        return None;
+    }
+    let rank = (q.max(0.0).min(1.0) * (total - 1) as f64) as u64;
+    let mut seen = 0;
+    for (i, count) in buckets.iter().enumerate() {
+        seen += count;
+        if seen > rank {
+            let (lower, width) = bucket_bounds(i);
+            return Some(lower as f64 + width as f64 / 2.0);
+        }
+    }
+    None
+}
+
+pub fn store_min(target: &AtomicU64, value: u64) {
+    let mut current = target.load(Ordering::Relaxed);
+    while value < current {
+        match target.compare_exchange_weak(current, value, Ordering::Relaxed, Ordering::Relaxed) {
+            Ok(_) => return,
+            Err(actual) => current = actual,
+        }
+    }
+}
+
+pub fn store_max(target: &AtomicU64, value: u64) {
+    let mut current = target.load(Ordering::Relaxed);
+    while value > current {
+        match target.compare_exchange_weak(current, value, Ordering::Relaxed, Ordering::Relaxed) {
+            Ok(_) => return,
+            Err(actual) => current = actual,
+        }
+    }
+}
+
+/// Summary of a latency histogram, as it is passed to C.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct LatencyStats {
+    count: u64,
+    sum_ns: u64,
+    max_ns: u64,
+    p50_ns: u64,
+    p90_ns: u64,
+    p99_ns: u64,
+    p999_ns: u64,
+}
+
+/// Count, sum and maximum of the latencies recorded by one shard of threads.
+#[repr(align(64))]
+#[derive(Default)]
+struct Stripe {
+    count: AtomicU64,
+    sum: AtomicU64,
+    max: AtomicU64,
+}
+
+/// A cumulative latency histogram that any number of threads record to
+/// without locks.
+///
+/// Recording takes a few relaxed atomic additions. Count, sum and maximum are
+/// kept per shard of threads on their own cache line, only the bucket counts
+/// are shared.
+pub struct Histogram {
+    stripes: Vec<Stripe>,
+    buckets: Vec<AtomicU64>,
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        let mut stripes = Vec::with_capacity(SHARDS);
+        stripes.resize_with(SHARDS, Stripe::default);
+        let mut buckets = Vec::with_capacity(BUCKETS);
+        buckets.resize_with(BUCKETS, || AtomicU64::new(0));
+        Histogram { stripes, buckets }
+    }
+}
+
+impl Histogram {
+    pub fn record(&self, ns: u64) {
+        let stripe = &self.stripes[thread_shard()];
+        stripe.count.fetch_add(1, Ordering::Relaxed);
+        stripe.sum.fetch_add(ns, Ordering::Relaxed);
+        store_max(&stripe.max, ns);
+        self.buckets[bucket(ns)].fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Returns a summary of all latencies recorded so far. Counters are read
+    /// one by one, so latencies recorded concurrently may be partially
+    /// included.
+    pub fn stats(&self) -> LatencyStats {
+        let mut stats = LatencyStats::default();
+        for stripe in self.stripes.iter() {
+            stats.count += stripe.count.load(Ordering::Relaxed);
+            stats.sum_ns += stripe.sum.load(Ordering::Relaxed);
+            stats.max_ns = stats.max_ns.max(stripe.max.load(Ordering::Relaxed));
+        }
+        let buckets: Vec<u64> = self
+            .buckets
+            .iter()
+            .map(|b| b.load(Ordering::Relaxed))
+            .collect();
+        let max_ns = stats.max_ns;
+        let estimate = |q| match quantile(&buckets, q) {
+            Some(ns) => (ns as u64).min(max_ns),
+            None => 0,
+        };
+        stats.p50_ns = estimate(0.5);
+        stats.p90_ns = estimate(0.9);
+        stats.p99_ns = estimate(0.99);
+        stats.p999_ns = estimate(0.999);
+        stats
+    }
+}
@@ -0,0 +1,208 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use std::cell::Cell;
+use std::str;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+/// Hex-encodes a 32-bit value into 8 lowercase ASCII digits, packed into a
+/// u64 in big-endian order.
+///
+/// All digits are computed at once in a single register: each nibble is
+/// spread into its own byte, then every byte is turned into an ASCII digit
+/// without branching.
+#[inline]
+fn hex_swar(value: u32) -> u64 {
+    let mut x = value as u64;
+    x = ((x & 0xffff_0000) << 16) | (x & 0x0000_ffff);
+    x = ((x & 0x0000_ff00_0000_ff00) << 8) | (x & 0x0000_00ff_0000_00ff);
+    x = ((x & 0x00f0_00f0_00f0_00f0) << 4) | (x & 0x000f_000f_000f_000f);
+    // 0x01 in every byte whose nibble is above 9.
+    let letters = ((x + 0x0606_0606_0606_0606) >> 4) & 0x0101_0101_0101_0101;
+    x + 0x3030_3030_3030_3030 + letters * (b'a' - b'0' - 10) as u64
+}
+
+/// Hex-encodes a u64 into 16 lowercase ASCII digits.
+#[inline]
+pub fn hex_u64(value: u64, out: &mut [u8]) {
+    out[..8].copy_from_slice(&hex_swar((value >> 32) as u32).to_be_bytes());
+    out[8..16].copy_from_slice(&hex_swar(value as u32).to_be_bytes());
+}
+
+#[derive(Clone, Copy, Debug, PartialEq)]
+enum IdValue {
+    Unset,
+    Text,
+    U64(u64),
+    U128(u64, u64),
+}
+
+impl Default for IdValue {
+    fn default() -> Self {
+        IdValue::Unset
+    }
+}
+
+/// A span, trace or parent ID.
+///
+/// IDs are kept in binary form if they are given as integers, and are only
+/// hex-encoded when the span is converted for sending. The text buffer is
+/// kept when the ID is cleared, so recycled spans don't have to allocate
+/// again.
+#[derive(Debug, Default)]
+pub struct Id {
+    text: String,
+    value: IdValue,
+}
+
+impl Id {
+    pub fn is_set(&self) -> bool {
+        self.value != IdValue::Unset
+    }
+
+    pub fn set_str(&mut self, id: &str) {
+        self.text.clear();
+        self.text.push_str(id);
+        self.value = IdValue::Text;
+    }
+
+    pub fn set_u64(&mut self, id: u64) {
+        self.value = IdValue::U64(id);
+    }
+
+    pub fn set_u128(&mut self, high: u64, low: u64) {
+        self.value = IdValue::U128(high, low);
+    }
+
+    pub fn clear(&mut self) {
+        self.text.clear();
+        self.value = IdValue::Unset;
+    }
+
+    /// Returns 64 bits of the ID to base sampling decisions on.
+    ///
+    /// This is the low half of a binary ID, or the value of the last 16 hex
+    /// digits of a textual ID, so both forms of the same ID agree. Other
+    /// textual IDs are hashed.
+    pub fn key(&self) -> u64 {
+        match self.value {
+            IdValue::Unset => 0,
+            IdValue::U64(low) | IdValue::U128(_, low) => low,
+            IdValue::Text => {
+                let bytes = self.text.as_bytes();
+                let tail = &bytes[bytes.len().saturating_sub(16)..];
+                let mut key = 0u64;
+                for &b in tail {
+                    let digit = match b {
+                        b'0'..=b'9' => b - b'0',
+                        b'a'..=b'f' => b - b'a' + 10,
+                        b'A'..=b'F' => b - b'A' + 10,
+                        _ => return fnv1a(bytes),
+                    };
+                    key = key << 4 | digit as u64;
+                }
+                key
+            }
+        }
+    }
+
+    /// Returns the length of the textual form of the ID.
+    pub fn len(&self) -> usize {
+        match self.value {
+            IdValue::Unset => 0,
+            IdValue::Text => self.text.len(),
+            IdValue::U64(_) => 16,
+            IdValue::U128(..) => 32,
+        }
+    }
+
+    /// Calls `f` with the textual form of the ID, or an empty string if the ID
+    /// isn't set. Binary IDs are encoded into a buffer on the stack.
+    pub fn with_str<R, F: FnOnce(&str) -> R>(&self, f: F) -> R {
+        let mut buf = [0u8; 32];
+        let len = match self.value {
+            IdValue::Unset => return f(""),
+            IdValue::Text => return f(&self.text),
+            IdValue::U64(id) => {
+                hex_u64(id, &mut buf);
+                16
+            }
+            IdValue::U128(high, low) => {
+                hex_u64(high, &mut buf[..16]);
+                hex_u64(low, &mut buf[16..]);
+                32
+            }
+        };
+        // The encoder only produces ASCII digits.
+        f(unsafe { str::from_utf8_unchecked(&buf[..len]) })
+    }
+}
+
+pub fn fnv1a(bytes: &[u8]) -> u64 {
+    let mut hash = 0xcbf2_9ce4_8422_2325u64;
+    for &b in bytes {
+        hash = (hash ^ b as u64).wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    hash
+}
+
+static SEED: AtomicU64 = AtomicU64::new(0);
+
+thread_local! {
+    static RNG_STATE: Cell<u64> = Cell::new(seed());
+}
+
+/// Derives a distinct seed for each thread from the current time, a global
+/// counter and the address of a thread-local.
+fn seed() -> u64 {
+    let now = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_nanos() as u64)
+        .unwrap_or(0);
+    let local = 0u8;
+    let address = &local as *const u8 as u64;
+    let count = SEED.fetch_add(1, Ordering::Relaxed);
+    splitmix64(now ^ address.rotate_left(32) ^ count.wrapping_mul(0x9e37_79b9_7f4a_7c15))
+}
+
+#[inline]
+fn splitmix64(mut z: u64) -> u64 {
+    z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+    z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+    z ^ (z >> 31)
+}
+
+/// Returns a random non-zero u64 from a generator local to the calling
+/// thread.
+///
+/// This is a splitmix64 sequence, which is fast and passes common
+/// statistical tests, but it's not cryptographically secure.
+pub fn random_id() -> u64 {
+    RNG_STATE.with(|state| loop {
+        let next = state.get().wrapping_add(0x9e37_79b9_7f4a_7c15);
+        state.set(next);
+        let id = splitmix64(next);
+        if id != 0 {
+            return id;
+        }
+    })
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_generate_span_id() -> u64 {
+    random_id()
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_generate_trace_id(high: *mut u64, low: *mut u64) -> bool {
+    match unsafe { (high.as_mut(), low.as_mut()) } {
+        (Some(high), Some(low)) => {
+            *high = random_id();
+            *low = random_id();
+            true
+        }
+        _ => false,
+    }
+}
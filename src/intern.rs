@@ -0,0 +1,249 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::{str_from_c, str_from_raw};
+use lazy_static::lazy_static;
+use std::borrow::Borrow;
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::fmt;
+use std::hash::{Hash, Hasher};
+use std::ops::Deref;
+use std::os::raw::c_char;
+use std::ptr;
+use std::sync::{PoisonError, RwLock};
+#[cfg(debug_assertions)]
+use std::{process, sync::Mutex};
+
+const SHARDS: usize = 16;
+
+/// An interned string.
+///
+/// Interned strings are never freed, so references to them are valid for the
+/// lifetime of the process and can be handed out to C callers as handles.
+pub struct Interned {
+    value: &'static str,
+}
+
+impl Interned {
+    pub fn as_str(&self) -> &'static str {
+        self.value
+    }
+}
+
+/// A concurrent string interner.
+///
+/// Strings are distributed over several independently locked shards, so
+/// threads interning different strings rarely contend. Lookups of strings that
+/// are already interned only take a read lock.
+struct Interner {
+    shards: Vec<RwLock<HashMap<&'static str, &'static Interned>>>,
+}
+
+impl Interner {
+    fn new() -> Self {
+        let mut shards = Vec::with_capacity(SHARDS);
+        for _ in 0..SHARDS {
+            shards.push(RwLock::new(HashMap::new()));
+        }
+        Interner { shards }
+    }
+
+    fn intern(&self, s: &str) -> &'static Interned {
+        let mut hasher = DefaultHasher::new();
+        s.hash(&mut hasher);
+        let shard = &self.shards[hasher.finish() as usize % SHARDS];
+
+        if let Some(interned) = shard.read().unwrap_or_else(PoisonError::into_inner).get(s) {
+            return interned;
+        }
+
+        let mut shard = shard.write().unwrap_or_else(PoisonError::into_inner);
+        if let Some(interned) = shard.get(s) {
+            return interned;
+        }
+
+        let value: &'static str = Box::leak(s.to_string().into_boxed_str());
+        let interned: &'static Interned = Box::leak(Box::new(Interned { value }));
+        shard.insert(value, interned);
+        interned
+    }
+}
+
+lazy_static! {
+    static ref INTERNER: Interner = Interner::new();
+}
+
+/// Interns a string that is used over and over again.
+pub fn intern(s: &str) -> &'static str {
+    INTERNER.intern(s).as_str()
+}
+
+/// Returns the interned string behind a handle received via the C API.
+pub fn interned(handle: *const Interned) -> Option<&'static Interned> {
+    unsafe { handle.as_ref() }
+}
+
+pub fn interned_str(handle: *const Interned) -> Option<&'static str> {
+    interned(handle).map(Interned::as_str)
+}
+
+/// Returns a string the application declared static, without copying it.
+///
+/// The application promises that the string stays valid and unchanged for the
+/// lifetime of the process, like a string literal. Debug builds record the
+/// contents of the string, so `check_static` can tell if the promise was
+/// broken.
+pub fn static_str(s: *const c_char) -> Option<&'static str> {
+    let s: &'static str = str_from_c(s)?;
+    #[cfg(debug_assertions)]
+    declare_static(s);
+    Some(s)
+}
+
+/// Strings within this distance of a local variable are assumed to be on the
+/// stack of the calling thread.
+#[cfg(debug_assertions)]
+const STACK_NEAR: usize = 64 * 1024;
+
+#[cfg(debug_assertions)]
+lazy_static! {
+    /// Hashes of the contents of the strings declared static, by address and
+    /// length.
+    static ref STATICS: Mutex<HashMap<(usize, usize), u64>> = Mutex::new(HashMap::new());
+}
+
+#[cfg(debug_assertions)]
+fn content_hash(s: &str) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    s.as_bytes().hash(&mut hasher);
+    hasher.finish()
+}
+
+/// Aborts the process, since a string declared static was not.
+#[cfg(debug_assertions)]
+fn static_violated(s: &str, problem: &str) -> ! {
+    // Aborting doesn't wait for the logger, so write to stderr directly.
+    eprintln!(
+        "nrt: string {:?} declared static {}",
+        String::from_utf8_lossy(s.as_bytes()),
+        problem
+    );
+    process::abort();
+}
+
+#[cfg(debug_assertions)]
+fn declare_static(s: &str) {
+    let local = 0u8;
+    let address = s.as_ptr() as usize;
+    let stack = &local as *const u8 as usize;
+    if address.max(stack) - address.min(stack) < STACK_NEAR {
+        static_violated(s, "is on the stack");
+    }
+    let hash = content_hash(s);
+    let mut statics = STATICS.lock().unwrap_or_else(PoisonError::into_inner);
+    if let Some(previous) = statics.insert((address, s.len()), hash) {
+        if previous != hash {
+            static_violated(s, "was changed after it was declared");
+        }
+    }
+}
+
+/// Aborts in debug builds if `s` was declared static and changed since.
+/// Strings that weren't declared static are ignored.
+#[cfg(debug_assertions)]
+pub fn check_static(s: &str) {
+    let statics = STATICS.lock().unwrap_or_else(PoisonError::into_inner);
+    if let Some(hash) = statics.get(&(s.as_ptr() as usize, s.len())) {
+        if *hash != content_hash(s) {
+            static_violated(s, "was changed after it was declared");
+        }
+    }
+}
+
+#[cfg(not(debug_assertions))]
+#[inline]
+pub fn check_static(_s: &str) {}
+
+/// A string that is either owned or valid for the lifetime of the process,
+/// because it is interned or the application declared it static.
+#[derive(Clone)]
+pub enum Str {
+    Owned(String),
+    Static(&'static str),
+}
+
+impl Str {
+    pub fn into_string(self) -> String {
+        match self {
+            Str::Owned(s) => s,
+            Str::Static(s) => s.to_string(),
+        }
+    }
+}
+
+impl Deref for Str {
+    type Target = str;
+
+    fn deref(&self) -> &str {
+        match self {
+            Str::Owned(s) => s,
+            Str::Static(s) => s,
+        }
+    }
+}
+
+impl Borrow<str> for Str {
+    fn borrow(&self) -> &str {
+        self
+    }
+}
+
+impl PartialEq for Str {
+    fn eq(&self, other: &Str) -> bool {
+        **self == **other
+    }
+}
+
+impl Eq for Str {}
+
+impl Hash for Str {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        (**self).hash(state)
+    }
+}
+
+impl fmt::Debug for Str {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        (**self).fmt(f)
+    }
+}
+
+impl From<&str> for Str {
+    fn from(s: &str) -> Self {
+        Str::Owned(s.to_string())
+    }
+}
+
+impl From<&'static Interned> for Str {
+    fn from(interned: &'static Interned) -> Self {
+        Str::Static(interned.value)
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_intern(s: *const c_char) -> *const Interned {
+    match str_from_c(s) {
+        Some(s) => INTERNER.intern(s),
+        None => ptr::null(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_intern_n(s: *const c_char, len: usize) -> *const Interned {
+    match str_from_raw(s, len) {
+        Some(s) => INTERNER.intern(s),
+        None => ptr::null(),
+    }
+}
@@ -2,17 +2,52 @@
 /// Copyright 2020 New Relic Corporation. All rights reserved.
 /// SPDX-License-Identifier: Apache-2.0
 ///
-use log;
-use newrelic_telemetry::attribute::Value;
-use newrelic_telemetry::span::Span;
-use newrelic_telemetry::span::SpanBatch;
-use newrelic_telemetry::{blocking::Client, ClientBuilder};
-use simplelog::{Config, LevelFilter, TermLogger, TerminalMode, WriteLogger};
-use std::collections::HashMap;
-use std::ffi::CStr;
-use std::fs::File;
+mod aggregator;
+mod attributes;
+mod client;
+mod clock;
+mod codec;
+mod completion;
+mod export;
+mod harvester;
+mod histogram;
+mod id;
+mod intern;
+mod logger;
+mod metrics;
+mod pool;
+mod queue;
+mod recorder;
+mod replay;
+mod sampler;
+mod span;
+mod spool;
+mod stats;
+
+use aggregator::{AggregateCallback, AggregationConfig, Aggregator};
+use attributes::{AttributeValue, Attributes};
+use client::{Backpressure, Client, Destination, FlushResult, Pipeline, SendResult};
+use completion::{Completion, CompletionCallback};
+use export::{ExportConfig, Exporter};
+use flate2::Compression;
+use id::Id;
+use intern::{intern, interned, interned_str, static_str, Interned, Str};
+use log::{self, LevelFilter};
+use logger::{LogStats, RotatingFile, Sink};
+use metrics::{Instrument, Meter, MetricCallback, MetricKind, MetricsConfig};
+use newrelic_telemetry::ClientBuilder;
+use replay::{Replay, ReplayStats};
+use sampler::{Sampler, SamplingConfig, SamplingStats, TailConfig};
+use span::{Span, SpanBatch, Template};
+use spool::{Spool, SpoolConfig, SpoolStats};
+use stats::ClientStats;
+use std::ffi::{c_void, CStr};
+use std::mem::ManuallyDrop;
 use std::os::raw::c_char;
 use std::ptr;
+use std::slice;
+use std::str;
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
 use std::time::Duration;
 
 pub struct ClientConfig {
@@ -24,8 +59,89 @@ pub struct ClientConfig {
     product: Option<String>,
     version: Option<String>,
     queue_max: Option<usize>,
+    backpressure: Backpressure,
+    payload_max: Option<usize>,
+    compression_level: Option<u32>,
+    sender_threads: Option<usize>,
+    sampling: SamplingConfig,
+    aggregation: Option<AggregationConfig>,
+    metrics: Option<MetricsConfig>,
+    spool: Option<SpoolConfig>,
+    export: Option<ExportConfig>,
+}
+
+/// The trace endpoint the SDK sends to unless configured otherwise.
+const DEFAULT_HOST_TRACES: &str = "trace-api.newrelic.com";
+const DEFAULT_PORT: u16 = 443;
+
+/// The capacity of the send queue unless configured otherwise.
+const DEFAULT_QUEUE_MAX: usize = 100;
+
+/// The maximum estimated payload of a request unless configured otherwise.
+/// This is the limit of the trace API for compressed payloads, so a payload
+/// within it is accepted however well it compresses.
+const DEFAULT_PAYLOAD_MAX: usize = 1_000_000;
+
+/// Sender threads are capped at this number.
+const SENDER_THREADS_MAX: usize = 64;
+
+/// The compression level of spooled and exported batches unless configured
+/// otherwise.
+const DEFAULT_COMPRESSION_LEVEL: u32 = 1;
+
+const NRT_BACKPRESSURE_DROP_NEWEST: i32 = 0;
+const NRT_BACKPRESSURE_DROP_OLDEST: i32 = 1;
+const NRT_BACKPRESSURE_BLOCK: i32 = 2;
+const NRT_BACKPRESSURE_SAMPLE: i32 = 3;
+
+const NRT_ATTRIBUTE_INT: i32 = 0;
+const NRT_ATTRIBUTE_UINT: i32 = 1;
+const NRT_ATTRIBUTE_DOUBLE: i32 = 2;
+const NRT_ATTRIBUTE_STRING: i32 = 3;
+const NRT_ATTRIBUTE_BOOL: i32 = 4;
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub struct StringDesc {
+    ptr: *const c_char,
+    len: usize,
+}
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+pub union AttributeValueDesc {
+    int_value: i64,
+    uint_value: u64,
+    double_value: f64,
+    string_value: StringDesc,
+    bool_value: bool,
+}
+
+#[repr(C)]
+pub struct AttributeDesc {
+    key: *const c_char,
+    key_len: usize,
+    value_type: i32,
+    value: AttributeValueDesc,
+}
+
+#[repr(C)]
+pub struct SpanDesc {
+    id: *const c_char,
+    id_len: usize,
+    trace_id: *const c_char,
+    trace_id_len: usize,
+    parent_id: *const c_char,
+    parent_id_len: usize,
+    name: *const c_char,
+    name_len: usize,
+    service_name: *const c_char,
+    service_name_len: usize,
+    timestamp: u64,
+    duration: u64,
+    attributes: *const AttributeDesc,
+    attributes_len: usize,
 }
-type Attributes = HashMap<String, Value>;
 
 impl From<&ClientConfig> for ClientBuilder {
     fn from(config: &ClientConfig) -> ClientBuilder {
@@ -52,65 +168,122 @@ impl From<&ClientConfig> for ClientBuilder {
     }
 }
 
-#[no_mangle]
-pub extern "C" fn nrt_log_init(level: i32, filename: *const c_char) -> bool {
-    if filename.is_null() {
-        return false;
+/// Converts bytes received via the C API into a string slice.
+///
+/// With the `trusted-utf8` feature, callers guarantee valid UTF-8 and the
+/// validation is skipped in release builds. Debug builds always validate.
+#[cfg(not(feature = "trusted-utf8"))]
+fn str_from_bytes(bytes: &[u8]) -> Option<&str> {
+    str::from_utf8(bytes).ok()
+}
+
+#[cfg(feature = "trusted-utf8")]
+fn str_from_bytes(bytes: &[u8]) -> Option<&str> {
+    if cfg!(debug_assertions) {
+        return str::from_utf8(bytes).ok();
+    }
+    Some(unsafe { str::from_utf8_unchecked(bytes) })
+}
+
+/// Locks a mutex, ignoring poisoning: the data it guards stays consistent
+/// even if a thread panicked while holding it.
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+fn str_from_c<'a>(s: *const c_char) -> Option<&'a str> {
+    if s.is_null() {
+        return None;
     }
 
-    let level = match level {
+    str_from_bytes(unsafe { CStr::from_ptr(s) }.to_bytes())
+}
+
+fn str_from_raw<'a>(s: *const c_char, len: usize) -> Option<&'a str> {
+    if s.is_null() {
+        return None;
+    }
+
+    str_from_bytes(unsafe { slice::from_raw_parts(s as *const u8, len) })
+}
+
+fn level_filter(level: i32) -> LevelFilter {
+    match level {
         0 => LevelFilter::Error,
         1 => LevelFilter::Warn,
         2 => LevelFilter::Info,
         3 => LevelFilter::Debug,
         4 => LevelFilter::Trace,
         _ => LevelFilter::Off,
-    };
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_log_init(level: i32, filename: *const c_char) -> bool {
+    nrt_log_init_rotating(level, filename, 0, 0)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_log_init_rotating(
+    level: i32,
+    filename: *const c_char,
+    size_max: u64,
+    files_max: u32,
+) -> bool {
+    if filename.is_null() {
+        return false;
+    }
 
     if let Ok(filename) = unsafe { CStr::from_ptr(filename).to_str() } {
-        match filename {
-            "stdout" => {
-                if let Ok(_) = TermLogger::init(level, Config::default(), TerminalMode::Stdout) {
-                    return true;
-                }
-            }
-            "stderr" => {
-                if let Ok(_) = TermLogger::init(level, Config::default(), TerminalMode::Stderr) {
-                    return true;
-                }
-            }
-            filename => {
-                if let Ok(file) = File::create(filename) {
-                    if let Ok(_) = WriteLogger::init(level, Config::default(), file) {
-                        return true;
-                    }
-                }
-                return false;
-            }
-        }
+        let sink = match filename {
+            "stdout" => Sink::Stdout,
+            "stderr" => Sink::Stderr,
+            filename => match RotatingFile::create(filename.into(), size_max, files_max) {
+                Ok(file) => Sink::File(file),
+                Err(_) => return false,
+            },
+        };
+        return logger::init(level_filter(level), sink);
     }
 
     false
 }
 
+#[no_mangle]
+pub extern "C" fn nrt_log_set_level(level: i32) {
+    logger::set_level(level_filter(level));
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_log_flush() {
+    logger::flush();
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_log_get_stats(stats: *mut LogStats) -> bool {
+    match unsafe { stats.as_mut() } {
+        Some(stats) => {
+            *stats = logger::stats();
+            true
+        }
+        None => false,
+    }
+}
+
 #[no_mangle]
 pub extern "C" fn nrt_attributes_new() -> *mut Attributes {
-    let attrs: HashMap<String, Value> = HashMap::new();
+    let attrs = Attributes::new();
     Box::into_raw(Box::new(attrs))
 }
 
-fn nrt_attributes_set<T: Into<Value>>(
+fn nrt_attributes_set<K: Into<Str>, T: Into<AttributeValue>>(
     attributes: *mut Attributes,
-    key: *const c_char,
+    key: Option<K>,
     value: T,
 ) -> bool {
-    if key.is_null() {
-        return false;
-    }
-
     if let Some(attrs) = unsafe { attributes.as_mut() } {
-        if let Ok(key) = unsafe { CStr::from_ptr(key).to_str() } {
-            attrs.insert(key.to_string(), value.into());
+        if let Some(key) = key {
+            attrs.insert(key.into(), value.into());
             return true;
         }
     }
@@ -124,7 +297,17 @@ pub extern "C" fn nrt_attributes_set_int(
     key: *const c_char,
     value: i64,
 ) -> bool {
-    nrt_attributes_set(attributes, key, value)
+    nrt_attributes_set(attributes, str_from_c(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_int_n(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    key_len: usize,
+    value: i64,
+) -> bool {
+    nrt_attributes_set(attributes, str_from_raw(key, key_len), value)
 }
 
 #[no_mangle]
@@ -133,7 +316,17 @@ pub extern "C" fn nrt_attributes_set_uint(
     key: *const c_char,
     value: u64,
 ) -> bool {
-    nrt_attributes_set(attributes, key, value)
+    nrt_attributes_set(attributes, str_from_c(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_uint_n(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    key_len: usize,
+    value: u64,
+) -> bool {
+    nrt_attributes_set(attributes, str_from_raw(key, key_len), value)
 }
 
 #[no_mangle]
@@ -142,7 +335,17 @@ pub extern "C" fn nrt_attributes_set_double(
     key: *const c_char,
     value: f64,
 ) -> bool {
-    nrt_attributes_set(attributes, key, value)
+    nrt_attributes_set(attributes, str_from_c(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_double_n(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    key_len: usize,
+    value: f64,
+) -> bool {
+    nrt_attributes_set(attributes, str_from_raw(key, key_len), value)
 }
 
 #[no_mangle]
@@ -151,12 +354,23 @@ pub extern "C" fn nrt_attributes_set_string(
     key: *const c_char,
     value: *const c_char,
 ) -> bool {
-    if value.is_null() {
-        return false;
+    if let Some(value) = str_from_c(value) {
+        nrt_attributes_set(attributes, str_from_c(key), Str::from(value))
+    } else {
+        false
     }
+}
 
-    if let Ok(value) = unsafe { CStr::from_ptr(value).to_str() } {
-        nrt_attributes_set(attributes, key, value)
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_string_n(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    key_len: usize,
+    value: *const c_char,
+    value_len: usize,
+) -> bool {
+    if let Some(value) = str_from_raw(value, value_len) {
+        nrt_attributes_set(attributes, str_from_raw(key, key_len), Str::from(value))
     } else {
         false
     }
@@ -168,7 +382,119 @@ pub extern "C" fn nrt_attributes_set_bool(
     key: *const c_char,
     value: bool,
 ) -> bool {
-    nrt_attributes_set(attributes, key, value)
+    nrt_attributes_set(attributes, str_from_c(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_bool_n(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    key_len: usize,
+    value: bool,
+) -> bool {
+    nrt_attributes_set(attributes, str_from_raw(key, key_len), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_int_i(
+    attributes: *mut Attributes,
+    key: *const Interned,
+    value: i64,
+) -> bool {
+    nrt_attributes_set(attributes, interned(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_int_s(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    value: i64,
+) -> bool {
+    nrt_attributes_set(attributes, static_str(key).map(Str::Static), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_uint_i(
+    attributes: *mut Attributes,
+    key: *const Interned,
+    value: u64,
+) -> bool {
+    nrt_attributes_set(attributes, interned(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_uint_s(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    value: u64,
+) -> bool {
+    nrt_attributes_set(attributes, static_str(key).map(Str::Static), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_double_i(
+    attributes: *mut Attributes,
+    key: *const Interned,
+    value: f64,
+) -> bool {
+    nrt_attributes_set(attributes, interned(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_double_s(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    value: f64,
+) -> bool {
+    nrt_attributes_set(attributes, static_str(key).map(Str::Static), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_string_i(
+    attributes: *mut Attributes,
+    key: *const Interned,
+    value: *const Interned,
+) -> bool {
+    if let Some(value) = interned(value) {
+        nrt_attributes_set(attributes, interned(key), Str::from(value))
+    } else {
+        false
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_string_s(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    value: *const c_char,
+) -> bool {
+    if let Some(value) = static_str(value) {
+        nrt_attributes_set(
+            attributes,
+            static_str(key).map(Str::Static),
+            Str::Static(value),
+        )
+    } else {
+        false
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_bool_i(
+    attributes: *mut Attributes,
+    key: *const Interned,
+    value: bool,
+) -> bool {
+    nrt_attributes_set(attributes, interned(key), value)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_attributes_set_bool_s(
+    attributes: *mut Attributes,
+    key: *const c_char,
+    value: bool,
+) -> bool {
+    nrt_attributes_set(attributes, static_str(key).map(Str::Static), value)
 }
 
 #[no_mangle]
@@ -177,7 +503,7 @@ pub extern "C" fn nrt_attributes_destroy(attributes: *mut *mut Attributes) {
         let a = unsafe { *attributes };
         if !a.is_null() {
             let a = unsafe { Box::from_raw(a) };
-            drop(a);
+            a.release();
             unsafe { *attributes = ptr::null_mut() };
         }
     }
@@ -199,6 +525,15 @@ pub extern "C" fn nrt_client_config_new(key: *const c_char) -> *mut ClientConfig
             product: None,
             version: None,
             queue_max: None,
+            backpressure: Backpressure::default(),
+            payload_max: None,
+            compression_level: None,
+            sender_threads: None,
+            sampling: SamplingConfig::default(),
+            aggregation: None,
+            metrics: None,
+            spool: None,
+            export: None,
         };
         return Box::into_raw(Box::new(config));
     }
@@ -272,114 +607,524 @@ pub extern "C" fn nrt_client_config_set_queue_max(config: *mut ClientConfig, que
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_client_config_destroy(config: *mut *mut ClientConfig) {
-    if !config.is_null() {
-        let c = unsafe { *config };
-        if !c.is_null() {
-            let c = unsafe { Box::from_raw(c) };
-            drop(c);
-            unsafe { *config = ptr::null_mut() };
-        }
+pub extern "C" fn nrt_client_config_set_sender_threads(config: *mut ClientConfig, threads: usize) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.sender_threads = match threads {
+            0 => None,
+            threads => Some(threads.min(SENDER_THREADS_MAX)),
+        };
     }
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_new(
-    id: *const c_char,
-    trace_id: *const c_char,
-    timestamp: u64,
-) -> *mut Span {
-    if !id.is_null() && !trace_id.is_null() {
-        if let Ok(id) = unsafe { CStr::from_ptr(id).to_str() } {
-            if let Ok(trace_id) = unsafe { CStr::from_ptr(trace_id).to_str() } {
-                let span = Span::new(id, trace_id, timestamp);
-                return Box::into_raw(Box::new(span));
-            }
-        }
+pub extern "C" fn nrt_client_config_set_payload_max(config: *mut ClientConfig, payload_max: usize) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.payload_max = match payload_max {
+            0 => None,
+            payload_max => Some(payload_max),
+        };
     }
-
-    ptr::null_mut()
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_set_id(span: *mut Span, id: *const c_char) -> bool {
-    if !id.is_null() {
-        if let Some(span) = unsafe { span.as_mut() } {
-            if let Ok(id) = unsafe { CStr::from_ptr(id).to_str() } {
-                span.set_id(id);
-                return true;
-            }
+pub extern "C" fn nrt_client_config_set_compression_level(
+    config: *mut ClientConfig,
+    level: u32,
+) -> bool {
+    match unsafe { config.as_mut() } {
+        Some(config) if level <= 9 => {
+            config.compression_level = Some(level);
+            true
         }
+        _ => false,
     }
-    false
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_set_trace_id(span: *mut Span, trace_id: *const c_char) -> bool {
-    if !trace_id.is_null() {
-        if let Some(span) = unsafe { span.as_mut() } {
-            if let Ok(trace_id) = unsafe { CStr::from_ptr(trace_id).to_str() } {
-                span.set_trace_id(trace_id);
-                return true;
-            }
+pub extern "C" fn nrt_client_config_set_backpressure(
+    config: *mut ClientConfig,
+    policy: i32,
+    timeout_ms: u64,
+) -> bool {
+    let backpressure = match policy {
+        NRT_BACKPRESSURE_DROP_NEWEST => Backpressure::DropNewest,
+        NRT_BACKPRESSURE_DROP_OLDEST => Backpressure::DropOldest,
+        NRT_BACKPRESSURE_BLOCK => Backpressure::Block(Duration::from_millis(timeout_ms)),
+        NRT_BACKPRESSURE_SAMPLE => Backpressure::Sample,
+        _ => return false,
+    };
+    match unsafe { config.as_mut() } {
+        Some(config) => {
+            config.backpressure = backpressure;
+            true
         }
+        None => false,
     }
-    false
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_set_timestamp(span: *mut Span, timestamp: u64) -> bool {
-    if let Some(span) = unsafe { span.as_mut() } {
-        span.set_timestamp(timestamp);
-        return true;
+pub extern "C" fn nrt_client_config_set_sampling_ratio(config: *mut ClientConfig, ratio: f64) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.sampling.ratio = Some(ratio);
     }
-    false
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_set_name(span: *mut Span, name: *const c_char) -> bool {
-    if !name.is_null() {
-        if let Some(span) = unsafe { span.as_mut() } {
-            if let Ok(name) = unsafe { CStr::from_ptr(name).to_str() } {
-                span.set_name(name);
-                return true;
-            }
-        }
+pub extern "C" fn nrt_client_config_set_sampling_rate_limit(
+    config: *mut ClientConfig,
+    traces_per_second: u32,
+) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.sampling.rate_limit = Some(traces_per_second);
     }
-    false
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_set_duration(span: *mut Span, duration: u64) -> bool {
-    if let Some(span) = unsafe { span.as_mut() } {
-        span.set_duration(Duration::from_millis(duration));
-        return true;
+pub extern "C" fn nrt_client_config_set_tail_sampling(
+    config: *mut ClientConfig,
+    duration_threshold_us: u64,
+    decision_wait_ms: u64,
+) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.sampling.tail = Some(TailConfig {
+            duration_threshold: match duration_threshold_us {
+                0 => None,
+                us => Some(Duration::from_micros(us)),
+            },
+            decision_wait: Duration::from_millis(decision_wait_ms),
+        });
     }
-    false
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_set_parent_id(span: *mut Span, parent_id: *const c_char) -> bool {
-    if !parent_id.is_null() {
-        if let Some(span) = unsafe { span.as_mut() } {
-            if let Ok(parent_id) = unsafe { CStr::from_ptr(parent_id).to_str() } {
-                span.set_parent_id(parent_id);
-                return true;
-            }
-        }
+pub extern "C" fn nrt_client_config_set_aggregation(
+    config: *mut ClientConfig,
+    interval_ms: u64,
+    callback: Option<AggregateCallback>,
+    user_data: *mut c_void,
+) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.aggregation = match (interval_ms, callback) {
+            (0, _) | (_, None) => None,
+            (ms, Some(callback)) => Some(AggregationConfig {
+                interval: Duration::from_millis(ms),
+                callback,
+                user_data,
+            }),
+        };
     }
-    false
 }
 
 #[no_mangle]
-pub extern "C" fn nrt_span_set_service_name(span: *mut Span, service_name: *const c_char) -> bool {
-    if !service_name.is_null() {
-        if let Some(span) = unsafe { span.as_mut() } {
-            if let Ok(service_name) = unsafe { CStr::from_ptr(service_name).to_str() } {
-                span.set_service_name(service_name);
-                return true;
-            }
-        }
+pub extern "C" fn nrt_client_config_set_metrics(
+    config: *mut ClientConfig,
+    interval_ms: u64,
+    callback: Option<MetricCallback>,
+    user_data: *mut c_void,
+) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.metrics = match (interval_ms, callback) {
+            (0, _) | (_, None) => None,
+            (ms, Some(callback)) => Some(MetricsConfig {
+                interval: Duration::from_millis(ms),
+                callback,
+                user_data,
+            }),
+        };
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_config_set_spool(
+    config: *mut ClientConfig,
+    dir: *const c_char,
+    bytes_max: u64,
+) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.spool = match (str_from_c(dir), bytes_max) {
+            (None, _) | (_, 0) => None,
+            (Some(dir), bytes_max) => Some(SpoolConfig {
+                dir: dir.into(),
+                bytes_max,
+            }),
+        };
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_config_set_export(
+    config: *mut ClientConfig,
+    dir: *const c_char,
+    file_bytes_max: u64,
+    files_max: u32,
+    compress: bool,
+) {
+    if let Some(config) = unsafe { config.as_mut() } {
+        config.export = str_from_c(dir).map(|dir| ExportConfig {
+            dir: dir.into(),
+            file_bytes_max,
+            files_max,
+            compress,
+        });
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_config_destroy(config: *mut *mut ClientConfig) {
+    if !config.is_null() {
+        let c = unsafe { *config };
+        if !c.is_null() {
+            let c = unsafe { Box::from_raw(c) };
+            drop(c);
+            unsafe { *config = ptr::null_mut() };
+        }
+    }
+}
+
+fn span_new(id: Option<&str>, trace_id: Option<&str>, timestamp: u64) -> *mut Span {
+    if let (Some(id), Some(trace_id)) = (id, trace_id) {
+        let span = Span::new(id, trace_id, timestamp);
+        return Box::into_raw(Box::new(span));
+    }
+
+    ptr::null_mut()
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_new(
+    id: *const c_char,
+    trace_id: *const c_char,
+    timestamp: u64,
+) -> *mut Span {
+    span_new(str_from_c(id), str_from_c(trace_id), timestamp)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_new_n(
+    id: *const c_char,
+    id_len: usize,
+    trace_id: *const c_char,
+    trace_id_len: usize,
+    timestamp: u64,
+) -> *mut Span {
+    span_new(
+        str_from_raw(id, id_len),
+        str_from_raw(trace_id, trace_id_len),
+        timestamp,
+    )
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_new_u64(
+    id: u64,
+    trace_id_high: u64,
+    trace_id_low: u64,
+    timestamp: u64,
+) -> *mut Span {
+    if id == 0 || (trace_id_high == 0 && trace_id_low == 0) {
+        return ptr::null_mut();
+    }
+    let mut span = Span::default();
+    span.set_id_u64(id);
+    span.set_trace_id_u128(trace_id_high, trace_id_low);
+    span.set_timestamp(timestamp);
+    Box::into_raw(Box::new(span))
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_template_new(
+    name: *const c_char,
+    service_name: *const c_char,
+    attributes: *mut *mut Attributes,
+) -> *const Template {
+    let mut attrs = match unsafe { attributes.as_mut() } {
+        Some(a) if !a.is_null() => {
+            let attrs = unsafe { Box::from_raw(*a) };
+            unsafe { *attributes = ptr::null_mut() };
+            Some(attrs)
+        }
+        _ => None,
+    };
+    // NULL strings are left unset, invalid strings fail.
+    let optional = |s: *const c_char| {
+        if s.is_null() {
+            Some(None)
+        } else {
+            str_from_c(s).map(|s| Some(intern(s)))
+        }
+    };
+
+    let template = match (optional(name), optional(service_name)) {
+        (Some(name), Some(service_name)) => {
+            let template = Template::new(name, service_name, attrs.as_deref_mut());
+            Arc::into_raw(Arc::new(template))
+        }
+        _ => ptr::null(),
+    };
+    if let Some(attrs) = attrs {
+        attrs.release();
+    }
+    template
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_from_template(
+    template: *const Template,
+    id: *const c_char,
+    trace_id: *const c_char,
+    timestamp: u64,
+) -> *mut Span {
+    if template.is_null() {
+        return ptr::null_mut();
+    }
+    let span = nrt_span_new(id, trace_id, timestamp);
+    span_set_template(span, template);
+    span
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_from_template_u64(
+    template: *const Template,
+    id: u64,
+    trace_id_high: u64,
+    trace_id_low: u64,
+    timestamp: u64,
+) -> *mut Span {
+    if template.is_null() {
+        return ptr::null_mut();
+    }
+    let span = nrt_span_new_u64(id, trace_id_high, trace_id_low, timestamp);
+    span_set_template(span, template);
+    span
+}
+
+/// Makes a span created from a template handle share the template, without
+/// taking over the reference of the handle.
+fn span_set_template(span: *mut Span, template: *const Template) {
+    if let Some(span) = unsafe { span.as_mut() } {
+        let template = ManuallyDrop::new(unsafe { Arc::from_raw(template) });
+        span.set_template(&template);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_template_destroy(template: *mut *const Template) {
+    if let Some(t) = unsafe { template.as_mut() } {
+        if !t.is_null() {
+            drop(unsafe { Arc::from_raw(*t) });
+            *t = ptr::null();
+        }
+    }
+}
+
+fn span_set_str<F: FnOnce(&mut Span, &str)>(span: *mut Span, value: Option<&str>, set: F) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if let Some(value) = value {
+            set(span, value);
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_id(span: *mut Span, id: *const c_char) -> bool {
+    span_set_str(span, str_from_c(id), Span::set_id)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_id_n(span: *mut Span, id: *const c_char, len: usize) -> bool {
+    span_set_str(span, str_from_raw(id, len), Span::set_id)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_id_u64(span: *mut Span, id: u64) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if id != 0 {
+            span.set_id_u64(id);
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_trace_id(span: *mut Span, trace_id: *const c_char) -> bool {
+    span_set_str(span, str_from_c(trace_id), Span::set_trace_id)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_trace_id_n(
+    span: *mut Span,
+    trace_id: *const c_char,
+    len: usize,
+) -> bool {
+    span_set_str(span, str_from_raw(trace_id, len), Span::set_trace_id)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_trace_id_u128(span: *mut Span, high: u64, low: u64) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if high != 0 || low != 0 {
+            span.set_trace_id_u128(high, low);
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_timestamp(span: *mut Span, timestamp: u64) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        span.set_timestamp(timestamp);
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_name(span: *mut Span, name: *const c_char) -> bool {
+    span_set_str(span, str_from_c(name), Span::set_name)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_name_n(span: *mut Span, name: *const c_char, len: usize) -> bool {
+    span_set_str(span, str_from_raw(name, len), Span::set_name)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_name_i(span: *mut Span, name: *const Interned) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if let Some(name) = interned_str(name) {
+            span.set_name_shared(name);
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_name_s(span: *mut Span, name: *const c_char) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if let Some(name) = static_str(name) {
+            span.set_name_shared(name);
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_duration(span: *mut Span, duration: u64) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        span.set_duration(Duration::from_millis(duration));
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_duration_us(span: *mut Span, duration: u64) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        span.set_duration(Duration::from_micros(duration));
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_duration_ns(span: *mut Span, duration: u64) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        span.set_duration(Duration::from_nanos(duration));
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_start(span: *mut Span) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        span.start();
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_end(span: *mut Span) -> bool {
+    match unsafe { span.as_mut() } {
+        Some(span) => span.end(),
+        None => false,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_parent_id(span: *mut Span, parent_id: *const c_char) -> bool {
+    span_set_str(span, str_from_c(parent_id), Span::set_parent_id)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_parent_id_n(
+    span: *mut Span,
+    parent_id: *const c_char,
+    len: usize,
+) -> bool {
+    span_set_str(span, str_from_raw(parent_id, len), Span::set_parent_id)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_parent_id_u64(span: *mut Span, parent_id: u64) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if parent_id != 0 {
+            span.set_parent_id_u64(parent_id);
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_service_name(span: *mut Span, service_name: *const c_char) -> bool {
+    span_set_str(span, str_from_c(service_name), Span::set_service_name)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_service_name_n(
+    span: *mut Span,
+    service_name: *const c_char,
+    len: usize,
+) -> bool {
+    span_set_str(
+        span,
+        str_from_raw(service_name, len),
+        Span::set_service_name,
+    )
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_service_name_i(
+    span: *mut Span,
+    service_name: *const Interned,
+) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if let Some(service_name) = interned_str(service_name) {
+            span.set_service_name_shared(service_name);
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_set_service_name_s(
+    span: *mut Span,
+    service_name: *const c_char,
+) -> bool {
+    if let Some(span) = unsafe { span.as_mut() } {
+        if let Some(service_name) = static_str(service_name) {
+            span.set_service_name_shared(service_name);
+            return true;
+        }
     }
     false
 }
@@ -389,15 +1134,18 @@ pub extern "C" fn nrt_span_set_attributes(
     span: *mut Span,
     attributes: *mut *mut Attributes,
 ) -> bool {
-    if let Some(attr) = unsafe { attributes.as_mut() } {
-        if let Some(span) = unsafe { span.as_mut() } {
-            if let Some(attr) = unsafe { attr.as_mut() } {
-                for (key, value) in attr.iter() {
-                    span.set_attribute(key, value.clone());
-                }
-                nrt_attributes_destroy(attributes);
-                return true;
+    if let Some(a) = unsafe { attributes.as_mut() } {
+        if !a.is_null() {
+            let mut attrs = unsafe { Box::from_raw(*a) };
+            unsafe { *attributes = ptr::null_mut() };
+
+            let span = unsafe { span.as_mut() };
+            let added = span.is_some();
+            if let Some(span) = span {
+                span.set_attributes(&mut attrs);
             }
+            attrs.release();
+            return added;
         }
     }
     false
@@ -408,7 +1156,7 @@ pub extern "C" fn nrt_span_destroy(span: *mut *mut Span) {
     if let Some(s) = unsafe { span.as_mut() } {
         if !s.is_null() {
             let s = unsafe { Box::from_raw(*s) };
-            drop(s);
+            s.release();
             unsafe { *span = ptr::null_mut() };
         }
     }
@@ -426,7 +1174,7 @@ pub extern "C" fn nrt_span_batch_record(batch: *mut SpanBatch, span: *mut *mut S
         if let Some(s) = unsafe { span.as_mut() } {
             if !s.is_null() {
                 let s = unsafe { Box::from_raw(*s) };
-                batch.record(*s);
+                batch.record(s);
                 unsafe { *span = ptr::null_mut() };
                 return true;
             }
@@ -435,12 +1183,115 @@ pub extern "C" fn nrt_span_batch_record(batch: *mut SpanBatch, span: *mut *mut S
     false
 }
 
+#[no_mangle]
+pub extern "C" fn nrt_span_batch_set_common_attributes(
+    batch: *mut SpanBatch,
+    attributes: *mut *mut Attributes,
+) -> bool {
+    if let Some(a) = unsafe { attributes.as_mut() } {
+        if !a.is_null() {
+            let mut attrs = unsafe { Box::from_raw(*a) };
+            unsafe { *attributes = ptr::null_mut() };
+
+            let batch = unsafe { batch.as_mut() };
+            let set = batch.is_some();
+            if let Some(batch) = batch {
+                batch.set_common_attributes(&mut attrs);
+            }
+            attrs.release();
+            return set;
+        }
+    }
+    false
+}
+
+fn span_from_desc(span: &mut Span, desc: &SpanDesc) -> bool {
+    let id = match str_from_raw(desc.id, desc.id_len) {
+        Some(id) => id,
+        None => return false,
+    };
+    let trace_id = match str_from_raw(desc.trace_id, desc.trace_id_len) {
+        Some(trace_id) => trace_id,
+        None => return false,
+    };
+    span.set_id(id);
+    span.set_trace_id(trace_id);
+    span.set_timestamp(desc.timestamp);
+
+    if let Some(name) = str_from_raw(desc.name, desc.name_len) {
+        span.set_name(name);
+    }
+    if let Some(service_name) = str_from_raw(desc.service_name, desc.service_name_len) {
+        span.set_service_name(service_name);
+    }
+    if let Some(parent_id) = str_from_raw(desc.parent_id, desc.parent_id_len) {
+        span.set_parent_id(parent_id);
+    }
+    span.set_duration(Duration::from_millis(desc.duration));
+
+    if !desc.attributes.is_null() {
+        let attrs = unsafe { slice::from_raw_parts(desc.attributes, desc.attributes_len) };
+        let span_attrs = span.attributes_mut();
+        for attr in attrs {
+            let key = match str_from_raw(attr.key, attr.key_len) {
+                Some(key) => Str::from(key),
+                None => continue,
+            };
+            let value = unsafe {
+                match attr.value_type {
+                    NRT_ATTRIBUTE_INT => AttributeValue::from(attr.value.int_value),
+                    NRT_ATTRIBUTE_UINT => AttributeValue::from(attr.value.uint_value),
+                    NRT_ATTRIBUTE_DOUBLE => AttributeValue::from(attr.value.double_value),
+                    NRT_ATTRIBUTE_STRING => {
+                        let value = attr.value.string_value;
+                        match str_from_raw(value.ptr, value.len) {
+                            Some(value) => AttributeValue::from(Str::from(value)),
+                            None => continue,
+                        }
+                    }
+                    NRT_ATTRIBUTE_BOOL => AttributeValue::from(attr.value.bool_value),
+                    _ => continue,
+                }
+            };
+            span_attrs.insert(key, value);
+        }
+    }
+
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_batch_record_many(
+    batch: *mut SpanBatch,
+    spans: *const SpanDesc,
+    count: usize,
+) -> usize {
+    if spans.is_null() {
+        return 0;
+    }
+
+    let mut recorded = 0;
+    if let Some(batch) = unsafe { batch.as_mut() } {
+        let descs = unsafe { slice::from_raw_parts(spans, count) };
+        for desc in descs {
+            let mut span = batch.new_span();
+            if span_from_desc(&mut span, desc) {
+                batch.record(span);
+                recorded += 1;
+            } else {
+                span.release();
+            }
+        }
+    }
+    recorded
+}
+
 #[no_mangle]
 pub extern "C" fn nrt_span_batch_destroy(batch: *mut *mut SpanBatch) {
     if let Some(b) = unsafe { batch.as_mut() } {
         if !b.is_null() {
             let b = unsafe { Box::from_raw(*b) };
-            drop(b);
+            b.release();
             unsafe { *batch = ptr::null_mut() };
         }
     }
@@ -450,10 +1301,84 @@ pub extern "C" fn nrt_span_batch_destroy(batch: *mut *mut SpanBatch) {
 pub extern "C" fn nrt_client_new(cfg: *mut *mut ClientConfig) -> *mut Client {
     if !cfg.is_null() {
         if let Some(config) = unsafe { (*cfg).as_ref() } {
-            let result = Into::<ClientBuilder>::into(config).build_blocking();
+            let compression = Compression::new(
+                config
+                    .compression_level
+                    .unwrap_or(DEFAULT_COMPRESSION_LEVEL),
+            );
+            let exporter = match &config.export {
+                Some(export_config) => match Exporter::open(export_config, compression) {
+                    Ok(exporter) => Some(exporter),
+                    Err(err) => {
+                        log::error!(
+                            "unable to open export directory {}: {}",
+                            export_config.dir.display(),
+                            err
+                        );
+                        nrt_client_config_destroy(cfg);
+                        return ptr::null_mut();
+                    }
+                },
+                None => None,
+            };
+            // Exported batches are never sent, so there is nothing to spool.
+            let spool = match (&config.spool, &exporter) {
+                (Some(spool_config), None) => {
+                    let endpoint = (
+                        config
+                            .host
+                            .clone()
+                            .unwrap_or_else(|| DEFAULT_HOST_TRACES.to_string()),
+                        config.port.unwrap_or(DEFAULT_PORT),
+                    );
+                    match Spool::open(spool_config, endpoint, compression) {
+                        Ok(spool) => Some(spool),
+                        Err(err) => {
+                            log::error!(
+                                "unable to open spool {}: {}",
+                                spool_config.dir.display(),
+                                err
+                            );
+                            nrt_client_config_destroy(cfg);
+                            return ptr::null_mut();
+                        }
+                    }
+                }
+                _ => None,
+            };
+            let sender_threads = config.sender_threads.unwrap_or(1);
+            let result: Result<Vec<_>, _> = match &exporter {
+                Some(exporter) => Ok((0..sender_threads)
+                    .map(|_| Destination::Export(exporter.clone()))
+                    .collect()),
+                None => (0..sender_threads)
+                    .map(|_| {
+                        Into::<ClientBuilder>::into(config)
+                            .build_blocking()
+                            .map(Destination::Sdk)
+                    })
+                    .collect(),
+            };
+            let queue_max = config.queue_max.unwrap_or(DEFAULT_QUEUE_MAX);
+            let backpressure = config.backpressure;
+            let payload_max = config.payload_max.unwrap_or(DEFAULT_PAYLOAD_MAX);
+            let pipeline = Pipeline {
+                aggregator: config.aggregation.clone().map(Aggregator::start),
+                sampler: Sampler::new(&config.sampling).map(Arc::new),
+                meter: config.metrics.clone().map(Meter::start),
+            };
             nrt_client_config_destroy(cfg);
             match result {
-                Ok(client) => return Box::into_raw(Box::new(client)),
+                Ok(destinations) => {
+                    return Box::into_raw(Box::new(Client::new(
+                        destinations,
+                        pipeline,
+                        spool,
+                        queue_max,
+                        backpressure,
+                        payload_max,
+                    )))
+                }
                 Err(err) => {
                     log::error!("unable to create client: {}", err.to_string());
                 }
@@ -465,19 +1390,270 @@ pub extern "C" fn nrt_client_new(cfg: *mut *mut ClientConfig) -> *mut Client {
 
 #[no_mangle]
 pub extern "C" fn nrt_client_send(client: *mut Client, batch: *mut *mut SpanBatch) -> bool {
-    if let Some(client) = unsafe { client.as_mut() } {
+    nrt_client_enqueue(client, batch).is_accepted()
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_enqueue(
+    client: *mut Client,
+    batch: *mut *mut SpanBatch,
+) -> SendResult {
+    if let Some(client) = unsafe { client.as_ref() } {
         if let Some(b) = unsafe { batch.as_mut() } {
             if !b.is_null() {
-                let b = unsafe { *Box::from_raw(*b) };
+                let b = unsafe { Box::from_raw(*b) };
                 unsafe { *batch = ptr::null_mut() };
-                client.send_spans(b);
-                return true;
+                return client.send(b);
             }
         }
     }
+    SendResult::Invalid
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_submit(
+    client: *mut Client,
+    batch: *mut *mut SpanBatch,
+    callback: Option<CompletionCallback>,
+    user_data: *mut c_void,
+) -> SendResult {
+    if let Some(client) = unsafe { client.as_ref() } {
+        if let Some(b) = unsafe { batch.as_mut() } {
+            if !b.is_null() {
+                let b = unsafe { Box::from_raw(*b) };
+                unsafe { *batch = ptr::null_mut() };
+                let completion = callback.map(|callback| Completion {
+                    callback,
+                    user_data,
+                });
+                return client.submit(b, completion, false);
+            }
+        }
+    }
+    SendResult::Invalid
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_completion_fd(client: *mut Client) -> i32 {
+    match unsafe { client.as_ref() } {
+        Some(client) => client.completion_fd(),
+        None => -1,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_process_completions(client: *mut Client) -> usize {
+    match unsafe { client.as_ref() } {
+        Some(client) => client.process_completions(),
+        None => 0,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_sample_trace(client: *mut Client, trace_id: *const c_char) -> bool {
+    let client = match unsafe { client.as_ref() } {
+        Some(client) => client,
+        None => return false,
+    };
+    let trace_id = match str_from_c(trace_id) {
+        Some(trace_id) => trace_id,
+        None => return false,
+    };
+    match client.sampler() {
+        Some(sampler) => {
+            let mut id = Id::default();
+            id.set_str(trace_id);
+            sampler.sample_trace(id.key())
+        }
+        None => true,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_sample_trace_u128(client: *mut Client, _high: u64, low: u64) -> bool {
+    match unsafe { client.as_ref() } {
+        Some(client) => match client.sampler() {
+            Some(sampler) => sampler.sample_trace(low),
+            None => true,
+        },
+        None => false,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_get_sampling_stats(
+    client: *mut Client,
+    stats: *mut SamplingStats,
+) -> bool {
+    if let (Some(client), Some(stats)) = unsafe { (client.as_ref(), stats.as_mut()) } {
+        *stats = match client.sampler() {
+            Some(sampler) => sampler.stats(),
+            None => SamplingStats::default(),
+        };
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_get_spool_stats(client: *mut Client, stats: *mut SpoolStats) -> bool {
+    if let (Some(client), Some(stats)) = unsafe { (client.as_ref(), stats.as_mut()) } {
+        *stats = match client.spool() {
+            Some(spool) => spool.stats(),
+            None => SpoolStats::default(),
+        };
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_replay_open(path: *const c_char) -> *mut Replay {
+    if let Some(path) = str_from_c(path) {
+        match Replay::open(path.as_ref()) {
+            Ok(replay) => return Box::into_raw(Box::new(replay)),
+            Err(err) => log::error!("unable to open replay {}: {}", path, err),
+        }
+    }
+    ptr::null_mut()
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_replay_next(replay: *mut Replay) -> *mut SpanBatch {
+    if let Some(replay) = unsafe { replay.as_mut() } {
+        if let Some(batch) = replay.next_batch() {
+            return Box::into_raw(Box::new(batch));
+        }
+    }
+    ptr::null_mut()
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_replay_get_stats(replay: *mut Replay, stats: *mut ReplayStats) -> bool {
+    if let (Some(replay), Some(stats)) = unsafe { (replay.as_ref(), stats.as_mut()) } {
+        *stats = replay.stats();
+        return true;
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_replay_destroy(replay: *mut *mut Replay) {
+    if let Some(r) = unsafe { replay.as_mut() } {
+        if !r.is_null() {
+            drop(unsafe { Box::from_raw(*r) });
+            unsafe { *replay = ptr::null_mut() };
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_get_stats(client: *mut Client, stats: *mut ClientStats) -> bool {
+    if let (Some(client), Some(stats)) = unsafe { (client.as_ref(), stats.as_mut()) } {
+        *stats = client.stats();
+        return true;
+    }
     false
 }
 
+#[no_mangle]
+pub extern "C" fn nrt_client_harvest_aggregates(client: *mut Client) -> bool {
+    match unsafe { client.as_ref() }.and_then(Client::aggregator) {
+        Some(aggregator) => {
+            aggregator.harvest();
+            true
+        }
+        None => false,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_harvest_metrics(client: *mut Client) -> bool {
+    match unsafe { client.as_ref() }.and_then(Client::meter) {
+        Some(meter) => {
+            meter.harvest();
+            true
+        }
+        None => false,
+    }
+}
+
+fn nrt_instrument_new(
+    client: *mut Client,
+    name: *const c_char,
+    kind: MetricKind,
+) -> *const Instrument {
+    let meter = unsafe { client.as_ref() }.and_then(Client::meter);
+    match (meter, str_from_c(name)) {
+        (Some(meter), Some(name)) => match meter.instrument(name, kind) {
+            Some(instrument) => Arc::into_raw(instrument),
+            None => ptr::null(),
+        },
+        _ => ptr::null(),
+    }
+}
+
+fn nrt_instrument_destroy(instrument: *mut *const Instrument) {
+    if !instrument.is_null() {
+        let i = unsafe { *instrument };
+        if !i.is_null() {
+            drop(unsafe { Arc::from_raw(i) });
+            unsafe { *instrument = ptr::null() };
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_counter_new(client: *mut Client, name: *const c_char) -> *const Instrument {
+    nrt_instrument_new(client, name, MetricKind::Count)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_counter_add(counter: *const Instrument, value: u64) {
+    if let Some(counter) = unsafe { counter.as_ref() } {
+        counter.add(value);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_counter_destroy(counter: *mut *const Instrument) {
+    nrt_instrument_destroy(counter);
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_gauge_new(client: *mut Client, name: *const c_char) -> *const Instrument {
+    nrt_instrument_new(client, name, MetricKind::Gauge)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_gauge_set(gauge: *const Instrument, value: f64) {
+    if let Some(gauge) = unsafe { gauge.as_ref() } {
+        gauge.set(value);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_gauge_destroy(gauge: *mut *const Instrument) {
+    nrt_instrument_destroy(gauge);
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_summary_new(client: *mut Client, name: *const c_char) -> *const Instrument {
+    nrt_instrument_new(client, name, MetricKind::Summary)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_summary_record(summary: *const Instrument, value: f64) {
+    if let Some(summary) = unsafe { summary.as_ref() } {
+        summary.record(value);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_summary_destroy(summary: *mut *const Instrument) {
+    nrt_instrument_destroy(summary);
+}
+
 #[no_mangle]
 pub extern "C" fn nrt_client_shutdown(client: *mut *mut Client) {
     if !client.is_null() {
@@ -486,8 +1662,50 @@ pub extern "C" fn nrt_client_shutdown(client: *mut *mut Client) {
             let c = unsafe { Box::from_raw(c) };
             c.shutdown();
             unsafe { *client = ptr::null_mut() };
+            // Errors of the shutdown would be lost if the process exits next.
+            logger::flush();
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_flush(
+    client: *mut Client,
+    timeout_ms: u64,
+    result: *mut FlushResult,
+) -> bool {
+    match unsafe { client.as_ref() } {
+        Some(client) => {
+            let flushed = client.flush(Duration::from_millis(timeout_ms));
+            if let Some(result) = unsafe { result.as_mut() } {
+                *result = flushed;
+            }
+            !flushed.timed_out
+        }
+        None => false,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_client_shutdown_timeout(
+    client: *mut *mut Client,
+    timeout_ms: u64,
+    result: *mut FlushResult,
+) -> bool {
+    if !client.is_null() {
+        let c = unsafe { *client };
+        if !c.is_null() {
+            let c = unsafe { Box::from_raw(c) };
+            let finished = c.shutdown_timeout(Duration::from_millis(timeout_ms));
+            unsafe { *client = ptr::null_mut() };
+            logger::flush();
+            if let Some(result) = unsafe { result.as_mut() } {
+                *result = finished;
+            }
+            return !finished.timed_out;
         }
     }
+    false
 }
 
 #[no_mangle]
@@ -498,6 +1716,7 @@ pub extern "C" fn nrt_client_destroy(client: *mut *mut Client) {
             let c = unsafe { Box::from_raw(c) };
             drop(c);
             unsafe { *client = ptr::null_mut() };
+            logger::flush();
         }
     }
 }
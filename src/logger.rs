@@ -0,0 +1,356 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::clock;
+use crate::lock;
+use crate::queue::BoundedQueue;
+use lazy_static::lazy_static;
+use log::{Level, LevelFilter, Log, Metadata, Record};
+use std::fs::{self, File};
+use std::io::{self, BufWriter, Write};
+use std::path::PathBuf;
+use std::sync::atomic::{self, AtomicBool, AtomicU64, Ordering};
+use std::sync::{Mutex, Once};
+use std::thread::{self, Thread};
+use std::time::Duration;
+
+/// Messages that can wait for the writer thread. Further messages are
+/// dropped.
+const QUEUE_MAX: usize = 4096;
+
+/// Call sites are rate limited in this many slots. Call sites hashing to the
+/// same slot share a limit.
+const CALLSITES: usize = 256;
+const CALLSITE_BITS: u32 = 8;
+
+/// Messages per call site and second. Further messages are dropped.
+const CALLSITE_RATE_MAX: u64 = 20;
+
+/// How long the writer thread sleeps at most, so messages are written even
+/// if it isn't woken.
+const WRITER_PARK_MAX: Duration = Duration::from_millis(200);
+
+/// Counters of the logger, as they are passed to C.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct LogStats {
+    messages_written: u64,
+    messages_dropped: u64,
+    messages_rate_limited: u64,
+    files_rotated: u64,
+}
+
+/// Where log messages are written to.
+pub enum Sink {
+    Stdout,
+    Stderr,
+    File(RotatingFile),
+}
+
+impl Sink {
+    fn write_line(&mut self, line: &[u8]) -> io::Result<bool> {
+        match self {
+            Sink::Stdout => io::stdout().write_all(line).map(|_| false),
+            Sink::Stderr => io::stderr().write_all(line).map(|_| false),
+            Sink::File(file) => file.write_line(line),
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        match self {
+            Sink::Stdout => io::stdout().flush(),
+            Sink::Stderr => io::stderr().flush(),
+            Sink::File(file) => file.writer.flush(),
+        }
+    }
+}
+
+/// A log file that is rotated once it grows beyond a size.
+///
+/// On rotation, `name` is renamed to `name.1`, `name.1` to `name.2` and so
+/// on, keeping at most `files_max` rotated files, and a new `name` is
+/// started.
+pub struct RotatingFile {
+    path: PathBuf,
+    writer: BufWriter<File>,
+    size: u64,
+    /// Never rotate if zero.
+    size_max: u64,
+    files_max: u32,
+}
+
+impl RotatingFile {
+    pub fn create(path: PathBuf, size_max: u64, files_max: u32) -> io::Result<Self> {
+        let file = File::create(&path)?;
+        Ok(RotatingFile {
+            path,
+            writer: BufWriter::new(file),
+            size: 0,
+            size_max,
+            files_max,
+        })
+    }
+
+    fn rotated(&self, n: u32) -> PathBuf {
+        let mut name = self.path.clone().into_os_string();
+        name.push(format!(".{}", n));
+        name.into()
+    }
+
+    /// Writes a line, and returns whether the file was rotated afterwards.
+    fn write_line(&mut self, line: &[u8]) -> io::Result<bool> {
+        self.writer.write_all(line)?;
+        self.size += line.len() as u64;
+        if self.size_max == 0 || self.size < self.size_max {
+            return Ok(false);
+        }
+
+        self.writer.flush()?;
+        if self.files_max > 0 {
+            for n in (1..self.files_max).rev() {
+                let _ = fs::rename(self.rotated(n), self.rotated(n + 1));
+            }
+            fs::rename(&self.path, self.rotated(1))?;
+        }
+        self.writer = BufWriter::new(File::create(&self.path)?);
+        self.size = 0;
+        Ok(true)
+    }
+}
+
+struct Message {
+    time_ns: u64,
+    level: Level,
+    text: String,
+}
+
+/// When a call site last logged, and how often in that second.
+#[derive(Default)]
+struct Callsite {
+    second: AtomicU64,
+    count: AtomicU64,
+}
+
+/// A logger that never writes on the logging thread.
+///
+/// Messages are formatted by the logging thread and put into a bounded
+/// lock-free queue, from which a writer thread writes them to the sink.
+/// Messages are dropped if the queue is full or their call site logged too
+/// often within the current second, so logging never blocks and a noisy
+/// call site can't crowd out the others.
+///
+/// The level is the global maximum level of the `log` crate, which can be
+/// changed at any time.
+struct AsyncLogger {
+    queue: BoundedQueue<Message>,
+    callsites: Vec<Callsite>,
+    sink: Mutex<Option<Sink>>,
+    writer: Mutex<Option<Thread>>,
+    /// Set while the writer thread is about to park or parked.
+    sleeping: AtomicBool,
+    written: AtomicU64,
+    dropped: AtomicU64,
+    rate_limited: AtomicU64,
+    rotated: AtomicU64,
+}
+
+lazy_static! {
+    static ref LOGGER: AsyncLogger = AsyncLogger {
+        queue: BoundedQueue::new(QUEUE_MAX),
+        callsites: (0..CALLSITES).map(|_| Callsite::default()).collect(),
+        sink: Mutex::new(None),
+        writer: Mutex::new(None),
+        sleeping: AtomicBool::new(false),
+        written: AtomicU64::new(0),
+        dropped: AtomicU64::new(0),
+        rate_limited: AtomicU64::new(0),
+        rotated: AtomicU64::new(0),
+    };
+}
+
+impl AsyncLogger {
+    /// Counts a message against the limit of its call site, identified by
+    /// its source location.
+    fn allow(&self, record: &Record) -> bool {
+        let file = record.file().unwrap_or_else(|| record.target());
+        let key = (file.as_ptr() as u64 ^ record.line().unwrap_or(0) as u64)
+            .wrapping_mul(0x9e37_79b9_7f4a_7c15);
+        let callsite = &self.callsites[(key >> (64 - CALLSITE_BITS)) as usize];
+        let second = clock::now() / 1_000_000_000;
+        // Racing threads may both reset the count, which only lets a few
+        // more messages through.
+        if callsite.second.load(Ordering::Relaxed) != second {
+            callsite.second.store(second, Ordering::Relaxed);
+            callsite.count.store(0, Ordering::Relaxed);
+        }
+        callsite.count.fetch_add(1, Ordering::Relaxed) < CALLSITE_RATE_MAX
+    }
+
+    fn wake_writer(&self) {
+        // Pairs with the fence in `write_loop`.
+        atomic::fence(Ordering::SeqCst);
+        if self.sleeping.load(Ordering::Relaxed) {
+            if let Some(writer) = &*lock(&self.writer) {
+                writer.unpark();
+            }
+        }
+    }
+
+    /// Writes all queued messages to the sink and flushes it.
+    fn drain(&self) {
+        let mut sink = lock(&self.sink);
+        let mut line = Vec::new();
+        while let Some(message) = self.queue.pop() {
+            let sink = match &mut *sink {
+                Some(sink) => sink,
+                None => continue,
+            };
+            line.clear();
+            let _ = writeln!(
+                line,
+                "{} [{}] {}",
+                format_time(clock::to_epoch_ms(message.time_ns)),
+                message.level,
+                message.text
+            );
+            match sink.write_line(&line) {
+                Ok(rotated) => {
+                    self.written.fetch_add(1, Ordering::Relaxed);
+                    if rotated {
+                        self.rotated.fetch_add(1, Ordering::Relaxed);
+                    }
+                }
+                Err(_) => {
+                    self.dropped.fetch_add(1, Ordering::Relaxed);
+                }
+            }
+        }
+        if let Some(sink) = &mut *sink {
+            let _ = sink.flush();
+        }
+    }
+
+    fn write_loop(&self) {
+        loop {
+            self.drain();
+            self.sleeping.store(true, Ordering::Relaxed);
+            atomic::fence(Ordering::SeqCst);
+            if self.queue.is_empty() {
+                thread::park_timeout(WRITER_PARK_MAX);
+            }
+            self.sleeping.store(false, Ordering::Relaxed);
+        }
+    }
+}
+
+impl Log for AsyncLogger {
+    fn enabled(&self, metadata: &Metadata) -> bool {
+        metadata.level() <= log::max_level()
+    }
+
+    fn log(&self, record: &Record) {
+        if !self.enabled(record.metadata()) {
+            return;
+        }
+        if !self.allow(record) {
+            self.rate_limited.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+        let message = Message {
+            time_ns: clock::now(),
+            level: record.level(),
+            text: format!("{}: {}", record.target(), record.args()),
+        };
+        match self.queue.push(message) {
+            Ok(()) => self.wake_writer(),
+            Err(_) => {
+                self.dropped.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+    }
+
+    fn flush(&self) {
+        self.drain();
+    }
+}
+
+/// Installs the logger and starts its writer thread on first use, and
+/// switches to the given level and sink. Messages queued before are written
+/// to the previous sink. Returns false if another logger is installed.
+pub fn init(level: LevelFilter, sink: Sink) -> bool {
+    static INSTALL: Once = Once::new();
+
+    INSTALL.call_once(|| {
+        if log::set_logger(&*LOGGER).is_err() {
+            return;
+        }
+        match thread::Builder::new()
+            .name("nrt-log".into())
+            .spawn(|| LOGGER.write_loop())
+        {
+            Ok(writer) => *lock(&LOGGER.writer) = Some(writer.thread().clone()),
+            Err(err) => eprintln!("unable to start log writer thread: {}", err),
+        }
+    });
+    if lock(&LOGGER.writer).is_none() {
+        return false;
+    }
+
+    LOGGER.drain();
+    *lock(&LOGGER.sink) = Some(sink);
+    log::set_max_level(level);
+    true
+}
+
+/// Changes the level without touching the sink.
+pub fn set_level(level: LevelFilter) {
+    log::set_max_level(level);
+}
+
+/// Writes all queued messages on the calling thread.
+pub fn flush() {
+    LOGGER.drain();
+}
+
+pub fn stats() -> LogStats {
+    LogStats {
+        messages_written: LOGGER.written.load(Ordering::Relaxed),
+        messages_dropped: LOGGER.dropped.load(Ordering::Relaxed),
+        messages_rate_limited: LOGGER.rate_limited.load(Ordering::Relaxed),
+        files_rotated: LOGGER.rotated.load(Ordering::Relaxed),
+    }
+}
+
+/// Formats milliseconds since the Unix epoch as an RFC 3339 UTC timestamp.
+fn format_time(epoch_ms: u64) -> String {
+    let secs = epoch_ms / 1000;
+    let (year, month, day) = civil_from_days((secs / 86400) as i64);
+    let time = secs % 86400;
+    format!(
+        "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.{:03}Z",
+        year,
+        month,
+        day,
+        time / 3600,
+        time / 60 % 60,
+        time % 60,
+        epoch_ms % 1000
+    )
+}
+
+/// Converts days since the Unix epoch into a proleptic Gregorian date, as
+/// described by Howard Hinnant in "chrono-Compatible Low-Level Date
+/// Algorithms".
+fn civil_from_days(days: i64) -> (i64, u32, u32) {
+    let z = days + 719_468;
+    let era = if z >= 0 { z } else { z - 146_096 } / 146_097;
+    let doe = z - era * 146_097;
+    let yoe = (doe - doe / 1460 + doe / 36524 - doe / 146_096) / 365;
+    let doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    let mp = (5 * doy + 2) / 153;
+    let day = (doy - (153 * mp + 2) / 5 + 1) as u32;
+    let month = if mp < 10 { mp + 3 } else { mp - 9 } as u32;
+    let year = yoe + era * 400 + if month <= 2 { 1 } else { 0 };
+    (year, month, day)
+}
@@ -0,0 +1,307 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::harvester::{Harvest, HarvestConfig, Harvester};
+use crate::lock;
+use std::ffi::c_void;
+use std::mem;
+use std::os::raw::c_char;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+
+/// Instruments that can be created at most.
+const INSTRUMENTS_MAX: usize = 10_000;
+
+/// Updates are spread over this many stripes per instrument. This is more
+/// than the shards of pools and aggregates, since instruments are few and
+/// updated from all threads at once.
+const STRIPES: usize = 64;
+
+static NEXT_STRIPE: AtomicUsize = AtomicUsize::new(0);
+
+thread_local! {
+    static STRIPE: usize = NEXT_STRIPE.fetch_add(1, Ordering::Relaxed) % STRIPES;
+}
+
+fn thread_stripe() -> usize {
+    STRIPE.with(|stripe| *stripe)
+}
+
+/// The kind of an instrument, and of the metrics harvested from it.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum MetricKind {
+    Count = 0,
+    Gauge = 1,
+    Summary = 2,
+}
+
+/// The values recorded by the threads of one stripe, on their own cache
+/// line. Counters only use `count`. Sum, minimum and maximum of summaries are
+/// the bits of doubles.
+#[repr(align(64))]
+struct Stripe {
+    count: AtomicU64,
+    sum: AtomicU64,
+    min: AtomicU64,
+    max: AtomicU64,
+}
+
+impl Default for Stripe {
+    fn default() -> Self {
+        Stripe {
+            count: AtomicU64::new(0),
+            sum: AtomicU64::new(0f64.to_bits()),
+            min: AtomicU64::new(f64::INFINITY.to_bits()),
+            max: AtomicU64::new(f64::NEG_INFINITY.to_bits()),
+        }
+    }
+}
+
+/// Applies `f` to a double stored as bits, unless it leaves it unchanged.
+#[inline]
+fn update_f64<F: Fn(f64) -> f64>(cell: &AtomicU64, f: F) {
+    let mut current = cell.load(Ordering::Relaxed);
+    loop {
+        let new = f(f64::from_bits(current)).to_bits();
+        if new == current {
+            return;
+        }
+        match cell.compare_exchange_weak(current, new, Ordering::Relaxed, Ordering::Relaxed) {
+            Ok(_) => return,
+            Err(actual) => current = actual,
+        }
+    }
+}
+
+/// A counter, gauge or summary, updated from any thread without locks or
+/// allocations.
+pub struct Instrument {
+    name: String,
+    kind: MetricKind,
+    stripes: Vec<Stripe>,
+    /// The bits of the last value of a gauge.
+    gauge: AtomicU64,
+    gauge_set: AtomicBool,
+}
+
+impl Instrument {
+    fn new(name: &str, kind: MetricKind) -> Self {
+        let stripes = match kind {
+            MetricKind::Gauge => 0,
+            MetricKind::Count | MetricKind::Summary => STRIPES,
+        };
+        let mut instrument = Instrument {
+            name: name.to_string(),
+            kind,
+            stripes: Vec::with_capacity(stripes),
+            gauge: AtomicU64::new(0),
+            gauge_set: AtomicBool::new(false),
+        };
+        instrument.stripes.resize_with(stripes, Stripe::default);
+        instrument
+    }
+
+    /// Adds to a counter. Gauges have no stripes, so updating an instrument
+    /// of the wrong kind does nothing.
+    #[inline]
+    pub fn add(&self, value: u64) {
+        if let Some(stripe) = self.stripes.get(thread_stripe()) {
+            stripe.count.fetch_add(value, Ordering::Relaxed);
+        }
+    }
+
+    #[inline]
+    pub fn set(&self, value: f64) {
+        self.gauge.store(value.to_bits(), Ordering::Relaxed);
+        if !self.gauge_set.load(Ordering::Relaxed) {
+            self.gauge_set.store(true, Ordering::Relaxed);
+        }
+    }
+
+    #[inline]
+    pub fn record(&self, value: f64) {
+        if let Some(stripe) = self.stripes.get(thread_stripe()) {
+            stripe.count.fetch_add(1, Ordering::Relaxed);
+            update_f64(&stripe.sum, |sum| sum + value);
+            update_f64(&stripe.min, |min| min.min(value));
+            update_f64(&stripe.max, |max| max.max(value));
+        }
+    }
+
+    /// Returns and resets the values recorded since the last harvest, or
+    /// `None` if there are none. Gauges keep their last value. Stripes are
+    /// reset one by one, so an update made concurrently may be split across
+    /// two harvests.
+    fn harvest(&self, start: u64, end: u64) -> Option<MetricDesc> {
+        let mut desc = MetricDesc {
+            name: self.name.as_ptr() as *const c_char,
+            name_len: self.name.len(),
+            kind: self.kind,
+            start,
+            end,
+            value: 0.0,
+            count: 0,
+            sum: 0.0,
+            min: 0.0,
+            max: 0.0,
+        };
+        match self.kind {
+            MetricKind::Count => {
+                let count: u64 = self
+                    .stripes
+                    .iter()
+                    .map(|s| s.count.swap(0, Ordering::Relaxed))
+                    .sum();
+                if count == 0 {
+                    return None;
+                }
+                desc.value = count as f64;
+            }
+            MetricKind::Gauge => {
+                if !self.gauge_set.load(Ordering::Relaxed) {
+                    return None;
+                }
+                desc.value = f64::from_bits(self.gauge.load(Ordering::Relaxed));
+            }
+            MetricKind::Summary => {
+                let mut min = f64::INFINITY;
+                let mut max = f64::NEG_INFINITY;
+                for stripe in self.stripes.iter() {
+                    desc.count += stripe.count.swap(0, Ordering::Relaxed);
+                    desc.sum += f64::from_bits(stripe.sum.swap(0, Ordering::Relaxed));
+                    let reset = f64::INFINITY.to_bits();
+                    min = min.min(f64::from_bits(stripe.min.swap(reset, Ordering::Relaxed)));
+                    let reset = f64::NEG_INFINITY.to_bits();
+                    max = max.max(f64::from_bits(stripe.max.swap(reset, Ordering::Relaxed)));
+                }
+                if desc.count == 0 {
+                    return None;
+                }
+                desc.min = min;
+                desc.max = max;
+            }
+        }
+        Some(desc)
+    }
+}
+
+/// A metric over one interval, as it is passed to the C callback.
+#[repr(C)]
+pub struct MetricDesc {
+    name: *const c_char,
+    name_len: usize,
+    kind: MetricKind,
+    start: u64,
+    end: u64,
+    value: f64,
+    count: u64,
+    sum: f64,
+    min: f64,
+    max: f64,
+}
+
+pub type MetricCallback = extern "C" fn(*const MetricDesc, usize, *mut c_void);
+
+/// The metrics settings of a client configuration.
+pub type MetricsConfig = HarvestConfig<MetricCallback>;
+
+/// Keeps the instruments of a client, and passes their values to a callback
+/// on an interval.
+///
+/// Instruments are shared with the application, which updates them directly.
+/// The meter only looks at them when they are created and harvested.
+pub struct Meter {
+    config: MetricsConfig,
+    instruments: Mutex<Vec<Arc<Instrument>>>,
+    harvester: Harvester,
+}
+
+impl Meter {
+    /// Creates a meter and starts its harvest thread.
+    pub fn start(config: MetricsConfig) -> Arc<Meter> {
+        let meter = Arc::new(Meter {
+            config,
+            instruments: Mutex::new(Vec::new()),
+            harvester: Harvester::new("metrics"),
+        });
+        Harvester::start(&meter, meter.config.interval);
+        meter
+    }
+
+    /// Returns the instrument of the given name, creating it if needed.
+    /// Returns `None` if an instrument of another kind has that name, or too
+    /// many instruments were created.
+    pub fn instrument(&self, name: &str, kind: MetricKind) -> Option<Arc<Instrument>> {
+        let mut instruments = lock(&self.instruments);
+        if let Some(instrument) = instruments.iter().find(|i| i.name == name) {
+            return match instrument.kind {
+                k if k == kind => Some(instrument.clone()),
+                _ => None,
+            };
+        }
+        if instruments.len() >= INSTRUMENTS_MAX {
+            return None;
+        }
+        let instrument = Arc::new(Instrument::new(name, kind));
+        instruments.push(instrument.clone());
+        Some(instrument)
+    }
+
+    /// Passes the metrics of the current interval to the callback and starts
+    /// a new interval. Instruments no longer referenced by the application
+    /// are harvested one last time and then forgotten.
+    pub fn harvest(&self) {
+        self.harvester.harvest(self);
+    }
+
+    /// Stops the harvest thread, optionally harvesting one last time.
+    pub fn stop(&self, harvest: bool) {
+        self.harvester.stop(self, harvest);
+    }
+}
+
+/// The metrics of an interval, along with the instruments their
+/// descriptions point into.
+pub struct MetricSnapshot {
+    descs: Vec<MetricDesc>,
+    _instruments: Vec<Arc<Instrument>>,
+}
+
+impl Harvest for Meter {
+    type Snapshot = MetricSnapshot;
+
+    fn harvester(&self) -> &Harvester {
+        &self.harvester
+    }
+
+    fn collect(&self, start: u64, end: u64) -> MetricSnapshot {
+        let instruments = {
+            let mut instruments = lock(&self.instruments);
+            let current = mem::replace(&mut *instruments, Vec::new());
+            // Only `current` references instruments the application destroyed.
+            *instruments = current
+                .iter()
+                .filter(|i| Arc::strong_count(i) > 1)
+                .cloned()
+                .collect();
+            current
+        };
+        let descs: Vec<MetricDesc> = instruments
+            .iter()
+            .filter_map(|i| i.harvest(start, end))
+            .collect();
+        MetricSnapshot {
+            descs,
+            _instruments: instruments,
+        }
+    }
+
+    fn report(&self, snapshot: MetricSnapshot) {
+        let descs = &snapshot.descs;
+        if !descs.is_empty() {
+            (self.config.callback)(descs.as_ptr(), descs.len(), self.config.user_data);
+        }
+    }
+}
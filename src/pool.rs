@@ -0,0 +1,310 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::attributes::Attributes;
+use crate::span::{Span, SpanBatch};
+use crate::{str_from_c, str_from_raw};
+use std::os::raw::c_char;
+use std::ptr;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, PoisonError};
+
+pub(crate) const SHARDS: usize = 16;
+
+static NEXT_SHARD: AtomicUsize = AtomicUsize::new(0);
+
+thread_local! {
+    static SHARD: usize = NEXT_SHARD.fetch_add(1, Ordering::Relaxed) % SHARDS;
+}
+
+/// Returns the shard of the calling thread. Threads are spread evenly over
+/// `SHARDS` shards.
+pub(crate) fn thread_shard() -> usize {
+    SHARD.with(|shard| *shard)
+}
+
+#[repr(C)]
+#[derive(Default)]
+pub struct PoolObjectStats {
+    allocated: u64,
+    reused: u64,
+    recycled: u64,
+    discarded: u64,
+    pooled: u64,
+}
+
+#[repr(C)]
+#[derive(Default)]
+pub struct PoolStats {
+    spans: PoolObjectStats,
+    attributes: PoolObjectStats,
+    batches: PoolObjectStats,
+}
+
+/// A free list of recycled objects.
+///
+/// Each thread returns objects to and takes objects from its own shard, so
+/// threads don't contend on a single lock. A thread whose shard is empty tries
+/// to take objects from other shards before allocating.
+struct FreeList<T> {
+    shards: Vec<Mutex<Vec<Box<T>>>>,
+    max: usize,
+    pooled: AtomicUsize,
+    allocated: AtomicU64,
+    reused: AtomicU64,
+    recycled: AtomicU64,
+    discarded: AtomicU64,
+}
+
+impl<T: Default> FreeList<T> {
+    fn new(max: usize) -> Self {
+        let mut shards = Vec::with_capacity(SHARDS);
+        for _ in 0..SHARDS {
+            shards.push(Mutex::new(Vec::new()));
+        }
+        FreeList {
+            shards,
+            max,
+            pooled: AtomicUsize::new(0),
+            allocated: AtomicU64::new(0),
+            reused: AtomicU64::new(0),
+            recycled: AtomicU64::new(0),
+            discarded: AtomicU64::new(0),
+        }
+    }
+
+    fn take(&self) -> Box<T> {
+        if self.pooled.load(Ordering::Relaxed) > 0 {
+            let home = thread_shard();
+            let mut item = self.shards[home]
+                .lock()
+                .unwrap_or_else(PoisonError::into_inner)
+                .pop();
+
+            for i in 1..SHARDS {
+                if item.is_some() {
+                    break;
+                }
+                if let Ok(mut shard) = self.shards[(home + i) % SHARDS].try_lock() {
+                    item = shard.pop();
+                }
+            }
+
+            if let Some(item) = item {
+                self.pooled.fetch_sub(1, Ordering::Relaxed);
+                self.reused.fetch_add(1, Ordering::Relaxed);
+                return item;
+            }
+        }
+
+        self.allocated.fetch_add(1, Ordering::Relaxed);
+        Box::new(T::default())
+    }
+
+    fn put(&self, item: Box<T>) {
+        if self.pooled.fetch_add(1, Ordering::Relaxed) >= self.max {
+            self.pooled.fetch_sub(1, Ordering::Relaxed);
+            self.discarded.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+
+        self.recycled.fetch_add(1, Ordering::Relaxed);
+        let home = thread_shard();
+        self.shards[home]
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .push(item);
+    }
+
+    fn stats(&self) -> PoolObjectStats {
+        PoolObjectStats {
+            allocated: self.allocated.load(Ordering::Relaxed),
+            reused: self.reused.load(Ordering::Relaxed),
+            recycled: self.recycled.load(Ordering::Relaxed),
+            discarded: self.discarded.load(Ordering::Relaxed),
+            pooled: self.pooled.load(Ordering::Relaxed) as u64,
+        }
+    }
+}
+
+/// A pool of spans, attribute collections and span batches.
+///
+/// Objects taken from a pool keep a reference to it and are returned to it
+/// instead of being freed, with their buffers cleared but still allocated.
+/// Idle objects don't reference the pool, so dropping the last handle to the
+/// pool frees them.
+pub struct Pool {
+    spans: FreeList<Span>,
+    attributes: FreeList<Attributes>,
+    batches: FreeList<SpanBatch>,
+}
+
+impl Pool {
+    pub fn new(spans_max: usize, attributes_max: usize, batches_max: usize) -> Self {
+        Pool {
+            spans: FreeList::new(spans_max),
+            attributes: FreeList::new(attributes_max),
+            batches: FreeList::new(batches_max),
+        }
+    }
+
+    pub fn take_span(pool: &Arc<Pool>) -> Box<Span> {
+        let mut span = pool.spans.take();
+        span.pool = Some(pool.clone());
+        span
+    }
+
+    pub fn take_attributes(pool: &Arc<Pool>) -> Box<Attributes> {
+        let mut attributes = pool.attributes.take();
+        attributes.pool = Some(pool.clone());
+        attributes
+    }
+
+    pub fn take_batch(pool: &Arc<Pool>) -> Box<SpanBatch> {
+        let mut batch = pool.batches.take();
+        batch.pool = Some(pool.clone());
+        batch
+    }
+
+    pub fn put_span(&self, mut span: Box<Span>) {
+        span.reset();
+        self.spans.put(span);
+    }
+
+    pub fn put_attributes(&self, mut attributes: Box<Attributes>) {
+        attributes.clear();
+        self.attributes.put(attributes);
+    }
+
+    pub fn put_batch(&self, mut batch: Box<SpanBatch>) {
+        batch.reset();
+        self.batches.put(batch);
+    }
+
+    pub fn stats(&self) -> PoolStats {
+        PoolStats {
+            spans: self.spans.stats(),
+            attributes: self.attributes.stats(),
+            batches: self.batches.stats(),
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_new(
+    spans_max: usize,
+    attributes_max: usize,
+    batches_max: usize,
+) -> *mut Arc<Pool> {
+    let pool = Pool::new(spans_max, attributes_max, batches_max);
+    Box::into_raw(Box::new(Arc::new(pool)))
+}
+
+fn span_new(
+    pool: *mut Arc<Pool>,
+    id: Option<&str>,
+    trace_id: Option<&str>,
+    timestamp: u64,
+) -> *mut Span {
+    if let Some(pool) = unsafe { pool.as_ref() } {
+        if let (Some(id), Some(trace_id)) = (id, trace_id) {
+            let mut span = Pool::take_span(pool);
+            span.set_id(id);
+            span.set_trace_id(trace_id);
+            span.set_timestamp(timestamp);
+            return Box::into_raw(span);
+        }
+    }
+
+    ptr::null_mut()
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_span_new(
+    pool: *mut Arc<Pool>,
+    id: *const c_char,
+    trace_id: *const c_char,
+    timestamp: u64,
+) -> *mut Span {
+    span_new(pool, str_from_c(id), str_from_c(trace_id), timestamp)
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_span_new_n(
+    pool: *mut Arc<Pool>,
+    id: *const c_char,
+    id_len: usize,
+    trace_id: *const c_char,
+    trace_id_len: usize,
+    timestamp: u64,
+) -> *mut Span {
+    span_new(
+        pool,
+        str_from_raw(id, id_len),
+        str_from_raw(trace_id, trace_id_len),
+        timestamp,
+    )
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_span_new_u64(
+    pool: *mut Arc<Pool>,
+    id: u64,
+    trace_id_high: u64,
+    trace_id_low: u64,
+    timestamp: u64,
+) -> *mut Span {
+    if id == 0 || (trace_id_high == 0 && trace_id_low == 0) {
+        return ptr::null_mut();
+    }
+    match unsafe { pool.as_ref() } {
+        Some(pool) => {
+            let mut span = Pool::take_span(pool);
+            span.set_id_u64(id);
+            span.set_trace_id_u128(trace_id_high, trace_id_low);
+            span.set_timestamp(timestamp);
+            Box::into_raw(span)
+        }
+        None => ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_attributes_new(pool: *mut Arc<Pool>) -> *mut Attributes {
+    match unsafe { pool.as_ref() } {
+        Some(pool) => Box::into_raw(Pool::take_attributes(pool)),
+        None => ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_batch_new(pool: *mut Arc<Pool>) -> *mut SpanBatch {
+    match unsafe { pool.as_ref() } {
+        Some(pool) => Box::into_raw(Pool::take_batch(pool)),
+        None => ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_get_stats(pool: *mut Arc<Pool>, stats: *mut PoolStats) -> bool {
+    if let Some(pool) = unsafe { pool.as_ref() } {
+        if let Some(stats) = unsafe { stats.as_mut() } {
+            *stats = pool.stats();
+            return true;
+        }
+    }
+    false
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_span_pool_destroy(pool: *mut *mut Arc<Pool>) {
+    if !pool.is_null() {
+        let p = unsafe { *pool };
+        if !p.is_null() {
+            let p = unsafe { Box::from_raw(p) };
+            drop(p);
+            unsafe { *pool = ptr::null_mut() };
+        }
+    }
+}
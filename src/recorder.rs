@@ -0,0 +1,434 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::client::{Client, Parts, Pipeline};
+use crate::logger;
+use crate::queue::CachePadded;
+use crate::span::Span;
+use crate::spool::{Spool, REPLAY_MAX};
+use newrelic_telemetry::blocking::Client as SdkClient;
+use newrelic_telemetry::span::SpanBatch as SdkSpanBatch;
+use std::cell::RefCell;
+use std::ptr;
+use std::sync::atomic::{AtomicBool, AtomicPtr, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, PoisonError};
+use std::thread::{self, JoinHandle, Thread};
+use std::time::{Duration, Instant};
+
+static NEXT_RECORDER_ID: AtomicUsize = AtomicUsize::new(1);
+
+thread_local! {
+    /// The buffers of the calling thread, one per recorder it recorded to.
+    static BUFFERS: RefCell<Vec<(usize, Arc<Buffer>)>> = RefCell::new(Vec::new());
+}
+
+/// A bounded single-producer single-consumer ring of finished spans.
+///
+/// The thread owning the buffer pushes spans, the flusher pops them. Both
+/// operations are wait-free: slots hold the spans as they were recorded, so
+/// pushing neither allocates nor converts. The flusher converts spans to
+/// their SDK representation when it moves them into batches.
+struct Buffer {
+    slots: Box<[AtomicPtr<Span>]>,
+    mask: usize,
+    head: CachePadded<AtomicUsize>,
+    tail: CachePadded<AtomicUsize>,
+    closed: AtomicBool,
+}
+
+impl Buffer {
+    fn new(capacity: usize) -> Self {
+        let capacity = capacity.next_power_of_two();
+        let mut slots = Vec::with_capacity(capacity);
+        for _ in 0..capacity {
+            slots.push(AtomicPtr::new(ptr::null_mut()));
+        }
+        Buffer {
+            slots: slots.into_boxed_slice(),
+            mask: capacity - 1,
+            head: CachePadded(AtomicUsize::new(0)),
+            tail: CachePadded(AtomicUsize::new(0)),
+            closed: AtomicBool::new(false),
+        }
+    }
+
+    /// Appends a span and returns the number of buffered spans, or gives the
+    /// span back if the buffer is full. Only called by the owning thread.
+    fn push(&self, span: Box<Span>) -> Result<usize, Box<Span>> {
+        let tail = self.tail.0.load(Ordering::Relaxed);
+        let head = self.head.0.load(Ordering::Acquire);
+        if tail.wrapping_sub(head) > self.mask {
+            return Err(span);
+        }
+        self.slots[tail & self.mask].store(Box::into_raw(span), Ordering::Relaxed);
+        self.tail.0.store(tail.wrapping_add(1), Ordering::Release);
+        Ok(tail.wrapping_add(1).wrapping_sub(head))
+    }
+
+    /// Passes all buffered spans to `f`. Only called by the flusher.
+    fn drain<F: FnMut(Box<Span>)>(&self, mut f: F) {
+        let head = self.head.0.load(Ordering::Relaxed);
+        let tail = self.tail.0.load(Ordering::Acquire);
+        let mut i = head;
+        while i != tail {
+            let span = self.slots[i & self.mask].swap(ptr::null_mut(), Ordering::Relaxed);
+            f(unsafe { Box::from_raw(span) });
+            i = i.wrapping_add(1);
+            // Free the slot right away, so the producer can reuse it.
+            self.head.0.store(i, Ordering::Release);
+        }
+    }
+
+    fn is_empty(&self) -> bool {
+        self.head.0.load(Ordering::Acquire) == self.tail.0.load(Ordering::Acquire)
+    }
+}
+
+impl Drop for Buffer {
+    fn drop(&mut self) {
+        for slot in self.slots.iter() {
+            let span = slot.swap(ptr::null_mut(), Ordering::Relaxed);
+            if !span.is_null() {
+                unsafe { Box::from_raw(span) }.release();
+            }
+        }
+    }
+}
+
+/// State shared between a recorder and its flusher thread.
+struct Shared {
+    buffers: Mutex<Vec<Arc<Buffer>>>,
+    batch_max: usize,
+    payload_max: usize,
+    flush_interval: Option<Duration>,
+    stop: AtomicBool,
+    discard: AtomicBool,
+}
+
+/// Records spans from any number of threads and sends them in batches from a
+/// background thread.
+pub struct Recorder {
+    id: usize,
+    shared: Arc<Shared>,
+    flusher: Option<JoinHandle<()>>,
+    flusher_thread: Thread,
+}
+
+impl Recorder {
+    /// Creates a recorder that sends batches of at most `batch_max` spans via
+    /// the given client. Partially filled batches are sent after
+    /// `flush_interval`, if given.
+    pub fn new(client: Client, batch_max: usize, flush_interval: Option<Duration>) -> Option<Self> {
+        let Parts {
+            sdk: client,
+            pipeline,
+            spool,
+            payload_max,
+        } = client.into_parts()?;
+        let shared = Arc::new(Shared {
+            buffers: Mutex::new(Vec::new()),
+            batch_max,
+            payload_max,
+            flush_interval,
+            stop: AtomicBool::new(false),
+            discard: AtomicBool::new(false),
+        });
+        let flusher_shared = shared.clone();
+        let flusher = thread::Builder::new()
+            .name("nrt-recorder".into())
+            .spawn(move || flush_loop(client, pipeline, spool, &flusher_shared))
+            .expect("unable to spawn recorder thread");
+        let flusher_thread = flusher.thread().clone();
+
+        Some(Recorder {
+            id: NEXT_RECORDER_ID.fetch_add(1, Ordering::Relaxed),
+            shared,
+            flusher: Some(flusher),
+            flusher_thread,
+        })
+    }
+
+    /// Appends a finished span to the buffer of the calling thread.
+    ///
+    /// Returns false if the buffer is full and the span was dropped. The
+    /// flusher passes buffered spans through the sampler and aggregator, and
+    /// stages them in the spool while the endpoint is unreachable, so none
+    /// of their locks are taken here.
+    pub fn record(&self, span: Box<Span>) -> bool {
+        let pushed = BUFFERS.with(|buffers| {
+            let mut buffers = buffers.borrow_mut();
+            match buffers.iter().find(|(id, _)| *id == self.id) {
+                Some((_, buffer)) => buffer.push(span),
+                None => self.register(&mut buffers).push(span),
+            }
+        });
+
+        match pushed {
+            Ok(len) => {
+                if len == self.shared.batch_max {
+                    self.flusher_thread.unpark();
+                }
+                true
+            }
+            Err(span) => {
+                span.release();
+                self.flusher_thread.unpark();
+                false
+            }
+        }
+    }
+
+    /// Creates the buffer of the calling thread. Buffers of recorders that
+    /// were shut down are dropped on the way.
+    fn register<'a>(&self, buffers: &'a mut Vec<(usize, Arc<Buffer>)>) -> &'a Buffer {
+        buffers.retain(|(_, buffer)| !buffer.closed.load(Ordering::Relaxed));
+
+        let buffer = Arc::new(Buffer::new(self.shared.batch_max * 2));
+        self.shared
+            .buffers
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .push(buffer.clone());
+        buffers.push((self.id, buffer));
+        &buffers[buffers.len() - 1].1
+    }
+
+    /// Stops the flusher thread. Buffered spans are sent unless `discard` is
+    /// set.
+    fn stop(&mut self, discard: bool) {
+        if let Some(flusher) = self.flusher.take() {
+            self.shared.discard.store(discard, Ordering::Relaxed);
+            self.shared.stop.store(true, Ordering::Release);
+            flusher.thread().unpark();
+            if flusher.join().is_err() {
+                log::error!("recorder thread panicked");
+            }
+        }
+    }
+
+    /// Sends all buffered spans and shuts down the client.
+    pub fn shutdown(mut self) {
+        self.stop(false);
+    }
+}
+
+impl Drop for Recorder {
+    fn drop(&mut self) {
+        self.stop(true);
+    }
+}
+
+/// Collects SDK spans into batches and sends them.
+struct Batcher {
+    client: SdkClient,
+    batch: SdkSpanBatch,
+    len: usize,
+    max: usize,
+    /// The estimated payload of the batch, and its maximum.
+    payload: usize,
+    payload_max: usize,
+    last_flush: Instant,
+}
+
+impl Batcher {
+    /// Converts a span, records it and releases it.
+    fn record(&mut self, mut span: Box<Span>) {
+        let size = span.payload_size();
+        if self.len > 0 && self.payload + size > self.payload_max {
+            self.send();
+        }
+        self.batch.record(span.to_sdk());
+        span.release();
+        self.len += 1;
+        self.payload += size;
+        if self.len == self.max {
+            self.send();
+        }
+    }
+
+    /// Records a span, or stages it in the spool while the endpoint is
+    /// unreachable.
+    fn route(&mut self, span: Box<Span>, spool: &Option<Arc<Spool>>) {
+        match spool {
+            Some(spool) if !spool.is_up() => spool.stage(span),
+            _ => self.record(span),
+        }
+    }
+
+    fn send(&mut self) {
+        if self.len > 0 {
+            let batch = std::mem::replace(&mut self.batch, SdkSpanBatch::new());
+            self.client.send_spans(batch);
+            self.len = 0;
+            self.payload = 0;
+        }
+        self.last_flush = Instant::now();
+    }
+}
+
+fn flush_loop(client: SdkClient, pipeline: Pipeline, spool: Option<Arc<Spool>>, shared: &Shared) {
+    let mut batcher = Batcher {
+        client,
+        batch: SdkSpanBatch::new(),
+        len: 0,
+        max: shared.batch_max,
+        payload: 0,
+        payload_max: shared.payload_max,
+        last_flush: Instant::now(),
+    };
+    let mut decided = Vec::new();
+
+    loop {
+        let stop = shared.stop.load(Ordering::Acquire);
+
+        let buffers: Vec<Arc<Buffer>> = {
+            let mut buffers = shared
+                .buffers
+                .lock()
+                .unwrap_or_else(PoisonError::into_inner);
+            // Buffers of threads that exited are only referenced from here.
+            buffers.retain(|buffer| Arc::strong_count(buffer) > 1 || !buffer.is_empty());
+            buffers.clone()
+        };
+
+        if stop && shared.discard.load(Ordering::Relaxed) {
+            for buffer in buffers.iter() {
+                buffer.closed.store(true, Ordering::Relaxed);
+            }
+            break;
+        }
+
+        for buffer in buffers.iter() {
+            buffer.drain(|span| {
+                if let Some(span) = pipeline.process(span) {
+                    batcher.route(span, &spool);
+                }
+            });
+        }
+
+        // Spans of traces decided by the tail sampler.
+        if stop {
+            pipeline.shutdown(&mut decided);
+        } else if let Some(sampler) = &pipeline.sampler {
+            sampler.flush(false, &mut decided);
+        }
+        for span in decided.drain(..) {
+            batcher.route(span, &spool);
+        }
+
+        if let Some(spool) = &spool {
+            spool.flush_staged();
+            if spool.is_up() {
+                for mut batch in spool.read(REPLAY_MAX) {
+                    for span in batch.spans_mut().drain(..) {
+                        batcher.record(span);
+                    }
+                }
+            }
+        }
+
+        let due = match shared.flush_interval {
+            Some(interval) => batcher.last_flush.elapsed() >= interval,
+            None => false,
+        };
+        if stop || due {
+            batcher.send();
+        }
+
+        if stop {
+            for buffer in buffers.iter() {
+                buffer.closed.store(true, Ordering::Relaxed);
+            }
+            break;
+        }
+
+        match shared.flush_interval {
+            Some(interval) => thread::park_timeout(
+                interval
+                    .checked_sub(batcher.last_flush.elapsed())
+                    .unwrap_or_default(),
+            ),
+            None => thread::park(),
+        }
+    }
+
+    if let Some(spool) = &spool {
+        spool.shutdown();
+    }
+    batcher.client.shutdown();
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_recorder_new(
+    client: *mut *mut Client,
+    batch_max: usize,
+    flush_interval_ms: u64,
+) -> *mut Recorder {
+    if client.is_null() || batch_max == 0 {
+        return ptr::null_mut();
+    }
+    let c = unsafe { *client };
+    // Recorders hand spans to an SDK client, which exporting clients lack.
+    if unsafe { c.as_ref() }.map_or(true, Client::exports) {
+        return ptr::null_mut();
+    }
+    let c = unsafe { Box::from_raw(c) };
+    unsafe { *client = ptr::null_mut() };
+
+    let flush_interval = match flush_interval_ms {
+        0 => None,
+        ms => Some(Duration::from_millis(ms)),
+    };
+    match Recorder::new(*c, batch_max, flush_interval) {
+        Some(recorder) => Box::into_raw(Box::new(recorder)),
+        None => ptr::null_mut(),
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_recorder_record(recorder: *mut Recorder, span: *mut *mut Span) -> bool {
+    if span.is_null() {
+        return false;
+    }
+    let s = unsafe { *span };
+    if s.is_null() {
+        return false;
+    }
+    let s = unsafe { Box::from_raw(s) };
+    unsafe { *span = ptr::null_mut() };
+
+    match unsafe { recorder.as_ref() } {
+        Some(recorder) => recorder.record(s),
+        None => {
+            s.release();
+            false
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_recorder_shutdown(recorder: *mut *mut Recorder) {
+    if !recorder.is_null() {
+        let r = unsafe { *recorder };
+        if !r.is_null() {
+            let r = unsafe { Box::from_raw(r) };
+            r.shutdown();
+            unsafe { *recorder = ptr::null_mut() };
+            logger::flush();
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn nrt_recorder_destroy(recorder: *mut *mut Recorder) {
+    if !recorder.is_null() {
+        let r = unsafe { *recorder };
+        if !r.is_null() {
+            let r = unsafe { Box::from_raw(r) };
+            drop(r);
+            unsafe { *recorder = ptr::null_mut() };
+            logger::flush();
+        }
+    }
+}
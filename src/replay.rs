@@ -0,0 +1,212 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::export;
+use crate::span::SpanBatch;
+use flate2::read::MultiGzDecoder;
+use std::collections::VecDeque;
+use std::fs::{self, File};
+use std::io::{self, Read};
+use std::ops::Deref;
+use std::path::{Path, PathBuf};
+
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct ReplayStats {
+    files: u64,
+    bytes: u64,
+    batches: u64,
+    spans: u64,
+    lines_skipped: u64,
+}
+
+/// A file mapped into memory read-only.
+#[cfg(unix)]
+struct Mapping {
+    ptr: *mut libc::c_void,
+    len: usize,
+}
+
+#[cfg(unix)]
+impl Mapping {
+    fn new(file: &File) -> io::Result<Mapping> {
+        use std::os::unix::io::AsRawFd;
+
+        let len = file.metadata()?.len() as usize;
+        if len == 0 {
+            return Ok(Mapping {
+                ptr: std::ptr::null_mut(),
+                len,
+            });
+        }
+        let ptr = unsafe {
+            libc::mmap(
+                std::ptr::null_mut(),
+                len,
+                libc::PROT_READ,
+                libc::MAP_PRIVATE,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(io::Error::last_os_error());
+        }
+        // Lines are read front to back exactly once.
+        unsafe { libc::madvise(ptr, len, libc::MADV_SEQUENTIAL) };
+        Ok(Mapping { ptr, len })
+    }
+}
+
+#[cfg(unix)]
+impl Deref for Mapping {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        if self.len == 0 {
+            return &[];
+        }
+        unsafe { std::slice::from_raw_parts(self.ptr as *const u8, self.len) }
+    }
+}
+
+#[cfg(unix)]
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        if self.len > 0 {
+            unsafe { libc::munmap(self.ptr, self.len) };
+        }
+    }
+}
+
+/// Files are read into memory on other platforms.
+#[cfg(not(unix))]
+struct Mapping(Vec<u8>);
+
+#[cfg(not(unix))]
+impl Mapping {
+    fn new(mut file: &File) -> io::Result<Mapping> {
+        let mut data = Vec::new();
+        file.read_to_end(&mut data)?;
+        Ok(Mapping(data))
+    }
+}
+
+#[cfg(not(unix))]
+impl Deref for Mapping {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        &self.0
+    }
+}
+
+/// The contents of the file being replayed.
+enum Data {
+    Mapped(Mapping),
+    /// A compressed file, decompressed as a whole.
+    Inflated(Vec<u8>),
+}
+
+impl Deref for Data {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        match self {
+            Data::Mapped(mapping) => mapping,
+            Data::Inflated(data) => data,
+        }
+    }
+}
+
+/// Reads files written by the exporter back as span batches, one per line.
+///
+/// Uncompressed files are memory-mapped and parsed in place, so replaying
+/// a capture doesn't copy it and only the batch being built is held in
+/// memory. Compressed files are decompressed into memory one at a time.
+/// Lines that can't be read are skipped.
+pub struct Replay {
+    files: VecDeque<PathBuf>,
+    data: Option<Data>,
+    offset: usize,
+    stats: ReplayStats,
+}
+
+impl Replay {
+    /// Opens a file, or all exported files in a directory in the order they
+    /// were written.
+    pub fn open(path: &Path) -> io::Result<Replay> {
+        let files = if fs::metadata(path)?.is_dir() {
+            let mut files = export::list(path)?;
+            files.sort();
+            files.into_iter().map(|(_, path)| path).collect()
+        } else {
+            vec![path.to_path_buf()].into()
+        };
+        Ok(Replay {
+            files,
+            data: None,
+            offset: 0,
+            stats: ReplayStats::default(),
+        })
+    }
+
+    pub fn stats(&self) -> ReplayStats {
+        self.stats
+    }
+
+    fn load(path: &Path) -> io::Result<Data> {
+        let file = File::open(path)?;
+        let mapping = Mapping::new(&file)?;
+        if path.extension().and_then(|e| e.to_str()) != Some("gz") {
+            return Ok(Data::Mapped(mapping));
+        }
+        let mut data = Vec::new();
+        MultiGzDecoder::new(&*mapping).read_to_end(&mut data)?;
+        Ok(Data::Inflated(data))
+    }
+
+    /// Returns the batch of the next line, or `None` once all files were
+    /// read.
+    pub fn next_batch(&mut self) -> Option<SpanBatch> {
+        loop {
+            let data = match &self.data {
+                Some(data) if self.offset < data.len() => data,
+                _ => {
+                    let path = self.files.pop_front()?;
+                    match Replay::load(&path) {
+                        Ok(data) => {
+                            self.stats.files += 1;
+                            self.data = Some(data);
+                        }
+                        Err(err) => {
+                            log::error!("unable to read {}: {}", path.display(), err);
+                            self.data = None;
+                        }
+                    }
+                    self.offset = 0;
+                    continue;
+                }
+            };
+
+            let rest = &data[self.offset..];
+            let len = rest.iter().position(|&b| b == b'\n').unwrap_or(rest.len());
+            let line = &rest[..len];
+            self.offset += len + 1;
+            self.stats.bytes += len as u64 + 1;
+            if line.iter().all(u8::is_ascii_whitespace) {
+                continue;
+            }
+            let json = serde_json::from_slice(line).ok();
+            match json.and_then(|json| SpanBatch::from_json(&json)) {
+                Some(batch) => {
+                    self.stats.batches += 1;
+                    self.stats.spans += batch.len() as u64;
+                    return Some(batch);
+                }
+                None => self.stats.lines_skipped += 1,
+            }
+        }
+    }
+}
@@ -0,0 +1,388 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::clock;
+use crate::lock;
+use crate::span::Span;
+use std::collections::HashMap;
+use std::mem;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::Mutex;
+use std::time::Duration;
+
+const SHARDS: usize = 16;
+
+/// Spans held back for tail sampling at most. Beyond this, spans are kept
+/// without waiting for a decision.
+const TAIL_PENDING_MAX: usize = 100_000;
+
+fn shard(key: u64) -> usize {
+    // Trace keys are random, mix them anyway in case they are not.
+    (key.wrapping_mul(0x9e37_79b9_7f4a_7c15) >> 60) as usize % SHARDS
+}
+
+#[derive(Clone, Default)]
+pub struct TailConfig {
+    pub duration_threshold: Option<Duration>,
+    pub decision_wait: Duration,
+}
+
+/// The sampling settings of a client configuration.
+#[derive(Clone, Default)]
+pub struct SamplingConfig {
+    pub ratio: Option<f64>,
+    pub rate_limit: Option<u32>,
+    pub tail: Option<TailConfig>,
+}
+
+#[repr(C)]
+#[derive(Default)]
+pub struct SamplingStats {
+    kept: u64,
+    dropped_ratio: u64,
+    dropped_rate_limit: u64,
+    dropped_tail: u64,
+    pending_tail: u64,
+}
+
+/// Remembers per-trace decisions for at least `ttl` and at most twice as
+/// long, so all spans of a trace get the same decision.
+struct DecisionCache {
+    shards: Vec<Mutex<Generations>>,
+    ttl: u64,
+}
+
+#[derive(Default)]
+struct Generations {
+    current: HashMap<u64, bool>,
+    previous: HashMap<u64, bool>,
+    rotated_at: u64,
+}
+
+impl Generations {
+    fn rotate(&mut self, now: u64, ttl: u64) {
+        if now.saturating_sub(self.rotated_at) >= ttl {
+            self.previous = mem::replace(&mut self.current, HashMap::new());
+            self.rotated_at = now;
+        }
+    }
+
+    fn get(&self, key: u64) -> Option<bool> {
+        self.current
+            .get(&key)
+            .or_else(|| self.previous.get(&key))
+            .cloned()
+    }
+}
+
+impl DecisionCache {
+    fn new(ttl: Duration) -> Self {
+        let mut shards = Vec::with_capacity(SHARDS);
+        for _ in 0..SHARDS {
+            shards.push(Mutex::new(Generations::default()));
+        }
+        DecisionCache {
+            shards,
+            ttl: ttl.as_nanos() as u64,
+        }
+    }
+
+    fn get(&self, key: u64) -> Option<bool> {
+        lock(&self.shards[shard(key)]).get(key)
+    }
+
+    /// Returns the cached decision for a trace, or makes and caches one.
+    fn get_or_decide<F: FnOnce() -> bool>(&self, key: u64, now: u64, decide: F) -> bool {
+        let mut generations = lock(&self.shards[shard(key)]);
+        generations.rotate(now, self.ttl);
+        if let Some(decision) = generations.get(key) {
+            return decision;
+        }
+        let decision = decide();
+        generations.current.insert(key, decision);
+        decision
+    }
+
+    fn insert(&self, key: u64, decision: bool, now: u64) {
+        let mut generations = lock(&self.shards[shard(key)]);
+        generations.rotate(now, self.ttl);
+        generations.current.insert(key, decision);
+    }
+}
+
+/// A token bucket admitting up to `rate` traces per second.
+struct RateLimiter {
+    rate: f64,
+    state: Mutex<(f64, u64)>,
+}
+
+impl RateLimiter {
+    fn new(rate: u32, now: u64) -> Self {
+        RateLimiter {
+            rate: rate as f64,
+            state: Mutex::new((rate as f64, now)),
+        }
+    }
+
+    fn try_acquire(&self, now: u64) -> bool {
+        let mut state = lock(&self.state);
+        let (tokens, last) = *state;
+        let refill = now.saturating_sub(last) as f64 * self.rate / 1e9;
+        let tokens = (tokens + refill).min(self.rate.max(1.0));
+        if tokens >= 1.0 {
+            *state = (tokens - 1.0, now);
+            true
+        } else {
+            *state = (tokens, now);
+            false
+        }
+    }
+}
+
+struct PendingTrace {
+    first_seen: u64,
+    keep: bool,
+    spans: Vec<Box<Span>>,
+}
+
+/// Holds back the spans of each trace for a while and keeps the trace only if
+/// one of its spans is an error or slow.
+struct TailSampler {
+    shards: Vec<Mutex<HashMap<u64, PendingTrace>>>,
+    decided: DecisionCache,
+    duration_threshold: Option<Duration>,
+    decision_wait: u64,
+    pending: AtomicUsize,
+    next_flush: AtomicU64,
+}
+
+impl TailSampler {
+    fn new(config: &TailConfig) -> Self {
+        let mut shards = Vec::with_capacity(SHARDS);
+        for _ in 0..SHARDS {
+            shards.push(Mutex::new(HashMap::new()));
+        }
+        TailSampler {
+            shards,
+            decided: DecisionCache::new(config.decision_wait.max(Duration::from_secs(1))),
+            duration_threshold: config.duration_threshold,
+            decision_wait: config.decision_wait.as_nanos() as u64,
+            pending: AtomicUsize::new(0),
+            next_flush: AtomicU64::new(0),
+        }
+    }
+
+    fn is_interesting(&self, span: &Span) -> bool {
+        if span.is_error() {
+            return true;
+        }
+        match (self.duration_threshold, span.duration()) {
+            (Some(threshold), Some(duration)) => duration >= threshold,
+            _ => false,
+        }
+    }
+}
+
+/// Decides which spans are sent.
+///
+/// Spans pass up to three stages: a probabilistic head sampler keyed on the
+/// trace ID, a limit on the number of traces per second, and a tail sampler.
+/// Head decisions only depend on the trace ID and are cheap, so applications
+/// can ask for them before they build a span.
+pub struct Sampler {
+    ratio_threshold: Option<u64>,
+    rate_limiter: Option<(RateLimiter, DecisionCache)>,
+    tail: Option<TailSampler>,
+    kept: AtomicU64,
+    dropped_ratio: AtomicU64,
+    dropped_rate_limit: AtomicU64,
+    dropped_tail: AtomicU64,
+}
+
+impl Sampler {
+    /// Creates a sampler, or returns `None` if sampling isn't configured.
+    pub fn new(config: &SamplingConfig) -> Option<Sampler> {
+        if config.ratio.is_none() && config.rate_limit.is_none() && config.tail.is_none() {
+            return None;
+        }
+
+        // Keep traces whose key is below `ratio` of the key space.
+        let ratio_threshold = match config.ratio {
+            Some(ratio) if ratio < 1.0 => Some((ratio.max(0.0) * 2f64.powi(64)) as u64),
+            _ => None,
+        };
+
+        Some(Sampler {
+            ratio_threshold,
+            rate_limiter: config.rate_limit.map(|rate| {
+                (
+                    RateLimiter::new(rate, clock::now()),
+                    DecisionCache::new(Duration::from_secs(1)),
+                )
+            }),
+            tail: config.tail.as_ref().map(TailSampler::new),
+            kept: AtomicU64::new(0),
+            dropped_ratio: AtomicU64::new(0),
+            dropped_rate_limit: AtomicU64::new(0),
+            dropped_tail: AtomicU64::new(0),
+        })
+    }
+
+    /// Makes the head sampling decision for a trace.
+    pub fn sample_trace(&self, key: u64) -> bool {
+        self.head(key, clock::now()).is_ok()
+    }
+
+    /// Returns which counter a dropped trace is accounted to.
+    fn head(&self, key: u64, now: u64) -> Result<(), &AtomicU64> {
+        if let Some(threshold) = self.ratio_threshold {
+            if key >= threshold {
+                return Err(&self.dropped_ratio);
+            }
+        }
+        if let Some((limiter, decisions)) = &self.rate_limiter {
+            if !decisions.get_or_decide(key, now, || limiter.try_acquire(now)) {
+                return Err(&self.dropped_rate_limit);
+            }
+        }
+        Ok(())
+    }
+
+    /// Passes a span through all stages. Returns the span if it is to be sent
+    /// right away. Spans held back for tail sampling are returned by `flush`.
+    pub fn sample(&self, span: Box<Span>) -> Option<Box<Span>> {
+        let now = clock::now();
+        let key = span.trace_key();
+
+        if let Err(counter) = self.head(key, now) {
+            counter.fetch_add(1, Ordering::Relaxed);
+            span.release();
+            return None;
+        }
+
+        let tail = match &self.tail {
+            Some(tail) => tail,
+            None => {
+                self.kept.fetch_add(1, Ordering::Relaxed);
+                return Some(span);
+            }
+        };
+
+        if let Some(keep) = tail.decided.get(key) {
+            return self.decided(span, keep);
+        }
+
+        if tail.pending.load(Ordering::Relaxed) >= TAIL_PENDING_MAX {
+            self.kept.fetch_add(1, Ordering::Relaxed);
+            return Some(span);
+        }
+
+        let interesting = tail.is_interesting(&span);
+        let mut traces = lock(&tail.shards[shard(key)]);
+        if !traces.contains_key(&key) {
+            // `flush` may have decided the trace since it was looked up
+            // above. It records decisions under the shard lock, so this
+            // check is final.
+            if let Some(keep) = tail.decided.get(key) {
+                drop(traces);
+                return self.decided(span, keep);
+            }
+        }
+        let trace = traces.entry(key).or_insert_with(|| PendingTrace {
+            first_seen: now,
+            keep: false,
+            spans: Vec::new(),
+        });
+        trace.keep |= interesting;
+        trace.spans.push(span);
+        tail.pending.fetch_add(1, Ordering::Relaxed);
+        None
+    }
+
+    /// Passes on or drops a span of a trace the tail sampler decided.
+    fn decided(&self, span: Box<Span>, keep: bool) -> Option<Box<Span>> {
+        if keep {
+            self.kept.fetch_add(1, Ordering::Relaxed);
+            Some(span)
+        } else {
+            self.dropped_tail.fetch_add(1, Ordering::Relaxed);
+            span.release();
+            None
+        }
+    }
+
+    /// Decides traces that were held back for the decision wait, or all held
+    /// back traces if `force` is set, and appends spans of kept traces to
+    /// `out`.
+    pub fn flush(&self, force: bool, out: &mut Vec<Box<Span>>) {
+        let tail = match &self.tail {
+            Some(tail) => tail,
+            None => return,
+        };
+        let now = clock::now();
+        if !force && now < tail.next_flush.load(Ordering::Relaxed) {
+            return;
+        }
+        tail.next_flush
+            .store(now + tail.decision_wait / 4, Ordering::Relaxed);
+
+        for shard in tail.shards.iter() {
+            let mut traces = lock(shard);
+            let expired: Vec<u64> = traces
+                .iter()
+                .filter(|(_, trace)| {
+                    force || now.saturating_sub(trace.first_seen) >= tail.decision_wait
+                })
+                .map(|(key, _)| *key)
+                .collect();
+
+            for key in expired {
+                let trace = match traces.remove(&key) {
+                    Some(trace) => trace,
+                    None => continue,
+                };
+                tail.pending.fetch_sub(trace.spans.len(), Ordering::Relaxed);
+                tail.decided.insert(key, trace.keep, now);
+                if trace.keep {
+                    self.kept
+                        .fetch_add(trace.spans.len() as u64, Ordering::Relaxed);
+                    out.extend(trace.spans);
+                } else {
+                    self.dropped_tail
+                        .fetch_add(trace.spans.len() as u64, Ordering::Relaxed);
+                    for span in trace.spans {
+                        span.release();
+                    }
+                }
+            }
+        }
+    }
+
+    /// Passes all spans through the sampler and adds spans of traces that
+    /// were decided in the meantime.
+    pub fn filter(&self, spans: &mut Vec<Box<Span>>) {
+        let mut kept = Vec::with_capacity(spans.len());
+        for span in spans.drain(..) {
+            if let Some(span) = self.sample(span) {
+                kept.push(span);
+            }
+        }
+        self.flush(false, &mut kept);
+        *spans = kept;
+    }
+
+    pub fn stats(&self) -> SamplingStats {
+        SamplingStats {
+            kept: self.kept.load(Ordering::Relaxed),
+            dropped_ratio: self.dropped_ratio.load(Ordering::Relaxed),
+            dropped_rate_limit: self.dropped_rate_limit.load(Ordering::Relaxed),
+            dropped_tail: self.dropped_tail.load(Ordering::Relaxed),
+            pending_tail: self
+                .tail
+                .as_ref()
+                .map(|tail| tail.pending.load(Ordering::Relaxed) as u64)
+                .unwrap_or(0),
+        }
+    }
+}
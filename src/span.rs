@@ -0,0 +1,1101 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::attributes::{AttributeValue, Attributes};
+use crate::clock;
+use crate::codec::{self, Reader};
+use crate::completion::Completion;
+use crate::id::Id;
+use crate::intern::{self, Str};
+use crate::pool::Pool;
+use newrelic_telemetry::attribute::Value;
+use newrelic_telemetry::span::{Span as SdkSpan, SpanBatch as SdkSpanBatch};
+use serde::ser::{Serialize, SerializeMap, Serializer};
+use serde_json::Value as Json;
+use std::sync::Arc;
+use std::time::Duration;
+
+/// Bytes of JSON a span takes besides its IDs and attributes: braces, commas,
+/// the keys of the required fields and the timestamp.
+const JSON_SPAN_OVERHEAD: usize = 64;
+/// Bytes of JSON an attribute takes besides its key and value.
+const JSON_ATTRIBUTE_OVERHEAD: usize = 6;
+/// Bytes of JSON a number takes at most.
+const JSON_NUMBER_MAX: usize = 24;
+/// Bytes of JSON the common block of a payload takes besides its attributes.
+const JSON_COMMON_OVERHEAD: usize = 32;
+
+/// Estimates the size of an attribute in the JSON payload.
+fn attribute_size(key: &str, value: &AttributeValue) -> usize {
+    JSON_ATTRIBUTE_OVERHEAD
+        + key.len()
+        + match value {
+            AttributeValue::Str(value) => value.len() + 2,
+            AttributeValue::Bool(_) => 5,
+            _ => JSON_NUMBER_MAX,
+        }
+}
+
+fn string_size(key: &str, len: usize) -> usize {
+    JSON_ATTRIBUTE_OVERHEAD + key.len() + len + 2
+}
+
+/// An optional string field.
+///
+/// The field keeps its buffer when it's cleared, so recycled spans don't have
+/// to allocate again. Strings that live for the whole process are shared
+/// instead of copied.
+#[derive(Debug, Default)]
+pub struct StrField {
+    buf: String,
+    shared: Option<&'static str>,
+    is_set: bool,
+}
+
+impl StrField {
+    pub fn get(&self) -> Option<&str> {
+        if !self.is_set {
+            return None;
+        }
+        Some(self.shared.unwrap_or(&self.buf))
+    }
+
+    pub fn set(&mut self, value: &str) {
+        self.buf.clear();
+        self.buf.push_str(value);
+        self.shared = None;
+        self.is_set = true;
+    }
+
+    pub fn set_shared(&mut self, value: &'static str) {
+        self.shared = Some(value);
+        self.is_set = true;
+    }
+
+    pub fn clear(&mut self) {
+        self.buf.clear();
+        self.shared = None;
+        self.is_set = false;
+    }
+}
+
+/// The parts of spans that don't change between spans created at the same
+/// call site.
+///
+/// Spans created from a template share its name and service name, which are
+/// interned, and its attributes by reference, so only their own fields are
+/// allocated.
+pub struct Template {
+    name: Option<&'static str>,
+    service_name: Option<&'static str>,
+    attributes: Attributes,
+}
+
+impl Template {
+    /// Creates a template, moving all attributes of the given collection into
+    /// it.
+    pub fn new(
+        name: Option<&'static str>,
+        service_name: Option<&'static str>,
+        attributes: Option<&mut Attributes>,
+    ) -> Self {
+        let mut template = Template {
+            name,
+            service_name,
+            attributes: Attributes::new(),
+        };
+        if let Some(attributes) = attributes {
+            template.attributes.append(attributes);
+        }
+        template
+    }
+}
+
+/// A span as it is built via the C API.
+///
+/// Spans are converted into spans of the Rust SDK only when their batch is
+/// handed to a client. Until then they can be recycled via a pool.
+#[derive(Default)]
+pub struct Span {
+    id: Id,
+    trace_id: Id,
+    timestamp: u64,
+    duration: Option<Duration>,
+    start: Option<u64>,
+    name: StrField,
+    service_name: StrField,
+    parent_id: Id,
+    attributes: Attributes,
+    /// The template the span was created from. Its own attributes take
+    /// precedence.
+    template: Option<Arc<Template>>,
+    /// The common attributes of the batch the span was recorded into. Its
+    /// own attributes and those of its template take precedence.
+    common: Option<Arc<Attributes>>,
+    pub(crate) pool: Option<Arc<Pool>>,
+}
+
+impl Span {
+    pub fn new(id: &str, trace_id: &str, timestamp: u64) -> Self {
+        let mut span = Span::default();
+        span.set_id(id);
+        span.set_trace_id(trace_id);
+        span.set_timestamp(timestamp);
+        span
+    }
+
+    /// Sets the name and service name of a template and makes the span
+    /// inherit its attributes.
+    pub fn set_template(&mut self, template: &Arc<Template>) {
+        if let Some(name) = template.name {
+            self.name.set_shared(name);
+        }
+        if let Some(service_name) = template.service_name {
+            self.service_name.set_shared(service_name);
+        }
+        self.template = Some(template.clone());
+    }
+
+    pub fn set_id(&mut self, id: &str) {
+        self.id.set_str(id);
+    }
+
+    pub fn set_id_u64(&mut self, id: u64) {
+        self.id.set_u64(id);
+    }
+
+    pub fn set_trace_id(&mut self, trace_id: &str) {
+        self.trace_id.set_str(trace_id);
+    }
+
+    pub fn set_trace_id_u128(&mut self, high: u64, low: u64) {
+        self.trace_id.set_u128(high, low);
+    }
+
+    pub fn set_timestamp(&mut self, timestamp: u64) {
+        self.timestamp = timestamp;
+    }
+
+    pub fn set_duration(&mut self, duration: Duration) {
+        self.duration = Some(duration);
+    }
+
+    /// Sets the timestamp to the current time and remembers the start of the
+    /// span on the monotonic clock.
+    pub fn start(&mut self) {
+        let now = clock::now();
+        self.timestamp = clock::to_epoch_ms(now);
+        self.start = Some(now);
+    }
+
+    /// Sets the duration to the time elapsed since `start` was called.
+    pub fn end(&mut self) -> bool {
+        match self.start {
+            Some(start) => {
+                self.duration = Some(Duration::from_nanos(clock::now().saturating_sub(start)));
+                true
+            }
+            None => false,
+        }
+    }
+
+    pub fn set_name(&mut self, name: &str) {
+        self.name.set(name);
+    }
+
+    pub fn set_name_shared(&mut self, name: &'static str) {
+        self.name.set_shared(name);
+    }
+
+    pub fn set_service_name(&mut self, service_name: &str) {
+        self.service_name.set(service_name);
+    }
+
+    pub fn set_service_name_shared(&mut self, service_name: &'static str) {
+        self.service_name.set_shared(service_name);
+    }
+
+    pub fn set_parent_id(&mut self, parent_id: &str) {
+        self.parent_id.set_str(parent_id);
+    }
+
+    pub fn set_parent_id_u64(&mut self, parent_id: u64) {
+        self.parent_id.set_u64(parent_id);
+    }
+
+    /// Returns 64 bits of the trace ID to base sampling decisions on.
+    pub fn trace_key(&self) -> u64 {
+        self.trace_id.key()
+    }
+
+    pub fn name(&self) -> Option<&str> {
+        self.name.get()
+    }
+
+    /// Returns the service name of the span, or else the one among the
+    /// attributes it inherits.
+    pub fn service_name(&self) -> Option<&str> {
+        self.service_name
+            .get()
+            .or_else(|| match self.inherited_attribute("service.name") {
+                Some(AttributeValue::Str(service_name)) => Some(service_name),
+                _ => None,
+            })
+    }
+
+    pub fn duration(&self) -> Option<Duration> {
+        self.duration
+    }
+
+    /// Returns whether the span has an `error` attribute that isn't false.
+    pub fn is_error(&self) -> bool {
+        match self
+            .attributes
+            .get("error")
+            .or_else(|| self.inherited_attribute("error"))
+        {
+            Some(AttributeValue::Bool(error)) => *error,
+            Some(_) => true,
+            None => false,
+        }
+    }
+
+    pub fn attributes_mut(&mut self) -> &mut Attributes {
+        &mut self.attributes
+    }
+
+    /// Moves all attributes of the given collection into the span, leaving
+    /// the collection empty.
+    pub fn set_attributes(&mut self, attributes: &mut Attributes) {
+        self.attributes.append(attributes);
+    }
+
+    /// Sets the common attributes the span inherits from its batch.
+    pub fn set_common(&mut self, common: Option<Arc<Attributes>>) {
+        self.common = common;
+    }
+
+    /// Returns the value the span inherits for `key` from its template or
+    /// batch.
+    fn inherited_attribute(&self, key: &str) -> Option<&AttributeValue> {
+        self.template
+            .as_ref()
+            .and_then(|template| template.attributes.get(key))
+            .or_else(|| self.common.as_ref().and_then(|common| common.get(key)))
+    }
+
+    /// Returns whether an attribute is replaced by a field of the span when
+    /// it's converted.
+    fn is_overridden(&self, key: &str) -> bool {
+        match key {
+            "name" => self.name.get().is_some(),
+            "service.name" => self.service_name.get().is_some(),
+            "parent.id" => self.parent_id.is_set(),
+            "duration.ms" => self.duration.is_some(),
+            _ => false,
+        }
+    }
+
+    /// Returns the attributes the span inherits from its template and batch
+    /// without overriding them. Common attributes of the batch are left out
+    /// if they are the common block the span is converted into.
+    fn inherited<'a>(
+        &'a self,
+        block: &'a CommonBlock,
+    ) -> impl Iterator<Item = &'a (Str, AttributeValue)> + 'a {
+        let template = self
+            .template
+            .iter()
+            .flat_map(|template| template.attributes.iter())
+            .filter(move |(key, _)| self.attributes.get(key).is_none());
+        let common = match (&self.common, &block.attributes) {
+            (Some(common), Some(shared)) if Arc::ptr_eq(common, shared) => None,
+            (common, _) => common.as_ref(),
+        };
+        let common = common
+            .into_iter()
+            .flat_map(|common| common.iter())
+            .filter(move |(key, _)| {
+                self.attributes.get(key).is_none()
+                    && self
+                        .template
+                        .as_ref()
+                        .map_or(true, |template| template.attributes.get(key).is_none())
+            });
+        template.chain(common)
+    }
+
+    /// Returns whether the span sends `value` for `key`.
+    fn sends(&self, key: &str, value: &AttributeValue) -> bool {
+        let field = match key {
+            "name" => self.name.get(),
+            "service.name" => self.service_name.get(),
+            _ => None,
+        };
+        match (field, value) {
+            (Some(field), AttributeValue::Str(value)) => field == &**value,
+            (Some(_), _) => false,
+            (None, value) => self
+                .attributes
+                .get(key)
+                .or_else(|| self.inherited_attribute(key))
+                .map_or(false, |sent| sent.same(value)),
+        }
+    }
+
+    /// Estimates the size of this span in the JSON payload sent to the trace
+    /// API, including the common attributes of its batch. Strings are
+    /// assumed not to need escaping, numbers are assumed to take their
+    /// maximum length.
+    pub fn payload_size(&self) -> usize {
+        self.payload_size_in(&CommonBlock::default())
+    }
+
+    /// Like `payload_size`, but leaves out the values the span shares with
+    /// the common block of its payload.
+    fn payload_size_in(&self, block: &CommonBlock) -> usize {
+        let mut size = JSON_SPAN_OVERHEAD + self.id.len() + self.trace_id.len();
+        if let Some(name) = self.name.get() {
+            if !block.has_str("name", name) {
+                size += string_size("name", name.len());
+            }
+        }
+        if let Some(service_name) = self.service_name.get() {
+            if !block.has_str("service.name", service_name) {
+                size += string_size("service.name", service_name.len());
+            }
+        }
+        if self.parent_id.is_set() {
+            size += string_size("parent.id", self.parent_id.len());
+        }
+        if self.duration.is_some() {
+            size += JSON_ATTRIBUTE_OVERHEAD + "duration.ms".len() + JSON_NUMBER_MAX;
+        }
+        for (key, value) in self.inherited(block) {
+            if !self.is_overridden(key) && !block.has(key, value) {
+                size += attribute_size(key, value);
+            }
+        }
+        for (key, value) in self.attributes.iter() {
+            if !self.is_overridden(key) && !block.has(key, value) {
+                size += attribute_size(key, value);
+            }
+        }
+        size
+    }
+
+    /// Builds the Rust SDK representation of this span.
+    ///
+    /// Attribute values are moved into the SDK span, all other fields are
+    /// copied so the span keeps its buffers for reuse. Binary IDs are
+    /// hex-encoded here. The attributes of the template and the common
+    /// attributes of the batch are copied into the span.
+    pub fn to_sdk(&mut self) -> SdkSpan {
+        self.to_sdk_in(&CommonBlock::default())
+    }
+
+    /// Like `to_sdk`, but leaves out the values the span shares with the
+    /// common block of the SDK batch it is recorded into.
+    fn to_sdk_in(&mut self, block: &CommonBlock) -> SdkSpan {
+        if cfg!(debug_assertions) {
+            self.check_static();
+        }
+        let timestamp = self.timestamp;
+        let mut span = self.id.with_str(|id| {
+            self.trace_id
+                .with_str(|trace_id| SdkSpan::new(id, trace_id, timestamp))
+        });
+
+        self.drain_attributes_in(block, |key, value| {
+            span.set_attribute(key, Value::from(value))
+        });
+        if let Some(name) = self.name.get() {
+            if !block.has_str("name", name) {
+                span.set_name(name);
+            }
+        }
+        if let Some(service_name) = self.service_name.get() {
+            if !block.has_str("service.name", service_name) {
+                span.set_service_name(service_name);
+            }
+        }
+        if self.parent_id.is_set() {
+            self.parent_id
+                .with_str(|parent_id| span.set_parent_id(parent_id));
+        }
+        if let Some(duration) = self.duration {
+            if duration.subsec_nanos() % 1_000_000 == 0 {
+                span.set_duration(duration);
+            } else {
+                // The SDK only sends whole milliseconds, keep the fraction.
+                span.set_attribute("duration.ms", duration.as_secs_f64() * 1000.0);
+            }
+        }
+
+        span
+    }
+
+    /// Passes the inherited and own attributes the span sends to `f`,
+    /// leaving out those shared with `block`. Own attribute values are moved
+    /// out, inherited ones are copied.
+    fn drain_attributes_in<F: FnMut(&str, AttributeValue)>(
+        &mut self,
+        block: &CommonBlock,
+        mut f: F,
+    ) {
+        for (key, value) in self.inherited(block) {
+            if !self.is_overridden(key) && !block.has(key, value) {
+                f(key, value.clone());
+            }
+        }
+        let (has_name, has_service_name) =
+            (self.name.get().is_some(), self.service_name.get().is_some());
+        let (has_parent_id, has_duration) = (self.parent_id.is_set(), self.duration.is_some());
+        for (key, value) in self.attributes.drain() {
+            let overridden = match &*key {
+                "name" => has_name,
+                "service.name" => has_service_name,
+                "parent.id" => has_parent_id,
+                "duration.ms" => has_duration,
+                _ => false,
+            };
+            if !overridden && !block.has(&key, &value) {
+                f(&key, value);
+            }
+        }
+    }
+
+    /// Returns the inherited and own attributes the span sends, leaving out
+    /// those shared with `block`.
+    fn attributes_in<'a>(
+        &'a self,
+        block: &'a CommonBlock,
+    ) -> impl Iterator<Item = (&'a str, &'a AttributeValue)> + 'a {
+        self.inherited(block)
+            .chain(self.attributes.iter())
+            .map(|(key, value)| (&**key, value))
+            .filter(move |(key, value)| !self.is_overridden(key) && !block.has(key, value))
+    }
+
+    /// Builds a span from its JSON in the format of the trace API. Returns
+    /// `None` if an ID is missing. Attributes that aren't scalars are
+    /// skipped.
+    pub fn from_json(json: &Json) -> Option<Box<Span>> {
+        let mut span = Box::new(Span::default());
+        span.set_id(json.get("id")?.as_str()?);
+        span.set_trace_id(json.get("trace.id")?.as_str()?);
+        if let Some(timestamp) = json.get("timestamp").and_then(Json::as_u64) {
+            span.timestamp = timestamp;
+        }
+        let attributes = match json.get("attributes") {
+            Some(attributes) => Some(attributes.as_object()?),
+            None => None,
+        };
+        for (key, value) in attributes.into_iter().flatten() {
+            match (&**key, value) {
+                ("name", Json::String(name)) => span.set_name(name),
+                ("service.name", Json::String(service_name)) => span.set_service_name(service_name),
+                ("parent.id", Json::String(parent_id)) => span.set_parent_id(parent_id),
+                ("duration.ms", duration) => {
+                    let secs = duration.as_f64()? / 1000.0;
+                    if !(secs >= 0.0 && secs < u64::MAX as f64) {
+                        return None;
+                    }
+                    span.duration = Some(Duration::from_secs_f64(secs));
+                }
+                _ => {
+                    if let Some(value) = to_attribute(value) {
+                        span.attributes.insert(Str::Owned(key.to_string()), value);
+                    }
+                }
+            }
+        }
+        Some(span)
+    }
+
+    /// Checks that the strings the application declared static are still
+    /// intact by the time the span is sent.
+    fn check_static(&self) {
+        for field in &[&self.name, &self.service_name] {
+            if let Some(shared) = field.shared {
+                intern::check_static(shared);
+            }
+        }
+        for (key, value) in self.attributes.iter() {
+            if let Str::Static(key) = key {
+                intern::check_static(key);
+            }
+            if let AttributeValue::Str(Str::Static(value)) = value {
+                intern::check_static(value);
+            }
+        }
+    }
+
+    /// Appends the binary encoding of this span to `out`.
+    ///
+    /// IDs are encoded in their textual form, so a decoded span has textual
+    /// IDs. The start on the monotonic clock is not encoded, it is
+    /// meaningless in another process. Inherited attributes are encoded as
+    /// attributes of the span.
+    pub fn encode(&self, out: &mut Vec<u8>) {
+        self.id.with_str(|id| codec::put_str(out, id));
+        self.trace_id
+            .with_str(|trace_id| codec::put_str(out, trace_id));
+        self.parent_id
+            .with_str(|parent_id| codec::put_str(out, parent_id));
+        codec::put_u64(out, self.timestamp);
+        match self.duration {
+            Some(duration) => {
+                codec::put_u8(out, 1);
+                codec::put_u64(out, duration.as_nanos() as u64);
+            }
+            None => codec::put_u8(out, 0),
+        }
+        for field in &[&self.name, &self.service_name] {
+            match field.get() {
+                Some(value) => {
+                    codec::put_u8(out, 1);
+                    codec::put_str(out, value);
+                }
+                None => codec::put_u8(out, 0),
+            }
+        }
+        let block = CommonBlock::default();
+        let inherited = self.inherited(&block).count();
+        codec::put_u32(out, (self.attributes.iter().len() + inherited) as u32);
+        for (key, value) in self.attributes.iter().chain(self.inherited(&block)) {
+            codec::put_str(out, key);
+            match value {
+                AttributeValue::Int(v) => {
+                    codec::put_u8(out, 0);
+                    codec::put_u64(out, *v as u64);
+                }
+                AttributeValue::UInt(v) => {
+                    codec::put_u8(out, 1);
+                    codec::put_u64(out, *v);
+                }
+                AttributeValue::Double(v) => {
+                    codec::put_u8(out, 2);
+                    codec::put_u64(out, v.to_bits());
+                }
+                AttributeValue::Str(v) => {
+                    codec::put_u8(out, 3);
+                    codec::put_str(out, v);
+                }
+                AttributeValue::Bool(v) => {
+                    codec::put_u8(out, 4);
+                    codec::put_u8(out, *v as u8);
+                }
+            }
+        }
+    }
+
+    /// Decodes a span written by `encode`. Returns `None` if the input is
+    /// truncated or corrupt.
+    pub fn decode(reader: &mut Reader) -> Option<Box<Span>> {
+        let mut span = Box::new(Span::default());
+        span.set_id(reader.str()?);
+        span.set_trace_id(reader.str()?);
+        let parent_id = reader.str()?;
+        if !parent_id.is_empty() {
+            span.set_parent_id(parent_id);
+        }
+        span.timestamp = reader.u64()?;
+        if reader.u8()? == 1 {
+            span.duration = Some(Duration::from_nanos(reader.u64()?));
+        }
+        if reader.u8()? == 1 {
+            span.set_name(reader.str()?);
+        }
+        if reader.u8()? == 1 {
+            span.set_service_name(reader.str()?);
+        }
+        for _ in 0..reader.u32()? {
+            let key = Str::Owned(reader.str()?.to_string());
+            let value = match reader.u8()? {
+                0 => AttributeValue::Int(reader.u64()? as i64),
+                1 => AttributeValue::UInt(reader.u64()?),
+                2 => AttributeValue::Double(f64::from_bits(reader.u64()?)),
+                3 => AttributeValue::Str(Str::Owned(reader.str()?.to_string())),
+                4 => AttributeValue::Bool(reader.u8()? != 0),
+                _ => return None,
+            };
+            span.attributes.insert(key, value);
+        }
+        Some(span)
+    }
+
+    /// Clears all fields, keeping allocated buffers.
+    pub fn reset(&mut self) {
+        self.id.clear();
+        self.trace_id.clear();
+        self.timestamp = 0;
+        self.duration = None;
+        self.start = None;
+        self.name.clear();
+        self.service_name.clear();
+        self.parent_id.clear();
+        self.attributes.clear();
+        self.template = None;
+        self.common = None;
+    }
+
+    /// Returns the span to its pool, or frees it if it isn't pooled.
+    pub fn release(mut self: Box<Self>) {
+        if let Some(pool) = self.pool.take() {
+            pool.put_span(self);
+        }
+    }
+}
+
+/// The common block of an SDK batch.
+///
+/// Spans converted into the batch leave out values that are identical in
+/// the block, so shared values are stored and sent once per payload.
+#[derive(Default)]
+struct CommonBlock {
+    /// The common attributes shared by all spans of the batch.
+    attributes: Option<Arc<Attributes>>,
+    /// Values that all spans of the batch send with the same key, hoisted
+    /// out of the spans.
+    hoisted: Vec<(Str, AttributeValue)>,
+}
+
+impl CommonBlock {
+    /// Returns the block of a payload of the given spans. Their common
+    /// attributes go into the block if all spans share them.
+    fn explicit(spans: &[Box<Span>]) -> Self {
+        let attributes = spans.first().and_then(|first| first.common.as_ref());
+        let shared = spans.iter().all(|span| match (&span.common, attributes) {
+            (Some(common), Some(attributes)) => Arc::ptr_eq(common, attributes),
+            _ => false,
+        });
+        CommonBlock {
+            attributes: attributes.filter(|_| shared).cloned(),
+            hoisted: Vec::new(),
+        }
+    }
+
+    /// Like `explicit`, and also hoists the values the first span sends
+    /// that all other spans send as well.
+    fn of(spans: &[Box<Span>]) -> Self {
+        let mut block = CommonBlock::explicit(spans);
+        let (first, others) = match spans.split_first() {
+            Some((first, others)) if !others.is_empty() => (first, others),
+            _ => return block,
+        };
+
+        let mut candidates = Vec::new();
+        if let Some(name) = first.name.get() {
+            candidates.push((Str::from("name"), AttributeValue::Str(Str::from(name))));
+        }
+        if let Some(service_name) = first.service_name.get() {
+            candidates.push((
+                Str::from("service.name"),
+                AttributeValue::Str(Str::from(service_name)),
+            ));
+        }
+        for (key, value) in first.attributes.iter().chain(first.inherited(&block)) {
+            if !first.is_overridden(key) {
+                candidates.push((key.clone(), value.clone()));
+            }
+        }
+        let in_common = |key: &str| match &block.attributes {
+            Some(common) => common.get(key).is_some(),
+            None => false,
+        };
+        let hoisted = candidates
+            .into_iter()
+            .filter(|(key, value)| {
+                !in_common(key) && others.iter().all(|span| span.sends(key, value))
+            })
+            .collect();
+        block.hoisted = hoisted;
+        block
+    }
+
+    /// Returns whether the block holds the given attribute.
+    fn has(&self, key: &str, value: &AttributeValue) -> bool {
+        match self.attributes.as_ref().and_then(|a| a.get(key)) {
+            Some(common) => common.same(value),
+            None => self
+                .hoisted
+                .iter()
+                .any(|(k, v)| &**k == key && v.same(value)),
+        }
+    }
+
+    fn has_str(&self, key: &str, value: &str) -> bool {
+        let held = match self.attributes.as_ref().and_then(|a| a.get(key)) {
+            Some(common) => Some(common),
+            None => self
+                .hoisted
+                .iter()
+                .find(|(k, _)| &**k == key)
+                .map(|(_, v)| v),
+        };
+        match held {
+            Some(AttributeValue::Str(held)) => &**held == value,
+            _ => false,
+        }
+    }
+
+    fn payload_size(&self) -> usize {
+        let common = self.attributes.iter().flat_map(|a| a.iter());
+        JSON_COMMON_OVERHEAD
+            + common
+                .map(|(key, value)| attribute_size(key, value))
+                .sum::<usize>()
+            + self
+                .hoisted
+                .iter()
+                .map(|(key, value)| attribute_size(key, value))
+                .sum::<usize>()
+    }
+
+    fn is_empty(&self) -> bool {
+        self.hoisted.is_empty() && self.attributes.as_ref().map_or(true, |a| a.is_empty())
+    }
+
+    /// Puts the attributes of the block into the common block of `batch`.
+    fn apply(&self, batch: &mut SdkSpanBatch) {
+        if let Some(common) = &self.attributes {
+            for (key, value) in common.iter() {
+                batch.set_attribute(key, Value::from(value.clone()));
+            }
+        }
+        for (key, value) in self.hoisted.iter() {
+            batch.set_attribute(key, Value::from(value.clone()));
+        }
+    }
+}
+
+/// A batch of spans as it is built via the C API.
+#[derive(Default)]
+pub struct SpanBatch {
+    spans: Vec<Box<Span>>,
+    /// Attributes shared by all spans of the batch.
+    common: Option<Arc<Attributes>>,
+    pub(crate) pool: Option<Arc<Pool>>,
+    /// When the batch was put into the send queue, as read from `clock::now`.
+    pub(crate) queued_at: u64,
+    /// Called once the batch left the send queue, if it was submitted with a
+    /// callback.
+    pub(crate) completion: Option<Completion>,
+}
+
+impl SpanBatch {
+    pub fn new() -> Self {
+        SpanBatch::default()
+    }
+
+    /// Returns a new span, taken from the pool of this batch if there is one.
+    pub fn new_span(&self) -> Box<Span> {
+        match &self.pool {
+            Some(pool) => Pool::take_span(pool),
+            None => Box::new(Span::default()),
+        }
+    }
+
+    pub fn record(&mut self, mut span: Box<Span>) {
+        if self.common.is_some() {
+            span.set_common(self.common.clone());
+        }
+        self.spans.push(span);
+    }
+
+    /// Moves all attributes of the given collection into the common
+    /// attributes of the batch, replacing earlier ones. They apply to the
+    /// spans recorded before and after.
+    pub fn set_common_attributes(&mut self, attributes: &mut Attributes) {
+        let mut common = Attributes::new();
+        common.append(attributes);
+        let common = Arc::new(common);
+        for span in self.spans.iter_mut() {
+            span.set_common(Some(common.clone()));
+        }
+        self.common = Some(common);
+    }
+
+    pub fn len(&self) -> usize {
+        self.spans.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.spans.is_empty()
+    }
+
+    pub fn spans_mut(&mut self) -> &mut Vec<Box<Span>> {
+        &mut self.spans
+    }
+
+    /// Splits the spans of this batch into payloads and passes each to `f`.
+    /// A new payload is started whenever the estimated size of the current
+    /// one would exceed `payload_max` bytes. A span that is larger on its own
+    /// gets a payload of its own.
+    ///
+    /// The batch is left empty and its spans are released.
+    fn split<F: FnMut(&mut [Box<Span>])>(&mut self, payload_max: usize, mut f: F) {
+        let mut start = 0;
+        let mut block = CommonBlock::default();
+        let mut payload = 0;
+        for end in 0..self.spans.len() {
+            let mut size = self.spans[end].payload_size_in(&block);
+            if end > start && payload + size > payload_max {
+                f(&mut self.spans[start..end]);
+                start = end;
+            }
+            if end == start {
+                block = CommonBlock::explicit(&self.spans[end..=end]);
+                payload = block.payload_size();
+                size = self.spans[end].payload_size_in(&block);
+            }
+            payload += size;
+        }
+        if start < self.spans.len() {
+            f(&mut self.spans[start..]);
+        }
+        for span in self.spans.drain(..) {
+            span.release();
+        }
+    }
+
+    /// Builds Rust SDK batches of the spans of this batch and passes them to
+    /// `f`, along with their estimated payload size. The spans are split
+    /// into batches like by `split`, so each batch is sent in a request of
+    /// its own.
+    ///
+    /// Values shared by all spans of an SDK batch are sent once in its common
+    /// block.
+    ///
+    /// The batch is left empty and its spans are released.
+    pub fn to_sdk<F: FnMut(SdkSpanBatch, usize)>(&mut self, payload_max: usize, mut f: F) {
+        self.split(payload_max, |spans| {
+            let (batch, size) = SpanBatch::chunk_to_sdk(spans);
+            f(batch, size)
+        });
+    }
+
+    /// Like `to_sdk`, but appends the payloads to `out` as JSON in the
+    /// format of the trace API, one line each. Returns the number of lines.
+    pub fn to_json(&mut self, payload_max: usize, out: &mut Vec<u8>) -> usize {
+        let mut lines = 0;
+        self.split(payload_max, |spans| {
+            if SpanBatch::chunk_to_json(spans, out) {
+                lines += 1;
+            }
+        });
+        lines
+    }
+
+    /// Builds a batch from a line written by `to_json`, or any payload of the
+    /// trace API. The spans of each payload inherit its common attributes.
+    /// Returns `None` if a span can't be read.
+    pub fn from_json(json: &Json) -> Option<SpanBatch> {
+        let mut batch = SpanBatch::new();
+        for payload in json.as_array()? {
+            let mut common = Attributes::new();
+            if let Some(attributes) = payload.get("common").and_then(|c| c.get("attributes")) {
+                for (key, value) in attributes.as_object()? {
+                    if let Some(value) = to_attribute(value) {
+                        common.insert(Str::Owned(key.to_string()), value);
+                    }
+                }
+            }
+            let common = match common.is_empty() {
+                true => None,
+                false => Some(Arc::new(common)),
+            };
+            for span in payload.get("spans")?.as_array()? {
+                let mut span = Span::from_json(span)?;
+                span.set_common(common.clone());
+                batch.spans.push(span);
+            }
+        }
+        Some(batch)
+    }
+
+    /// Builds an SDK batch of the given spans, and returns it with its
+    /// estimated payload size.
+    fn chunk_to_sdk(spans: &mut [Box<Span>]) -> (SdkSpanBatch, usize) {
+        let block = CommonBlock::of(spans);
+        let mut batch = SdkSpanBatch::new();
+        let mut size = block.payload_size();
+        block.apply(&mut batch);
+        for span in spans.iter_mut() {
+            size += span.payload_size_in(&block);
+            batch.record(span.to_sdk_in(&block));
+        }
+        (batch, size)
+    }
+
+    /// Appends the given spans as one line of JSON. Returns false if they
+    /// can't be encoded, leaving `out` as it was.
+    fn chunk_to_json(spans: &[Box<Span>], out: &mut Vec<u8>) -> bool {
+        if cfg!(debug_assertions) {
+            for span in spans {
+                span.check_static();
+            }
+        }
+        let block = CommonBlock::of(spans);
+        let payload = JsonPayload {
+            block: &block,
+            spans,
+        };
+        let len = out.len();
+        match serde_json::to_writer(&mut *out, &[payload]) {
+            Ok(()) => {
+                out.push(b'\n');
+                true
+            }
+            Err(err) => {
+                log::error!("unable to encode spans: {}", err);
+                out.truncate(len);
+                false
+            }
+        }
+    }
+
+    /// Releases all spans, keeping the allocated buffer.
+    pub fn reset(&mut self) {
+        for span in self.spans.drain(..) {
+            span.release();
+        }
+        self.common = None;
+        self.completion = None;
+    }
+
+    /// Returns the batch to its pool, or frees it if it isn't pooled.
+    pub fn release(mut self: Box<Self>) {
+        self.reset();
+        if let Some(pool) = self.pool.take() {
+            pool.put_batch(self);
+        }
+    }
+}
+
+/// Returns the attribute value of a JSON scalar. Integers that fit into an
+/// i64 are read as ints, since JSON doesn't tell them from unsigned ints.
+fn to_attribute(json: &Json) -> Option<AttributeValue> {
+    match json {
+        Json::Bool(v) => Some(AttributeValue::Bool(*v)),
+        Json::Number(v) => v
+            .as_i64()
+            .map(AttributeValue::Int)
+            .or_else(|| v.as_u64().map(AttributeValue::UInt))
+            .or_else(|| v.as_f64().map(AttributeValue::Double)),
+        Json::String(v) => Some(AttributeValue::Str(Str::Owned(v.clone()))),
+        Json::Null | Json::Array(_) | Json::Object(_) => None,
+    }
+}
+
+/// A payload of the trace API: the spans of a chunk and their common block.
+struct JsonPayload<'a> {
+    block: &'a CommonBlock,
+    spans: &'a [Box<Span>],
+}
+
+impl Serialize for JsonPayload<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let mut map = serializer.serialize_map(None)?;
+        if !self.block.is_empty() {
+            map.serialize_entry("common", &JsonCommon(self.block))?;
+        }
+        let spans = self.spans.iter().map(|span| JsonSpan {
+            span,
+            block: self.block,
+        });
+        map.serialize_entry("spans", &JsonSeq(spans))?;
+        map.end()
+    }
+}
+
+struct JsonCommon<'a>(&'a CommonBlock);
+
+impl Serialize for JsonCommon<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let common = self.0.attributes.iter().flat_map(|a| a.iter());
+        let attributes = common
+            .chain(self.0.hoisted.iter())
+            .map(|(key, value)| (&**key, value));
+        let mut map = serializer.serialize_map(Some(1))?;
+        map.serialize_entry("attributes", &JsonMap(attributes))?;
+        map.end()
+    }
+}
+
+/// A span as the trace API reads it. All fields besides the IDs and the
+/// timestamp are attributes there.
+struct JsonSpan<'a> {
+    span: &'a Span,
+    block: &'a CommonBlock,
+}
+
+impl Serialize for JsonSpan<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let span = self.span;
+        let mut map = serializer.serialize_map(Some(4))?;
+        span.id.with_str(|id| map.serialize_entry("id", id))?;
+        span.trace_id
+            .with_str(|trace_id| map.serialize_entry("trace.id", trace_id))?;
+        map.serialize_entry("timestamp", &span.timestamp)?;
+        map.serialize_entry("attributes", &JsonSpanAttributes(self))?;
+        map.end()
+    }
+}
+
+struct JsonSpanAttributes<'a>(&'a JsonSpan<'a>);
+
+impl Serialize for JsonSpanAttributes<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let JsonSpan { span, block } = *self.0;
+        let mut map = serializer.serialize_map(None)?;
+        for (key, value) in span.attributes_in(block) {
+            map.serialize_entry(key, value)?;
+        }
+        if let Some(name) = span.name.get() {
+            if !block.has_str("name", name) {
+                map.serialize_entry("name", name)?;
+            }
+        }
+        if let Some(service_name) = span.service_name.get() {
+            if !block.has_str("service.name", service_name) {
+                map.serialize_entry("service.name", service_name)?;
+            }
+        }
+        if span.parent_id.is_set() {
+            span.parent_id
+                .with_str(|parent_id| map.serialize_entry("parent.id", parent_id))?;
+        }
+        if let Some(duration) = span.duration {
+            if duration.subsec_nanos() % 1_000_000 == 0 {
+                map.serialize_entry("duration.ms", &(duration.as_millis() as u64))?;
+            } else {
+                map.serialize_entry("duration.ms", &(duration.as_secs_f64() * 1000.0))?;
+            }
+        }
+        map.end()
+    }
+}
+
+/// Serializes the items of an iterator as a JSON array.
+struct JsonSeq<I>(I);
+
+impl<T: Serialize, I: Iterator<Item = T> + Clone> Serialize for JsonSeq<I> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        serializer.collect_seq(self.0.clone())
+    }
+}
+
+/// Serializes key-value pairs of an iterator as a JSON object.
+struct JsonMap<I>(I);
+
+impl<'a, I> Serialize for JsonMap<I>
+where
+    I: Iterator<Item = (&'a str, &'a AttributeValue)> + Clone,
+{
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        serializer.collect_map(self.0.clone())
+    }
+}
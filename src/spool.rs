@@ -0,0 +1,521 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::codec::{self, Reader};
+use crate::id::fnv1a;
+use crate::lock;
+use crate::pool::{thread_shard, SHARDS};
+use crate::span::{Span, SpanBatch};
+use flate2::read::DeflateDecoder;
+use flate2::write::DeflateEncoder;
+use flate2::Compression;
+use std::collections::VecDeque;
+use std::convert::TryInto;
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, Read, Write};
+use std::mem;
+use std::net::{TcpStream, ToSocketAddrs};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+use std::thread::{self, JoinHandle};
+use std::time::Duration;
+
+const EXTENSION: &str = "nrtspool";
+
+/// Each record starts with the length of the compressed batch and a checksum.
+const RECORD_HEADER: usize = 12;
+
+const SEGMENT_MIN: u64 = 64 * 1024;
+const SEGMENT_MAX: u64 = 16 * 1024 * 1024;
+
+/// How often and how patiently the endpoint is probed.
+const PROBE_INTERVAL: Duration = Duration::from_secs(1);
+const PROBE_TIMEOUT: Duration = Duration::from_millis(500);
+
+/// Batches replayed at a time, so the SDK queue isn't flooded.
+pub const REPLAY_MAX: usize = 8;
+
+/// Spans staged per thread shard before they are written as one batch.
+const STAGE_MAX: usize = 1000;
+
+/// The spool settings of a client configuration.
+#[derive(Clone)]
+pub struct SpoolConfig {
+    pub dir: PathBuf,
+    pub bytes_max: u64,
+}
+
+#[repr(C)]
+#[derive(Default)]
+pub struct SpoolStats {
+    segments: u64,
+    bytes: u64,
+    batches_spooled: u64,
+    batches_replayed: u64,
+    batches_dropped: u64,
+}
+
+/// A segment file, named after its sequence number.
+#[derive(Clone, Copy)]
+struct Segment {
+    seq: u64,
+    len: u64,
+    batches: u64,
+}
+
+impl Segment {
+    fn path(&self, dir: &Path) -> PathBuf {
+        dir.join(format!("{:016x}.{}", self.seq, EXTENSION))
+    }
+}
+
+#[derive(Default)]
+struct State {
+    /// Segments waiting for replay, oldest first.
+    closed: VecDeque<Segment>,
+    /// The segment being appended to.
+    writer: Option<(Segment, File)>,
+    /// The segment being replayed and its remaining records.
+    replay: Option<(Segment, VecDeque<Vec<u8>>)>,
+    /// Segments whose batches were all taken by `read`. They are deleted
+    /// once the caller comes back for more, after handing those batches off.
+    consumed: Vec<Segment>,
+    bytes: u64,
+    next_seq: u64,
+}
+
+/// A persistent overflow for span batches that can't be sent.
+///
+/// While the trace endpoint doesn't accept connections, batches are
+/// serialized, compressed and appended to segment files in a directory
+/// instead of being handed to the SDK, whose queue would only fill up and
+/// drop them. The segments form a ring bounded by a byte budget: when the
+/// budget is exhausted, the oldest segment is deleted. Once the endpoint is
+/// reachable again, spooled batches are replayed a few at a time.
+///
+/// Records are written with plain file writes rather than a memory map, so a
+/// full disk surfaces as an error instead of a fault in the host process.
+/// Segments are synced when they are closed. Records torn by a crash are cut
+/// off when the directory is opened again, and a segment is only deleted once
+/// all its batches were handed off, so batches are delivered at least once.
+pub struct Spool {
+    dir: PathBuf,
+    bytes_max: u64,
+    segment_max: u64,
+    endpoint: (String, u16),
+    compression: Compression,
+    state: Mutex<State>,
+    staged: Vec<Mutex<Vec<Box<Span>>>>,
+    up: AtomicBool,
+    batches_spooled: AtomicU64,
+    batches_replayed: AtomicU64,
+    batches_dropped: AtomicU64,
+    stop: AtomicBool,
+    prober: Mutex<Option<JoinHandle<()>>>,
+}
+
+impl Spool {
+    /// Opens the spool directory, picking up segments left by a previous
+    /// process, probes the endpoint once and starts the probe thread.
+    pub fn open(
+        config: &SpoolConfig,
+        endpoint: (String, u16),
+        compression: Compression,
+    ) -> io::Result<Arc<Spool>> {
+        fs::create_dir_all(&config.dir)?;
+        let mut state = State::default();
+        for segment in recover(&config.dir)? {
+            state.bytes += segment.len;
+            state.next_seq = segment.seq + 1;
+            state.closed.push_back(segment);
+        }
+
+        let mut staged = Vec::with_capacity(SHARDS);
+        staged.resize_with(SHARDS, || Mutex::new(Vec::new()));
+        let spool = Arc::new(Spool {
+            dir: config.dir.clone(),
+            bytes_max: config.bytes_max,
+            segment_max: (config.bytes_max / 8).max(SEGMENT_MIN).min(SEGMENT_MAX),
+            up: AtomicBool::new(probe(&endpoint)),
+            endpoint,
+            compression,
+            state: Mutex::new(state),
+            staged,
+            batches_spooled: AtomicU64::new(0),
+            batches_replayed: AtomicU64::new(0),
+            batches_dropped: AtomicU64::new(0),
+            stop: AtomicBool::new(false),
+            prober: Mutex::new(None),
+        });
+
+        let weak = Arc::downgrade(&spool);
+        match thread::Builder::new()
+            .name("nrt-spool".into())
+            .spawn(move || probe_loop(weak))
+        {
+            Ok(handle) => *lock(&spool.prober) = Some(handle),
+            Err(err) => log::error!("unable to start spool thread: {}", err),
+        }
+        Ok(spool)
+    }
+
+    /// Returns whether the endpoint accepted a connection when it was last
+    /// probed.
+    pub fn is_up(&self) -> bool {
+        self.up.load(Ordering::Relaxed)
+    }
+
+    /// Holds a span back until enough spans are staged by the calling
+    /// thread's shard to write them as one batch.
+    pub fn stage(&self, span: Box<Span>) {
+        let mut spans = {
+            let mut staged = lock(&self.staged[thread_shard()]);
+            staged.push(span);
+            if staged.len() < STAGE_MAX {
+                return;
+            }
+            mem::replace(&mut *staged, Vec::new())
+        };
+        self.write(&mut spans);
+    }
+
+    /// Writes all staged spans.
+    pub fn flush_staged(&self) {
+        for staged in self.staged.iter() {
+            let mut spans = mem::replace(&mut *lock(staged), Vec::new());
+            if !spans.is_empty() {
+                self.write(&mut spans);
+            }
+        }
+    }
+
+    /// Appends the spans as one batch. The spans are released.
+    ///
+    /// Spans are encoded one at a time into a small buffer and streamed into
+    /// the encoder, so only the compressed batch is held in memory.
+    pub fn write(&self, spans: &mut Vec<Box<Span>>) {
+        let mut encoder = DeflateEncoder::new(vec![0; RECORD_HEADER], self.compression);
+        let mut encoded = Vec::new();
+        codec::put_u32(&mut encoded, spans.len() as u32);
+        let mut written = encoder.write_all(&encoded);
+        for span in spans.drain(..) {
+            if written.is_ok() {
+                encoded.clear();
+                span.encode(&mut encoded);
+                written = encoder.write_all(&encoded);
+            }
+            span.release();
+        }
+        let compressed = written.and_then(|_| encoder.finish());
+        let mut record = match compressed {
+            Ok(record) => record,
+            Err(err) => {
+                log::error!("unable to compress spooled batch: {}", err);
+                self.batches_dropped.fetch_add(1, Ordering::Relaxed);
+                return;
+            }
+        };
+        let checksum = fnv1a(&record[RECORD_HEADER..]);
+        let len = (record.len() - RECORD_HEADER) as u32;
+        record[..4].copy_from_slice(&len.to_le_bytes());
+        record[4..RECORD_HEADER].copy_from_slice(&checksum.to_le_bytes());
+
+        let mut state = lock(&self.state);
+        if !self.make_room(&mut state, record.len() as u64) {
+            self.batches_dropped.fetch_add(1, Ordering::Relaxed);
+            return;
+        }
+        match self.append(&mut state, &record) {
+            Ok(()) => {
+                self.batches_spooled.fetch_add(1, Ordering::Relaxed);
+            }
+            Err(err) => {
+                log::error!("unable to write to spool: {}", err);
+                self.batches_dropped.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+    }
+
+    /// Deletes the oldest segments until `len` more bytes fit into the
+    /// budget. Returns false if they don't fit even into an empty spool.
+    fn make_room(&self, state: &mut State, len: u64) -> bool {
+        if len > self.bytes_max {
+            return false;
+        }
+        while state.bytes + len > self.bytes_max {
+            let (segment, batches) = if let Some((segment, records)) = state.replay.take() {
+                let batches = records.len() as u64;
+                (segment, batches)
+            } else if let Some(segment) = state.closed.pop_front() {
+                let batches = segment.batches;
+                (segment, batches)
+            } else {
+                match self.close_writer(state) {
+                    Some(segment) => state.closed.push_back(segment),
+                    None => return false,
+                }
+                continue;
+            };
+            self.delete(state, &segment);
+            self.batches_dropped.fetch_add(batches, Ordering::Relaxed);
+        }
+        true
+    }
+
+    fn append(&self, state: &mut State, record: &[u8]) -> io::Result<()> {
+        let full = match &state.writer {
+            Some((segment, _)) => segment.len + record.len() as u64 > self.segment_max,
+            None => false,
+        };
+        if full {
+            if let Some(segment) = self.close_writer(state) {
+                state.closed.push_back(segment);
+            }
+        }
+        if state.writer.is_none() {
+            let segment = Segment {
+                seq: state.next_seq,
+                len: 0,
+                batches: 0,
+            };
+            let file = OpenOptions::new()
+                .write(true)
+                .create_new(true)
+                .open(segment.path(&self.dir))?;
+            state.next_seq += 1;
+            state.writer = Some((segment, file));
+        }
+
+        let (segment, file) = state.writer.as_mut().unwrap();
+        file.write_all(record)?;
+        segment.len += record.len() as u64;
+        segment.batches += 1;
+        state.bytes += record.len() as u64;
+        Ok(())
+    }
+
+    fn close_writer(&self, state: &mut State) -> Option<Segment> {
+        let (segment, file) = state.writer.take()?;
+        if let Err(err) = file.sync_data() {
+            log::error!("unable to sync spool segment: {}", err);
+        }
+        Some(segment)
+    }
+
+    fn delete(&self, state: &mut State, segment: &Segment) {
+        state.bytes -= segment.len;
+        if let Err(err) = fs::remove_file(segment.path(&self.dir)) {
+            log::error!("unable to remove spool segment: {}", err);
+        }
+    }
+
+    fn delete_consumed(&self, state: &mut State) {
+        for segment in mem::take(&mut state.consumed) {
+            self.delete(state, &segment);
+        }
+    }
+
+    /// Takes up to `max` batches for sending, oldest first. Segments are
+    /// deleted by the next call once all their batches were taken, so the
+    /// caller must hand off the batches before it calls again.
+    pub fn read(&self, max: usize) -> Vec<SpanBatch> {
+        let mut records = Vec::new();
+        {
+            let mut state = lock(&self.state);
+            self.delete_consumed(&mut state);
+            while records.len() < max {
+                if state.replay.is_none() {
+                    let segment = match state.closed.pop_front() {
+                        Some(segment) => segment,
+                        None => match self.close_writer(&mut state) {
+                            Some(segment) => segment,
+                            None => break,
+                        },
+                    };
+                    let loaded = fs::read(segment.path(&self.dir)).map(|data| split(&data).0);
+                    match loaded {
+                        Ok(loaded) => state.replay = Some((segment, loaded.into())),
+                        Err(err) => {
+                            log::error!("unable to read spool segment: {}", err);
+                            self.batches_dropped
+                                .fetch_add(segment.batches, Ordering::Relaxed);
+                            self.delete(&mut state, &segment);
+                            continue;
+                        }
+                    }
+                }
+
+                let (_, replay) = state.replay.as_mut().unwrap();
+                if let Some(record) = replay.pop_front() {
+                    records.push(record);
+                }
+                if replay.is_empty() {
+                    let (segment, _) = state.replay.take().unwrap();
+                    state.consumed.push(segment);
+                }
+            }
+        }
+
+        let mut batches = Vec::with_capacity(records.len());
+        for record in records {
+            match decode(&record) {
+                Some(batch) => {
+                    self.batches_replayed.fetch_add(1, Ordering::Relaxed);
+                    batches.push(batch);
+                }
+                None => {
+                    log::error!("dropping corrupt spooled batch");
+                    self.batches_dropped.fetch_add(1, Ordering::Relaxed);
+                }
+            }
+        }
+        batches
+    }
+
+    pub fn stats(&self) -> SpoolStats {
+        let state = lock(&self.state);
+        SpoolStats {
+            segments: (state.closed.len()
+                + state.writer.is_some() as usize
+                + state.replay.is_some() as usize
+                + state.consumed.len()) as u64,
+            bytes: state.bytes,
+            batches_spooled: self.batches_spooled.load(Ordering::Relaxed),
+            batches_replayed: self.batches_replayed.load(Ordering::Relaxed),
+            batches_dropped: self.batches_dropped.load(Ordering::Relaxed),
+        }
+    }
+
+    /// Stops the probe thread and writes all staged spans to disk. Batches
+    /// taken by `read` must have been handed off by now.
+    pub fn shutdown(&self) {
+        self.stop.store(true, Ordering::Release);
+        if let Some(prober) = lock(&self.prober).take() {
+            prober.thread().unpark();
+            if prober.join().is_err() {
+                log::error!("spool thread panicked");
+            }
+        }
+        self.flush_staged();
+        let mut state = lock(&self.state);
+        self.delete_consumed(&mut state);
+        if let Some(segment) = self.close_writer(&mut state) {
+            state.closed.push_back(segment);
+        }
+    }
+}
+
+impl Drop for Spool {
+    fn drop(&mut self) {
+        self.stop.store(true, Ordering::Release);
+        if let Some(prober) = lock(&self.prober).take() {
+            prober.thread().unpark();
+        }
+    }
+}
+
+/// Returns whether any address of the endpoint accepts a TCP connection.
+fn probe(endpoint: &(String, u16)) -> bool {
+    match (endpoint.0.as_str(), endpoint.1).to_socket_addrs() {
+        Ok(mut addrs) => addrs.any(|addr| TcpStream::connect_timeout(&addr, PROBE_TIMEOUT).is_ok()),
+        Err(_) => false,
+    }
+}
+
+fn probe_loop(spool: Weak<Spool>) {
+    loop {
+        thread::park_timeout(PROBE_INTERVAL);
+        let spool = match spool.upgrade() {
+            Some(spool) => spool,
+            None => return,
+        };
+        if spool.stop.load(Ordering::Acquire) {
+            return;
+        }
+        let up = probe(&spool.endpoint);
+        if up != spool.up.swap(up, Ordering::Relaxed) {
+            log::info!(
+                "trace endpoint {}, {} spooling",
+                if up { "reachable" } else { "unreachable" },
+                if up { "stopped" } else { "started" }
+            );
+        }
+    }
+}
+
+/// Splits segment data into records. Returns the records and the length of
+/// the valid prefix, which is shorter than the data if the last record was
+/// torn or corrupted.
+fn split(data: &[u8]) -> (Vec<Vec<u8>>, usize) {
+    let mut records = Vec::new();
+    let mut offset = 0;
+    while data.len() - offset >= RECORD_HEADER {
+        let header = &data[offset..offset + RECORD_HEADER];
+        let len = u32::from_le_bytes(header[..4].try_into().unwrap()) as usize;
+        let checksum = u64::from_le_bytes(header[4..].try_into().unwrap());
+        let start = offset + RECORD_HEADER;
+        if data.len() - start < len || fnv1a(&data[start..start + len]) != checksum {
+            break;
+        }
+        records.push(data[start..start + len].to_vec());
+        offset = start + len;
+    }
+    (records, offset)
+}
+
+/// Scans the spool directory for segments of a previous process, cutting off
+/// torn records and removing empty segments.
+fn recover(dir: &Path) -> io::Result<Vec<Segment>> {
+    let mut segments = Vec::new();
+    for entry in fs::read_dir(dir)? {
+        let path = entry?.path();
+        if path.extension().and_then(|e| e.to_str()) != Some(EXTENSION) {
+            continue;
+        }
+        let seq = match path
+            .file_stem()
+            .and_then(|s| s.to_str())
+            .and_then(|s| u64::from_str_radix(s, 16).ok())
+        {
+            Some(seq) => seq,
+            None => continue,
+        };
+
+        let data = fs::read(&path)?;
+        let (records, valid) = split(&data);
+        if records.is_empty() {
+            fs::remove_file(&path)?;
+            continue;
+        }
+        if valid < data.len() {
+            log::warn!("truncating torn spool segment {}", path.display());
+            OpenOptions::new()
+                .write(true)
+                .open(&path)?
+                .set_len(valid as u64)?;
+        }
+        segments.push(Segment {
+            seq,
+            len: valid as u64,
+            batches: records.len() as u64,
+        });
+    }
+    segments.sort_by_key(|segment| segment.seq);
+    Ok(segments)
+}
+
+fn decode(record: &[u8]) -> Option<SpanBatch> {
+    let mut encoded = Vec::new();
+    DeflateDecoder::new(record).read_to_end(&mut encoded).ok()?;
+    let mut reader = Reader::new(&encoded);
+    let mut batch = SpanBatch::new();
+    for _ in 0..reader.u32()? {
+        batch.record(Span::decode(&mut reader)?);
+    }
+    if !reader.is_empty() {
+        return None;
+    }
+    Some(batch)
+}
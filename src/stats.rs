@@ -0,0 +1,165 @@
+///
+/// Copyright 2020 New Relic Corporation. All rights reserved.
+/// SPDX-License-Identifier: Apache-2.0
+///
+use crate::client::SendResult;
+use crate::histogram::{Histogram, LatencyStats};
+use crate::pool::{thread_shard, SHARDS};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+const RESULTS: usize = SendResult::Invalid as usize + 1;
+
+/// Counters updated by the threads of one shard, on their own cache line.
+/// Producers and sender threads use separate lines.
+#[repr(align(64))]
+#[derive(Default)]
+struct Stripe {
+    results: [AtomicU64; RESULTS],
+    batches_evicted: AtomicU64,
+    spans_enqueued: AtomicU64,
+    spans_dropped: AtomicU64,
+}
+
+#[repr(align(64))]
+#[derive(Default)]
+struct SenderStripe {
+    batches_sent: AtomicU64,
+    payloads_sent: AtomicU64,
+    payload_bytes_sent: AtomicU64,
+    spans_sent: AtomicU64,
+}
+
+/// Statistics of a client, as they are passed to C.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default)]
+pub struct ClientStats {
+    pub queue_depth: u64,
+    pub queue_capacity: u64,
+    pub batches_queued: u64,
+    pub batches_queued_dropped_oldest: u64,
+    pub batches_queued_sampled: u64,
+    pub batches_spooled: u64,
+    pub batches_dropped: u64,
+    pub batches_timed_out: u64,
+    pub batches_evicted: u64,
+    pub batches_sent: u64,
+    pub payloads_sent: u64,
+    pub payload_bytes_sent: u64,
+    pub spans_enqueued: u64,
+    pub spans_dropped: u64,
+    pub spans_sent: u64,
+    pub enqueue_latency: LatencyStats,
+    pub queue_latency: LatencyStats,
+    pub send_latency: LatencyStats,
+}
+
+/// Counters and latency histograms of a client.
+///
+/// Producers and sender threads only ever add to relaxed atomics, striped
+/// by thread on separate cache lines, and reading the statistics doesn't
+/// stop either of them.
+pub struct Stats {
+    stripes: Vec<Stripe>,
+    sender_stripes: Vec<SenderStripe>,
+    /// Time spent in `Client::send`, including the pipeline and waiting for
+    /// room in the queue.
+    enqueue_latency: Histogram,
+    /// Time batches spent in the queue.
+    queue_latency: Histogram,
+    /// Time a sender thread took to convert a batch and hand it to the SDK.
+    send_latency: Histogram,
+}
+
+impl Stats {
+    pub fn new() -> Self {
+        let mut stripes = Vec::with_capacity(SHARDS);
+        stripes.resize_with(SHARDS, Stripe::default);
+        let mut sender_stripes = Vec::with_capacity(SHARDS);
+        sender_stripes.resize_with(SHARDS, SenderStripe::default);
+        Stats {
+            stripes,
+            sender_stripes,
+            enqueue_latency: Histogram::default(),
+            queue_latency: Histogram::default(),
+            send_latency: Histogram::default(),
+        }
+    }
+
+    /// Counts the outcome of `Client::send` for a batch of `spans` spans, of
+    /// which `dropped` were dropped, and the time it took.
+    pub fn record_enqueue(&self, result: SendResult, spans: usize, dropped: usize, ns: u64) {
+        let stripe = &self.stripes[thread_shard()];
+        stripe.results[result as usize].fetch_add(1, Ordering::Relaxed);
+        stripe
+            .spans_enqueued
+            .fetch_add(spans as u64, Ordering::Relaxed);
+        if dropped > 0 {
+            stripe
+                .spans_dropped
+                .fetch_add(dropped as u64, Ordering::Relaxed);
+        }
+        self.enqueue_latency.record(ns);
+    }
+
+    /// Counts a queued batch of `spans` spans that was dropped to make room.
+    pub fn record_evicted(&self, spans: usize) {
+        let stripe = &self.stripes[thread_shard()];
+        stripe.batches_evicted.fetch_add(1, Ordering::Relaxed);
+        stripe
+            .spans_dropped
+            .fetch_add(spans as u64, Ordering::Relaxed);
+    }
+
+    /// Counts a batch of `spans` spans that was split into `payloads`
+    /// payloads of an estimated `bytes` bytes and handed to the SDK.
+    pub fn record_sent(
+        &self,
+        spans: usize,
+        payloads: usize,
+        bytes: usize,
+        queue_ns: u64,
+        send_ns: u64,
+    ) {
+        let sender = &self.sender_stripes[thread_shard()];
+        sender.batches_sent.fetch_add(1, Ordering::Relaxed);
+        sender
+            .payloads_sent
+            .fetch_add(payloads as u64, Ordering::Relaxed);
+        sender
+            .payload_bytes_sent
+            .fetch_add(bytes as u64, Ordering::Relaxed);
+        sender.spans_sent.fetch_add(spans as u64, Ordering::Relaxed);
+        self.queue_latency.record(queue_ns);
+        self.send_latency.record(send_ns);
+    }
+
+    pub fn get(&self) -> ClientStats {
+        let mut results = [0; RESULTS];
+        let mut stats = ClientStats::default();
+        for stripe in self.stripes.iter() {
+            for (sum, count) in results.iter_mut().zip(stripe.results.iter()) {
+                *sum += count.load(Ordering::Relaxed);
+            }
+            stats.batches_evicted += stripe.batches_evicted.load(Ordering::Relaxed);
+            stats.spans_enqueued += stripe.spans_enqueued.load(Ordering::Relaxed);
+            stats.spans_dropped += stripe.spans_dropped.load(Ordering::Relaxed);
+        }
+        stats.batches_queued = results[SendResult::Queued as usize];
+        stats.batches_queued_dropped_oldest = results[SendResult::QueuedDroppedOldest as usize];
+        stats.batches_queued_sampled = results[SendResult::QueuedSampled as usize];
+        stats.batches_spooled = results[SendResult::Spooled as usize];
+        stats.batches_dropped = results[SendResult::Dropped as usize];
+        stats.batches_timed_out = results[SendResult::Timeout as usize];
+
+        for sender in self.sender_stripes.iter() {
+            stats.batches_sent += sender.batches_sent.load(Ordering::Relaxed);
+            stats.payloads_sent += sender.payloads_sent.load(Ordering::Relaxed);
+            stats.payload_bytes_sent += sender.payload_bytes_sent.load(Ordering::Relaxed);
+            stats.spans_sent += sender.spans_sent.load(Ordering::Relaxed);
+        }
+        stats.enqueue_latency = self.enqueue_latency.stats();
+        stats.queue_latency = self.queue_latency.stats();
+        stats.send_latency = self.send_latency.stats();
+        stats
+    }
+}
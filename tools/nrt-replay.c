@@ -0,0 +1,202 @@
+/*
+ * Copyright 2020 New Relic Corporation. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Replay span batches written by a client configured with
+ * nrt_client_config_set_export(), to reproduce production traffic against
+ * the trace API or another endpoint.
+ */
+#include "newrelic-telemetry-sdk.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef OS_WINDOWS
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* The most sender threads a client can have. */
+#define THREADS_MAX 64
+
+typedef struct {
+  double rate;
+  const char* host;
+  uint16_t port;
+  int threads;
+  int loops;
+} options_t;
+
+/* Return a monotonic timestamp in nanoseconds. */
+static uint64_t now_ns(void) {
+#ifdef OS_WINDOWS
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart * (1000000000.0 / frequency.QuadPart));
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static void sleep_ms(unsigned ms) {
+#ifdef OS_WINDOWS
+  Sleep(ms);
+#else
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+#endif
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "usage: %s [-r spans per second] [-e host:port] [-t sender threads] "
+          "[-l loops] path...\n"
+          "\n"
+          "Replays export files, or directories of them, as fast as possible "
+          "or at\nthe given rate. Batches are sent to the given endpoint, or "
+          "to the trace API.\nNEW_RELIC_API_KEY is required unless an "
+          "endpoint is given.\n",
+          name);
+  exit(1);
+}
+
+/* Parse the options and return the index of the first path. */
+static int parse_options(int argc, char** argv, options_t* options) {
+  int i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i += 2) {
+    const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!value || strlen(argv[i]) != 2) {
+      usage(argv[0]);
+    }
+    switch (argv[i][1]) {
+      case 'r':
+        options->rate = atof(value);
+        break;
+      case 'e': {
+        const char* colon = strrchr(value, ':');
+        static char host[256];
+        if (!colon || colon == value ||
+            (size_t)(colon - value) >= sizeof(host)) {
+          usage(argv[0]);
+        }
+        memcpy(host, value, colon - value);
+        host[colon - value] = '\0';
+        options->host = host;
+        options->port = (uint16_t)atoi(colon + 1);
+        break;
+      }
+      case 't':
+        options->threads = atoi(value);
+        break;
+      case 'l':
+        options->loops = atoi(value);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (i >= argc || options->rate < 0 || options->threads < 1 ||
+      options->threads > THREADS_MAX || options->loops < 1) {
+    usage(argv[0]);
+  }
+  return i;
+}
+
+/*
+ * Read the batches of a path and send them, sleeping whenever the spans sent
+ * so far are ahead of the rate. Returns false if the path can't be read.
+ */
+static bool replay_path(nrt_client_t* client,
+                        const char* path,
+                        const options_t* options,
+                        uint64_t start_ns,
+                        nrt_replay_stats_t* total) {
+  nrt_replay_stats_t stats;
+  nrt_span_batch_t* batch;
+
+  nrt_replay_t* replay = nrt_replay_open(path);
+  if (!replay) {
+    fprintf(stderr, "unable to open %s\n", path);
+    return false;
+  }
+  while ((batch = nrt_replay_next(replay))) {
+    nrt_client_send(client, &batch);
+    if (options->rate > 0) {
+      nrt_replay_get_stats(replay, &stats);
+      uint64_t due_ns =
+          (uint64_t)((total->spans + stats.spans) * 1e9 / options->rate);
+      uint64_t elapsed_ns = now_ns() - start_ns;
+      if (due_ns > elapsed_ns) {
+        sleep_ms((unsigned)((due_ns - elapsed_ns) / 1000000));
+      }
+    }
+  }
+  nrt_replay_get_stats(replay, &stats);
+  total->files += stats.files;
+  total->bytes += stats.bytes;
+  total->batches += stats.batches;
+  total->spans += stats.spans;
+  total->lines_skipped += stats.lines_skipped;
+  nrt_replay_destroy(&replay);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  options_t options = {0, NULL, 0, 1, 1};
+  nrt_replay_stats_t total;
+  uint64_t start_ns, elapsed_ns;
+  int first, i, loop;
+
+  first = parse_options(argc, argv, &options);
+  const char* api_key = getenv("NEW_RELIC_API_KEY");
+  if (!options.host && !api_key) {
+    usage(argv[0]);
+  }
+
+  nrt_client_config_t* cfg =
+      nrt_client_config_new(api_key ? api_key : "nrt-replay");
+  if (options.host) {
+    nrt_client_config_set_endpoint_traces(cfg, options.host, options.port);
+  }
+  nrt_client_config_set_sender_threads(cfg, options.threads);
+  nrt_client_config_set_backpressure(cfg, NRT_BACKPRESSURE_BLOCK, 60000);
+  nrt_client_t* client = nrt_client_new(&cfg);
+  if (!client) {
+    fprintf(stderr, "unable to create a client\n");
+    return 1;
+  }
+
+  memset(&total, 0, sizeof(total));
+  start_ns = now_ns();
+  for (loop = 0; loop < options.loops; loop++) {
+    for (i = first; i < argc; i++) {
+      if (!replay_path(client, argv[i], &options, start_ns, &total)) {
+        nrt_client_destroy(&client);
+        return 1;
+      }
+    }
+  }
+  nrt_client_shutdown(&client);
+  elapsed_ns = now_ns() - start_ns;
+
+  printf("%-40s %12llu files %8llu batches %10llu bytes\n", "read",
+         (unsigned long long)total.files, (unsigned long long)total.batches,
+         (unsigned long long)total.bytes);
+  if (total.lines_skipped > 0) {
+    printf("%-40s %12llu lines\n", "skipped",
+           (unsigned long long)total.lines_skipped);
+  }
+  if (total.spans > 0) {
+    printf("%-40s %12llu spans %10.0f spans/s\n", "replay to shutdown",
+           (unsigned long long)total.spans, total.spans * 1e9 / elapsed_ns);
+  }
+}